@@ -0,0 +1,375 @@
+// Standalone benchmark of the main operations of the library on synthetic P1
+// finite element problems. Results are written as JSON, so that runs of
+// different releases can be compared.
+//
+// Usage: ardis_bench [--size N] [--repeat R] [--block-sizes 128,256,...]
+//                    [--mesh structured|unstructured|all] [--dt DT]
+//                    [--epsilon EPS] [--output PATH]
+//                    [--node-order natural|shuffled|blocked]
+//
+// Meshes from generators rarely number their nodes along the grid: the
+// shuffled order numbers them at random, and the blocked order renumbers the
+// shuffled mesh with block_ordering.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "constants.hpp"
+#include "dataStructures/array.hpp"
+#include "dataStructures/hd_data.hpp"
+#include "dataStructures/sparse_matrix.hpp"
+#include "geometry/mesh.hpp"
+#include "geometry/mesh_partition.hpp"
+#include "geometry/p1_assembly.hpp"
+#include "helper/cuda/cuda_error_check.h"
+#include "helper/cuda/cuda_thread_manager.hpp"
+#include "matrixOperations/basic_operations.hpp"
+#include "reactionDiffusionSystem/simulation.hpp"
+#include "solvers/amg_preconditioner.hpp"
+#include "solvers/conjugate_gradient_solver.hpp"
+
+struct bench_options {
+    int size = 256;
+    int repeat = 10;
+    std::vector<int> block_sizes{128, 256, 512, 1024};
+    std::vector<std::string> meshes{"structured", "unstructured"};
+    T dt = 0.1;
+    T epsilon = 1e-6;
+    std::string output = "";
+    std::string node_order = "natural";
+};
+
+struct bench_mesh {
+    std::string name;
+    std::vector<T> x;
+    std::vector<T> y;
+    std::vector<int> triangles;
+
+    int n_nodes() const { return x.size(); }
+    int n_triangles() const { return triangles.size() / 3; }
+};
+
+struct bench_result {
+    std::string mesh;
+    std::string benchmark;
+    int n_nodes;
+    int nnz;
+    int block_size;
+    std::vector<double> times;
+    int iterations = -1;
+};
+
+// Triangulated square of size x size cells. The unstructured variant moves the
+// interior nodes randomly and picks the diagonal of each cell at random, which
+// gives irregular elements and an irregular sparsity pattern.
+bench_mesh make_mesh(int size, bool unstructured) {
+    bench_mesh mesh;
+    mesh.name = (unstructured) ? "unstructured" : "structured";
+    std::mt19937 gen(42);
+    std::uniform_real_distribution<T> jitter(-0.3, 0.3);
+    std::bernoulli_distribution flip(0.5);
+    T h = 10.0 / size;
+    for (int j = 0; j <= size; j++)
+        for (int i = 0; i <= size; i++) {
+            T x = i * h;
+            T y = j * h;
+            if (unstructured && i > 0 && i < size && j > 0 && j < size) {
+                x += jitter(gen) * h;
+                y += jitter(gen) * h;
+            }
+            mesh.x.push_back(x);
+            mesh.y.push_back(y);
+        }
+    auto node = [size](int i, int j) { return j * (size + 1) + i; };
+    for (int j = 0; j < size; j++)
+        for (int i = 0; i < size; i++) {
+            int a = node(i, j), b = node(i + 1, j), c = node(i + 1, j + 1),
+                d = node(i, j + 1);
+            if (unstructured && flip(gen))
+                mesh.triangles.insert(mesh.triangles.end(), {a, b, d, b, c, d});
+            else
+                mesh.triangles.insert(mesh.triangles.end(), {a, b, c, a, c, d});
+        }
+    return mesh;
+}
+
+// Node i becomes node order[i]
+void renumber(bench_mesh &mesh, const std::vector<int> &order) {
+    int n = mesh.n_nodes();
+    std::vector<int> newIndex(n);
+    std::vector<T> x(n), y(n);
+    for (int i = 0; i < n; i++) {
+        newIndex[order[i]] = i;
+        x[i] = mesh.x[order[i]];
+        y[i] = mesh.y[order[i]];
+    }
+    mesh.x = x;
+    mesh.y = y;
+    for (int &node : mesh.triangles)
+        node = newIndex[node];
+}
+
+void apply_node_order(bench_mesh &mesh, const std::string &nodeOrder) {
+    if (nodeOrder == "natural")
+        return;
+    std::vector<int> order(mesh.n_nodes());
+    for (int i = 0; i < mesh.n_nodes(); i++)
+        order[i] = i;
+    std::shuffle(order.begin(), order.end(), std::mt19937(7));
+    renumber(mesh, order);
+    if (nodeOrder == "blocked")
+        renumber(mesh, block_ordering(mesh.x.data(), mesh.y.data(),
+                                      mesh.n_nodes(), mesh.triangles.data(),
+                                      mesh.n_triangles()));
+    mesh.name += "/" + nodeOrder;
+}
+
+// Copies the mesh to the device
+struct bench_device_mesh {
+    d_mesh mesh;
+    d_array<int> triangles;
+
+    bench_device_mesh(const bench_mesh &host)
+        : mesh(host.n_nodes()), triangles(host.triangles.size()) {
+        gpuErrchk(cudaMemcpy(mesh.X.data, host.x.data(),
+                             sizeof(T) * host.n_nodes(),
+                             cudaMemcpyHostToDevice));
+        gpuErrchk(cudaMemcpy(mesh.Y.data, host.y.data(),
+                             sizeof(T) * host.n_nodes(),
+                             cudaMemcpyHostToDevice));
+        gpuErrchk(cudaMemcpy(triangles.data, host.triangles.data(),
+                             sizeof(int) * host.triangles.size(),
+                             cudaMemcpyHostToDevice));
+    }
+};
+
+template <typename Operation>
+std::vector<double> time_operation(int repeat, Operation operation) {
+    std::vector<double> times;
+    operation(); // Warm-up
+    gpuErrchk(cudaDeviceSynchronize());
+    for (int r = 0; r < repeat; r++) {
+        auto start = std::chrono::steady_clock::now();
+        operation();
+        gpuErrchk(cudaDeviceSynchronize());
+        times.push_back(std::chrono::duration<double>(
+                            std::chrono::steady_clock::now() - start)
+                            .count());
+    }
+    return times;
+}
+
+void fill_simulation(simulation &simu, d_spmatrix &mass, d_spmatrix &stiffness,
+                     T epsilon) {
+    simu.epsilon = epsilon;
+    simu.drain = 0;
+    simu.load_dampness_matrix(mass);
+    simu.load_stiffness_matrix(stiffness);
+    simu.current_state.add_species("A").fill(1.0);
+    simu.current_state.add_species("B").fill(0.5);
+    simu.current_state.add_species("C").fill(0.0);
+    simu.add_reaction("A + B -> C", 0.1);
+    simu.add_reaction("C -> A", 0.05);
+    simu.add_mm_reaction("B -> 2 C", 1.0, 0.5);
+}
+
+void run_mesh(const bench_mesh &mesh, const bench_options &options,
+              std::vector<bench_result> &results) {
+    int n = mesh.n_nodes();
+    bench_device_mesh deviceMesh(mesh);
+    d_spmatrix mass, stiffness;
+    assemble_p1_matrices(deviceMesh.mesh, deviceMesh.triangles, mass,
+                         stiffness);
+
+    d_spmatrix diffusion;
+    hd_data<T> minusDt(-options.dt);
+    matrix_sum(mass, stiffness, minusDt(true), diffusion);
+
+    d_vector x(n), y(n), b(n);
+    x.fill(1.0);
+
+    for (int blockSize : options.block_sizes) {
+        set_block_size(blockSize);
+        auto add = [&](std::string name, std::vector<double> times,
+                       int iterations = -1) {
+            bench_result result{mesh.name, name,      n,    mass.nnz,
+                                blockSize, times, iterations};
+            results.push_back(result);
+        };
+
+        add("p1_assembly", time_operation(options.repeat, [&]() {
+                d_spmatrix assembledMass, assembledStiffness;
+                assemble_p1_matrices(deviceMesh.mesh, deviceMesh.triangles,
+                                     assembledMass, assembledStiffness);
+            }));
+
+        add("spmv", time_operation(options.repeat, [&]() { dot(mass, x, y); }));
+
+        add("matrix_sum", time_operation(options.repeat, [&]() {
+                d_spmatrix sum;
+                matrix_sum(mass, stiffness, minusDt(true), sum);
+            }));
+
+        cg_solver solver(n);
+        dot(mass, x, b);
+        auto cgTimes = time_operation(options.repeat, [&]() {
+            y.fill(0.0);
+            solver.cg_solve(diffusion, b, y, options.epsilon);
+        });
+        add("cg_solve", cgTimes, solver.n_iter_last);
+
+        add("amg_setup", time_operation(options.repeat, [&]() {
+                amg_preconditioner amg(diffusion);
+            }));
+        amg_preconditioner amg(diffusion);
+        solver.preconditioner = &amg;
+        auto pcgTimes = time_operation(options.repeat, [&]() {
+            y.fill(0.0);
+            solver.cg_solve(diffusion, b, y, options.epsilon);
+        });
+        add("amg_cg_solve", pcgTimes, solver.n_iter_last);
+        solver.preconditioner = nullptr;
+
+        simulation reactionSimu(n);
+        fill_simulation(reactionSimu, mass, stiffness, options.epsilon);
+        add("reaction_step",
+            time_operation(options.repeat, [&]() {
+                reactionSimu.iterate_reaction(options.dt);
+            }));
+
+        simulation simu(n);
+        fill_simulation(simu, mass, stiffness, options.epsilon);
+        add("simulation_step", time_operation(options.repeat, [&]() {
+                simu.iterate_diffusion(options.dt);
+                simu.prune();
+                simu.iterate_reaction(options.dt);
+            }));
+    }
+}
+
+std::string to_json(const std::vector<bench_result> &results) {
+    cudaDeviceProp properties;
+    int device = 0;
+    gpuErrchk(cudaGetDevice(&device));
+    gpuErrchk(cudaGetDeviceProperties(&properties, device));
+
+    std::stringstream strs;
+    strs.precision(9);
+    strs << "{\n  \"device\": \"" << properties.name << "\",\n";
+#ifdef USE_DOUBLE
+    strs << "  \"precision\": \"double\",\n";
+#else
+    strs << "  \"precision\": \"single\",\n";
+#endif
+    strs << "  \"results\": [";
+    for (size_t k = 0; k < results.size(); k++) {
+        auto &result = results[k];
+        auto times = result.times;
+        std::sort(times.begin(), times.end());
+        double total = 0;
+        for (double time : times)
+            total += time;
+        strs << ((k == 0) ? "\n" : ",\n") << "    {\"mesh\": \"" << result.mesh
+             << "\", \"benchmark\": \"" << result.benchmark
+             << "\", \"n_nodes\": " << result.n_nodes
+             << ", \"nnz\": " << result.nnz
+             << ", \"block_size\": " << result.block_size
+             << ", \"repeat\": " << times.size()
+             << ", \"mean_s\": " << total / times.size()
+             << ", \"median_s\": " << times[times.size() / 2]
+             << ", \"min_s\": " << times.front()
+             << ", \"max_s\": " << times.back();
+        if (result.iterations >= 0)
+            strs << ", \"iterations\": " << result.iterations;
+        strs << "}";
+    }
+    strs << "\n  ]\n}\n";
+    return strs.str();
+}
+
+std::vector<std::string> split(const std::string &list) {
+    std::vector<std::string> items;
+    std::stringstream strs(list);
+    std::string item;
+    while (std::getline(strs, item, ','))
+        items.push_back(item);
+    return items;
+}
+
+bench_options parse_options(int argc, char **argv) {
+    bench_options options;
+    for (int k = 1; k < argc; k++) {
+        std::string arg = argv[k];
+        if (k + 1 >= argc)
+            throw std::invalid_argument("Missing value for " + arg);
+        std::string value = argv[++k];
+        if (arg == "--size")
+            options.size = std::stoi(value);
+        else if (arg == "--repeat")
+            options.repeat = std::stoi(value);
+        else if (arg == "--dt")
+            options.dt = std::stod(value);
+        else if (arg == "--epsilon")
+            options.epsilon = std::stod(value);
+        else if (arg == "--output")
+            options.output = value;
+        else if (arg == "--node-order")
+            options.node_order = value;
+        else if (arg == "--mesh")
+            options.meshes = (value == "all")
+                                 ? std::vector<std::string>{"structured",
+                                                            "unstructured"}
+                                 : split(value);
+        else if (arg == "--block-sizes") {
+            options.block_sizes.clear();
+            for (auto &item : split(value))
+                options.block_sizes.push_back(std::stoi(item));
+        } else
+            throw std::invalid_argument("Unknown option " + arg);
+    }
+    if (options.size <= 0 || options.repeat <= 0)
+        throw std::invalid_argument("--size and --repeat must be positive");
+    if (options.node_order != "natural" && options.node_order != "shuffled" &&
+        options.node_order != "blocked")
+        throw std::invalid_argument("Unknown node order " + options.node_order);
+    return options;
+}
+
+int main(int argc, char **argv) {
+    bench_options options;
+    try {
+        options = parse_options(argc, argv);
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
+
+    std::vector<bench_result> results;
+    for (auto &meshName : options.meshes) {
+        if (meshName != "structured" && meshName != "unstructured") {
+            std::cerr << "Unknown mesh type " << meshName << "\n";
+            return 1;
+        }
+        auto mesh = make_mesh(options.size, meshName == "unstructured");
+        apply_node_order(mesh, options.node_order);
+        std::cerr << "Running " << meshName << " mesh (" << mesh.n_nodes()
+                  << " nodes)\n";
+        run_mesh(mesh, options, results);
+    }
+
+    auto json = to_json(results);
+    if (options.output == "") {
+        std::cout << json;
+    } else {
+        std::ofstream fout(options.output);
+        fout << json;
+    }
+    return 0;
+}
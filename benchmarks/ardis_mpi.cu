@@ -0,0 +1,226 @@
+// Distributed run of a Fisher-KPP front (A -> 2 A, 2 A -> A) on a P1 mesh,
+// with the mesh partitioned across the MPI ranks (see
+// distributed_simulation). Built with -DARDIS_USE_MPI=ON, e.g.
+//
+//     mpirun -np 4 ardis_mpi --size 256 --steps 100 --check 1
+//
+// The ranks of a node share its GPUs round robin. With --check 1 the root
+// also runs the same simulation on the whole mesh alone, and the run fails if
+// the results differ by more than --tolerance (relative to the largest
+// value).
+//
+// Usage: ardis_mpi [--size N] [--mesh PATH] [--steps S] [--dt DT]
+//                  [--diffusion D] [--epsilon EPS] [--output PATH]
+//                  [--per-rank 0|1] [--check 0|1] [--tolerance TOL]
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include <mpi.h>
+#include <string>
+#include <vector>
+
+#include "constants.hpp"
+#include "dataStructures/hd_data.hpp"
+#include "distributed/distributed_simulation.hpp"
+#include "geometry/mesh.hpp"
+#include "geometry/mesh_read_write.hpp"
+#include "geometry/p1_assembly.hpp"
+#include "helper/cuda/cuda_error_check.h"
+#include "matrixOperations/basic_operations.hpp"
+#include "reactionDiffusionSystem/simulation.hpp"
+
+struct mpi_options {
+    int size = 128;
+    std::string mesh = "";
+    int steps = 50;
+    T dt = 0.1;
+    T diffusion = 1;
+    T epsilon = 1e-8;
+    std::string output = "";
+    bool per_rank = false;
+    bool check = false;
+    T tolerance = 1e-6;
+};
+
+mpi_options parse_options(int argc, char **argv) {
+    mpi_options options;
+    for (int k = 1; k < argc; k++) {
+        std::string arg = argv[k];
+        if (k + 1 >= argc)
+            throw std::invalid_argument("Missing value for " + arg);
+        std::string value = argv[++k];
+        if (arg == "--size")
+            options.size = std::stoi(value);
+        else if (arg == "--mesh")
+            options.mesh = value;
+        else if (arg == "--steps")
+            options.steps = std::stoi(value);
+        else if (arg == "--dt")
+            options.dt = std::stod(value);
+        else if (arg == "--diffusion")
+            options.diffusion = std::stod(value);
+        else if (arg == "--epsilon")
+            options.epsilon = std::stod(value);
+        else if (arg == "--output")
+            options.output = value;
+        else if (arg == "--per-rank")
+            options.per_rank = std::stoi(value) != 0;
+        else if (arg == "--check")
+            options.check = std::stoi(value) != 0;
+        else if (arg == "--tolerance")
+            options.tolerance = std::stod(value);
+        else
+            throw std::invalid_argument("Unknown option " + arg);
+    }
+    if (options.size <= 0 || options.steps < 0)
+        throw std::invalid_argument("--size must be positive");
+    return options;
+}
+
+// Triangulated square [0, 10]^2 of size x size cells, on the host
+d_mesh make_square(int size) {
+    int n = (size + 1) * (size + 1);
+    d_mesh mesh(n, 2 * size * size, false);
+    T h = 10.0 / size;
+    for (int j = 0; j <= size; j++)
+        for (int i = 0; i <= size; i++) {
+            mesh.X.data[j * (size + 1) + i] = i * h;
+            mesh.Y.data[j * (size + 1) + i] = j * h;
+        }
+    int *triangles = mesh.triangles.data;
+    for (int j = 0; j < size; j++)
+        for (int i = 0; i < size; i++) {
+            int a = j * (size + 1) + i;
+            int b = a + 1, c = a + size + 2, d = a + size + 1;
+            int cell[6] = {a, b, c, a, c, d};
+            std::copy(cell, cell + 6, triangles + 6 * (j * size + i));
+        }
+    return mesh;
+}
+
+// 1 in a disc of radius 1 around (2, 2), 0 elsewhere
+std::vector<T> initial_values(d_mesh &mesh) {
+    std::vector<T> values(mesh.size());
+    for (int i = 0; i < mesh.size(); i++) {
+        T dx = mesh.X.data[i] - 2, dy = mesh.Y.data[i] - 2;
+        values[i] = (dx * dx + dy * dy < 1) ? 1 : 0;
+    }
+    return values;
+}
+
+void add_reactions(simulation &simu) {
+    simu.add_reaction("A -> 2 A", 1);
+    simu.add_reaction("2 A -> A", 1);
+}
+
+// Same simulation on the whole mesh, on the root alone
+std::vector<T> run_single(d_mesh &hostMesh, const std::vector<T> &initial,
+                          const mpi_options &options) {
+    d_mesh mesh(hostMesh, true);
+    d_spmatrix damping, stiffness;
+    assemble_p1_matrices(mesh, damping, stiffness);
+    hd_data<T> scale(options.diffusion);
+    scalar_mult(stiffness, scale(true));
+    simulation simu(mesh.size());
+    simu.load_dampness_matrix(damping);
+    simu.load_stiffness_matrix(stiffness);
+    simu.epsilon = options.epsilon;
+    simu.current_state.add_species("A");
+    simu.current_state.set_species("A", initial.data(), false);
+    add_reactions(simu);
+    simu.run(options.dt, options.steps);
+    std::vector<T> values(mesh.size());
+    gpuErrchk(cudaMemcpy(values.data(), simu.current_state.get_species("A").data,
+                         sizeof(T) * values.size(), cudaMemcpyDeviceToHost));
+    return values;
+}
+
+int main(int argc, char **argv) {
+    MPI_Init(&argc, &argv);
+    int rank, nRanks;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &nRanks);
+    mpi_options options;
+    try {
+        options = parse_options(argc, argv);
+    } catch (const std::exception &e) {
+        if (rank == 0)
+            std::cerr << e.what() << "\n";
+        MPI_Finalize();
+        return 1;
+    }
+
+    // The ranks of a node share its devices
+    MPI_Comm node;
+    MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, rank,
+                        MPI_INFO_NULL, &node);
+    int nodeRank, nDevices;
+    MPI_Comm_rank(node, &nodeRank);
+    MPI_Comm_free(&node);
+    gpuErrchk(cudaGetDeviceCount(&nDevices));
+    gpuErrchk(cudaSetDevice(nodeRank % nDevices));
+
+    int status = 0;
+    {
+        std::unique_ptr<d_mesh> mesh;
+        std::vector<T> initial;
+        if (rank == 0) {
+            mesh.reset(new d_mesh((options.mesh == "")
+                                      ? make_square(options.size)
+                                      : read_mesh(options.mesh, false)));
+            initial = initial_values(*mesh);
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        distributed_simulation simu(MPI_COMM_WORLD, mesh.get(),
+                                    options.diffusion);
+        simu.epsilon = options.epsilon;
+        simu.add_species("A");
+        simu.set_species("A", initial.data());
+        add_reactions(simu.local);
+        auto setup = std::chrono::steady_clock::now();
+        int nDone = simu.run(options.dt, options.steps);
+        auto end = std::chrono::steady_clock::now();
+
+        int maxGhosts = 0;
+        MPI_Reduce(&simu.layout.n_ghost, &maxGhosts, 1, MPI_INT, MPI_MAX, 0,
+                   MPI_COMM_WORLD);
+        if (rank == 0)
+            std::cout << "ranks " << nRanks << ", nodes "
+                      << simu.layout.n_global << ", max ghosts per rank "
+                      << maxGhosts << ", steps " << nDone << ", setup "
+                      << std::chrono::duration<double>(setup - start).count()
+                      << " s, run "
+                      << std::chrono::duration<double>(end - setup).count()
+                      << " s\n";
+        if (nDone != options.steps)
+            status = 1;
+
+        if (options.output != "") {
+            if (options.per_rank)
+                simu.write_snapshot(options.output);
+            else
+                simu.gather_snapshot(options.output);
+        }
+
+        auto values = simu.gather_species("A");
+        if (options.check && rank == 0) {
+            auto reference = run_single(*mesh, initial, options);
+            T maxValue = 0, maxDiff = 0;
+            for (size_t i = 0; i < values.size(); i++) {
+                maxValue = std::max(maxValue, std::abs(reference[i]));
+                maxDiff = std::max(maxDiff, std::abs(values[i] - reference[i]));
+            }
+            std::cout << "max difference with a single rank " << maxDiff
+                      << " (largest value " << maxValue << ")\n";
+            if (!(maxDiff <= options.tolerance * maxValue))
+                status = 1;
+        }
+    }
+    MPI_Bcast(&status, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    MPI_Finalize();
+    return status;
+}
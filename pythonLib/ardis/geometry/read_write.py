@@ -1,24 +1,19 @@
 import numpy as np
-from scipy.sparse import *
 import matplotlib.tri as tri
-from enum import Enum
-from ..convert import line_to_values
+from ..ardisLib import d_geometry as _d_geometry
 
 
-def read_mesh(path):
-    f = open(path, "r")
-    lines = f.readlines()
-    x,  y = [], []
-    for line in lines:
-        values = line_to_values(line)
-        if len(values) == 2:
-            x.append(values[0])
-            y.append(values[1])
-        else:
-            print("Could not read the following line: ", line)
+def read_mesh(path, native=False, device=False):
+    # The file is parsed by the library (text or binary format)
+    mesh = _d_geometry.read_mesh(path, device)
+    if native:
+        return mesh
+    triangles = mesh.triangles if mesh.n_triangles > 0 else None
+    return tri.Triangulation(mesh.x, mesh.y, triangles)
 
-    return tri.Triangulation(np.array(x), np.array(y))
 
-
-def write_mesh(path):
-    print("write_mesh function has not been implemented")
+def write_mesh(path, mesh, binary=False):
+    if isinstance(mesh, tri.Triangulation):
+        mesh = _d_geometry.d_mesh(np.asarray(mesh.x), np.asarray(mesh.y),
+                                  mesh.triangles, device=False)
+    _d_geometry.write_mesh(mesh, path, binary)
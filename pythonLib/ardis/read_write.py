@@ -80,19 +80,17 @@ def read_state(path):
     return imp_state
 
 
-def import_crn(simu, path):
-    data = json.load(open(path))
-    simu.add_species("trash", diffusion=False)
+def crn_text(data):
+    # Network of a JSON CRN in the text format of simulation.load_crn
+    lines = ["fixed trash"]
     inhibitors = []
     for sp in data['nodes']:
-        simu.add_species(sp['name'])
-        simu.set_species(sp['name'], np.ones(len(simu.state))*1.e-10)
-
+        lines.append("species " + sp['name'] + " = 1e-10")
         if (sp['name'][0] == 'I' and 'T' in sp['name']):
             inhibitors.append(sp['name'])
-            simu.add_mm_reaction(sp['name'] + "-> " + "trash", 300, 150)
+            lines.append(sp['name'] + " -> trash : mm 300, 150")
         else:
-            simu.add_mm_reaction(sp['name'] + "-> " + "trash", 300, 440)
+            lines.append(sp['name'] + " -> trash : mm 300, 440")
 
     for reac in data['connections']:
         sp_from = reac['from']
@@ -103,40 +101,41 @@ def import_crn(simu, path):
         template_bind_from_to = template + "~"+sp_from+"|"+sp_to
         template_bind_fromto = template + "~" + sp_from + "-" + sp_to
 
-        simu.add_species(template, diffusion=False)
-        simu.add_species(template_bind_from, diffusion=False)
-        simu.add_species(template_bind_to, diffusion=False)
-        simu.add_species(template_bind_from_to, diffusion=False)
-        simu.add_species(template_bind_fromto, diffusion=False)
-
-        simu.set_species(template, np.ones(
-            len(simu.state))*1e-2*reac['parameter'])
-        simu.set_species(template_bind_from, np.zeros(len(simu.state)))
-        simu.set_species(template_bind_to, np.zeros(len(simu.state)))
-        simu.set_species(template_bind_from_to, np.zeros(len(simu.state)))
-        simu.set_species(template_bind_fromto, np.zeros(len(simu.state)))
-
-        simu.add_reversible_reaction(
-            template+"+"+sp_from+"->"+template_bind_from, 0.2, 0.2)
-        simu.add_reversible_reaction(
-            template+"+"+sp_to+"->"+template_bind_to, 0.2, 0.2)
-        simu.add_reversible_reaction(
-            template_bind_to+"+"+sp_from+"->"+template_bind_from_to, 0.2, 0.2)
-        simu.add_reversible_reaction(
-            template_bind_from+"+"+sp_to+"->"+template_bind_from_to, 0.2, 0.2)
-        simu.add_mm_reaction(
-            template_bind_from+" -> "+template_bind_fromto, 1050, 80)
-        simu.add_mm_reaction(
-            template_bind_from_to+" -> "+template_bind_fromto + "+" + sp_to, 1050, 80)
-        simu.add_mm_reaction(
-            template_bind_fromto+" -> "+template_bind_from_to, 80, 30)
+        lines.append("fixed " + template + " = " +
+                     repr(1e-2*reac['parameter']))
+        lines.append("fixed " + " ".join([template_bind_from, template_bind_to,
+                                          template_bind_from_to,
+                                          template_bind_fromto]))
+
+        lines.append(template+"+"+sp_from+"<->" +
+                     template_bind_from + " : 0.2, 0.2")
+        lines.append(template+"+"+sp_to+"<->" +
+                     template_bind_to + " : 0.2, 0.2")
+        lines.append(template_bind_to+"+"+sp_from+"<->" +
+                     template_bind_from_to + " : 0.2, 0.2")
+        lines.append(template_bind_from+"+"+sp_to+"<->" +
+                     template_bind_from_to + " : 0.2, 0.2")
+        lines.append(template_bind_from+" -> " +
+                     template_bind_fromto + " : mm 1050, 80")
+        lines.append(template_bind_from_to+" -> " +
+                     template_bind_fromto + "+" + sp_to + " : mm 1050, 80")
+        lines.append(template_bind_fromto+" -> " +
+                     template_bind_from_to + " : mm 80, 30")
 
         if "I"+sp_from+"T"+sp_to in inhibitors:
             inhib = "I"+sp_from+"T"+sp_to
             template_inhibited = template + "~" + inhib
-            simu.add_species(template_inhibited, diffusion=False)
-            simu.add_reaction(template+"+"+inhib+"->"+template_inhibited, 0.2)
-            simu.add_reaction(template_bind_to+"+"+inhib +
-                              "->"+template_inhibited+" + "+sp_to, 0.2)
-            simu.add_reaction(template_bind_from+"+"+inhib +
-                              "->"+template_inhibited+" + "+sp_from, 0.2)
+            lines.append("fixed " + template_inhibited)
+            lines.append(template+"+"+inhib+"->" +
+                         template_inhibited + " : 0.2")
+            lines.append(template_bind_to+"+"+inhib +
+                         "->"+template_inhibited+" + "+sp_to + " : 0.2")
+            lines.append(template_bind_from+"+"+inhib +
+                         "->"+template_inhibited+" + "+sp_from + " : 0.2")
+    return "\n".join(lines)
+
+
+def import_crn(simu, path):
+    # The whole network is loaded at once, see simulation.load_crn
+    data = json.load(open(path))
+    return simu.load_crn(crn_text(data))
@@ -28,7 +28,8 @@ __host__ d_array<C>::d_array(const d_array<C> &m, bool copyToOtherMem)
         (m.is_device)
             ? (is_device) ? cudaMemcpyDeviceToDevice : cudaMemcpyDeviceToHost
             : (is_device) ? cudaMemcpyHostToDevice : cudaMemcpyHostToHost;
-    gpuErrchk(cudaMemcpy(data, m.data, sizeof(C) * n, memCpy));
+    if (n > 0)
+        gpuErrchk(cudaMemcpy(data, m.data, sizeof(C) * n, memCpy));
 }
 
 template <typename C>
@@ -36,6 +37,10 @@ __host__ d_array<C>::d_array(d_array<C> &&other) : d_array(0, other.is_device) {
     *this = other;
 }
 
+template <typename C>
+__host__ d_array<C>::d_array(C *deviceData, int n)
+    : n(n), is_device(true), data(deviceData) {}
+
 template <typename C>
 __host__ void d_array<C>::operator=(const d_array<C> &other) {
     if (is_device != other.is_device)
@@ -46,7 +51,8 @@ __host__ void d_array<C>::operator=(const d_array<C> &other) {
     mem_free();
     n = other.n;
     n_dataholders = other.n_dataholders;
-    *n_dataholders += 1;
+    if (n > 0 && n_dataholders)
+        *n_dataholders += 1;
     data = other.data;
     if (is_device)
         _device = other._device;
@@ -65,7 +71,7 @@ template <typename C> __host__ void d_array<C>::mem_alloc() {
         n_dataholders = new int[1];
         *n_dataholders = 1;
         if (is_device) {
-            gpuErrchk(cudaMalloc(&data, n * sizeof(T)));
+            gpuErrchk(cudaMalloc(&data, n * sizeof(C)));
             gpuErrchk(cudaMalloc(&_device, sizeof(d_array<C>)));
             gpuErrchk(cudaMemcpy(_device, this, sizeof(d_array<C>),
                                  cudaMemcpyHostToDevice));
@@ -76,13 +82,13 @@ template <typename C> __host__ void d_array<C>::mem_alloc() {
 }
 
 template <typename C> __host__ void d_array<C>::mem_free() {
-    if (n > 0) {
+    // Views own nothing
+    if (n > 0 && n_dataholders) {
         *n_dataholders -= 1;
         if (*n_dataholders == 0) {
             if (is_device) {
                 gpuErrchk(cudaFree(data));
                 gpuErrchk(cudaFree(_device));
-                gpuErrchk(cudaDeviceSynchronize());
             } else {
                 delete[] data;
             }
@@ -94,9 +100,8 @@ template <typename C>
 __host__ __device__ void d_array<C>::print(int printCount) const {
 #ifndef __CUDA_ARCH__
     if (is_device) {
-        gpuErrchk(cudaDeviceSynchronize());
         print_vectorK<<<1, 1>>>(*_device, printCount);
-        gpuErrchk(cudaDeviceSynchronize());
+        gpuErrchk(cudaStreamSynchronize(cudaStreamPerThread));
     } else
 #else
     if (!is_device)
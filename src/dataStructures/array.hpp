@@ -14,14 +14,19 @@ template <typename C> class d_array {
     int n;
     const bool is_device;
 
-    C *data;
+    C *data = nullptr;
 
-    d_array *_device;
+    d_array *_device = nullptr;
 
     // Constructors
     __host__ d_array(int = 0, bool = true);
     __host__ d_array(const d_array &, bool copyToOtherMem = false);
     __host__ d_array(d_array<C> &&);
+    // Non-owning view of n device values, owned elsewhere (no _device). It
+    // does not share the reference count of the owner: it dangles as soon as
+    // the owner frees its buffer, which resize() and operator= also do. Copy
+    // the owner with operator= to share its buffer instead.
+    __host__ d_array(C *deviceData, int n);
 
     // Manipulation
     __host__ void operator=(const d_array &);
@@ -47,6 +52,8 @@ template <typename C> class d_array {
 template class d_array<T>;
 template class d_array<bool>;
 template class d_array<int>;
+template class d_array<unsigned long long>;
+template class d_array<T *>;
 
 class d_vector : public d_array<T> {
   public:
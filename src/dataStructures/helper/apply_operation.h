@@ -1,6 +1,9 @@
+#pragma once
+
 #include <nvfunctional>
 
 #include "dataStructures/array.hpp"
+#include "reduce_operation.h"
 
 // typedef nvstd::function<T &> apply;
 // template <typename T1, typename T2> __global__ void inserter(T1 *f, T2 l) {
@@ -42,73 +45,28 @@ __host__ void apply_func_cond(d_array<C> &vector, d_array<bool> &booleans,
                                               *booleans._device, func);
 };
 
+// Reduces the values of A with func, init being the identity of func. A is
+// not modified.
 template <typename Reduction, typename C>
-__global__ void reduction_funcK(d_array<C> &A, int nValues, int shift,
-                                Reduction func) {
-    int i = threadIdx.x + blockIdx.x * blockDim.x;
-    if (i >= nValues)
-        return;
-    for (int exp = 0; (1 << exp) < blockDim.x; exp++) {
-        if (threadIdx.x % (2 << exp) == 0 &&
-            threadIdx.x + (1 << exp) < blockDim.x && i + (1 << exp) < nValues) {
-            A.data[shift * i] =
-                func(A.data[shift * i], A.data[shift * (i + (1 << exp))]);
-        }
-        __syncthreads();
-    }
-};
-
-template <typename Reduction, typename C>
-C reduction_func(d_array<C> &A, Reduction func) {
-    int nValues = A.n;
-    dim3Pair threadblock;
-    int shift = 1;
-    do {
-        threadblock = make1DThreadBlock(nValues);
-        ReductionK<<<threadblock.block.x, threadblock.thread.x>>>(
-            *A._device, nValues, shift, func);
-        gpuErrchk(cudaDeviceSynchronize());
-        nValues = int((nValues - 1) / threadblock.thread.x) + 1;
-        shift *= threadblock.thread.x;
-    } while (nValues > 1);
-    return 0;
+C reduction_func(d_array<C> &A, C init, Reduction func) {
+    return reduce(A, init, func);
 }
 
-template <typename Reduction, typename C>
-__global__ void reduction_func_condK(d_array<C> &A, d_array<bool> &booleans,
-                                     int nValues, int shift, Reduction func) {
-    int i = threadIdx.x + blockIdx.x * blockDim.x;
-    if (i >= nValues)
-        return;
-    for (int exp = 0; (1 << exp) < blockDim.x; exp++) {
-        if (threadIdx.x % (2 << exp) == 0 &&
-            threadIdx.x + (1 << exp) < blockDim.x && i + (1 << exp) < nValues) {
-            if (booleans.data[shift * (i + (1 << exp))] >
-                0) // TODO Make this as array of bool
-                if (booleans.data[shift * i])
-                    A.data[shift * i] = func(A.data[shift * i],
-                                             A.data[shift * (i + (1 << exp))]);
-                else
-                    A.data[shift * i] = A.data[shift * (i + (1 << exp))];
-            booleans.data[shift * i] = booleans.data[shift * i] ||
-                                       booleans.data[shift * (i + (1 << exp))];
-        }
-        __syncthreads();
+template <typename C> struct cond_load_op {
+    const C *data;
+    const bool *booleans;
+    C init;
+    __device__ C operator()(int i) const {
+        return (booleans[i]) ? data[i] : init;
     }
 };
 
+// Same, only on the values i where booleans[i] is true. Returns init when
+// none is.
 template <typename Reduction, typename C>
-C reduction_func_cond(d_array<C> &A, d_array<bool> &booleans, Reduction func) {
-    int nValues = A.n;
-    dim3Pair threadblock;
-    int shift = 1;
-    do {
-        threadblock = make1DThreadBlock(nValues);
-        reduction_func_condK<<<threadblock.block.x, threadblock.thread.x>>>(
-            *A._device, *booleans._device, nValues, shift, func);
-        gpuErrchk(cudaDeviceSynchronize());
-        nValues = int((nValues - 1) / threadblock.thread.x) + 1;
-        shift *= threadblock.thread.x;
-    } while (nValues > 1);
-    return 0;
+C reduction_func_cond(d_array<C> &A, d_array<bool> &booleans, C init,
+                      Reduction func) {
+    assert(A.is_device && booleans.is_device && A.n == booleans.n);
+    return transform_reduce(
+        A.n, cond_load_op<C>{A.data, booleans.data, init}, init, func);
 }
@@ -17,9 +17,14 @@ __device__ __host__ void convert_arrayBody(d_spmatrix *matrix,
     }
 }
 
-__global__ void convert_arrayK(d_spmatrix *matrix, int *toOrderArray,
-                               int *newArray, int newSize) {
-    convert_arrayBody(matrix, toOrderArray, newArray, newSize);
+// Counts the entries of each row (or column) at newArray[k + 1], the
+// compressed pointers are then the inclusive scan of newArray
+__global__ void count_entriesK(int nnz, const int *toOrderArray,
+                               int *newArray) {
+    int k = threadIdx.x + blockIdx.x * blockDim.x;
+    if (k >= nnz)
+        return;
+    atomicAdd(&newArray[toOrderArray[k] + 1], 1);
 }
 
 __device__ __host__ void check_orderedBody(int *array, int size, bool *_isOK) {
@@ -0,0 +1,206 @@
+#pragma once
+
+#include <cassert>
+#include <limits>
+#include <vector>
+
+#include "dataStructures/array.hpp"
+#include "helper/cuda/cuda_context.hpp"
+#include "helper/cuda/cuda_error_check.h"
+
+// Deterministic reductions: the values are cut in tiles of REDUCE_TILE_SIZE
+// consecutive values, each tile is reduced by one block in a fixed order
+// (every thread folds REDUCE_ITEMS values into a partial, then the partials
+// are combined by a tree), and the tile results are reduced the same way
+// until one value is left. The order of the operations only depends on the
+// number of values, never on the launch configuration or on the device, so
+// that floating point results are reproducible bit for bit.
+// The inputs are only read.
+// Only include from .cu files.
+
+#define REDUCE_BLOCK_SIZE 256
+#define REDUCE_ITEMS 8
+#define REDUCE_TILE_SIZE (REDUCE_BLOCK_SIZE * REDUCE_ITEMS)
+
+template <typename C> struct reduce_sum_op {
+    __host__ __device__ C operator()(const C &a, const C &b) const {
+        return a + b;
+    }
+};
+
+template <typename C> struct reduce_min_op {
+    __host__ __device__ C operator()(const C &a, const C &b) const {
+        return (b < a) ? b : a;
+    }
+};
+
+template <typename C> struct reduce_max_op {
+    __host__ __device__ C operator()(const C &a, const C &b) const {
+        return (a < b) ? b : a;
+    }
+};
+
+// Value and position of the maximum, the first position on ties. index is -1
+// for the identity.
+template <typename C> struct arg_value {
+    C value;
+    int index;
+};
+
+template <typename C> struct reduce_argmax_op {
+    __host__ __device__ arg_value<C> operator()(const arg_value<C> &a,
+                                                const arg_value<C> &b) const {
+        if (a.index < 0)
+            return b;
+        if (b.index < 0)
+            return a;
+        if (a.value < b.value || (a.value == b.value && b.index < a.index))
+            return b;
+        return a;
+    }
+};
+
+template <typename R> struct reduce_load_op {
+    const R *data;
+    __device__ R operator()(int i) const { return data[i]; }
+};
+
+// Loads of the segments of the partials of the previous pass
+template <typename R> struct reduce_segment_load_op {
+    const R *data;
+    int n;
+    __device__ R operator()(int segment, int i) const {
+        return data[segment * n + i];
+    }
+};
+
+template <typename Transform> struct reduce_single_segment_op {
+    Transform transform;
+    __device__ auto operator()(int segment, int i) const {
+        return transform(i);
+    }
+};
+
+// Block (b, s) reduces the values [b * REDUCE_TILE_SIZE, (b + 1) *
+// REDUCE_TILE_SIZE) of segment s into partials[s * gridDim.x + b]. Thread t
+// folds the values t, t + REDUCE_BLOCK_SIZE, ... of the tile, so that the
+// reads are coalesced.
+template <typename R, typename Load, typename Op>
+__global__ void reduceK(int n, Load load, R init, Op op, R *partials) {
+    __shared__ R buffer[REDUCE_BLOCK_SIZE];
+    int first = blockIdx.x * REDUCE_TILE_SIZE + threadIdx.x;
+    R value = init;
+    for (int k = 0; k < REDUCE_ITEMS; k++) {
+        int i = first + k * REDUCE_BLOCK_SIZE;
+        if (i < n)
+            value = op(value, load(blockIdx.y, i));
+    }
+    buffer[threadIdx.x] = value;
+    __syncthreads();
+    for (int stride = REDUCE_BLOCK_SIZE / 2; stride > 0; stride /= 2) {
+        if (threadIdx.x < stride)
+            buffer[threadIdx.x] =
+                op(buffer[threadIdx.x], buffer[threadIdx.x + stride]);
+        __syncthreads();
+    }
+    if (threadIdx.x == 0)
+        partials[blockIdx.y * gridDim.x + blockIdx.x] = buffer[0];
+}
+
+// Reduces each of the nSegments segments transform(s, 0), ..., transform(s, n
+// - 1) with op, in the same order as transform_reduce, and writes the results
+// to results, in host or device memory. init must be the identity of op.
+// Without synchronize, a copy to device memory is only queued on the stream
+// of the thread.
+template <typename R, typename Transform, typename Op>
+void segmented_transform_reduce(int n, int nSegments, Transform transform,
+                                R init, Op op, R *results,
+                                bool synchronize = true) {
+    if (nSegments <= 0)
+        return;
+    if (n <= 0) {
+        std::vector<R> inits(nSegments, init);
+        gpuErrchk(cudaMemcpy(results, inits.data(), sizeof(R) * nSegments,
+                             cudaMemcpyDefault));
+        return;
+    }
+    int nPartials = (n - 1) / REDUCE_TILE_SIZE + 1;
+    // Scratch of the thread context: no allocation, which would synchronize
+    // the device, in the common case
+    R *partials[2];
+    partials[0] = (R *)thread_context().scratch(2 * sizeof(R) * nPartials *
+                                                nSegments);
+    partials[1] = partials[0] + nPartials * nSegments;
+
+    reduceK<<<dim3(nPartials, nSegments), REDUCE_BLOCK_SIZE>>>(
+        n, transform, init, op, partials[0]);
+    gpuErrchk(cudaPeekAtLastError());
+    int current = 0;
+    while (nPartials > 1) {
+        n = nPartials;
+        nPartials = (n - 1) / REDUCE_TILE_SIZE + 1;
+        reduceK<<<dim3(nPartials, nSegments), REDUCE_BLOCK_SIZE>>>(
+            n, reduce_segment_load_op<R>{partials[current], n}, init, op,
+            partials[1 - current]);
+        gpuErrchk(cudaPeekAtLastError());
+        current = 1 - current;
+    }
+
+    gpuErrchk(cudaMemcpyAsync(results, partials[current],
+                              sizeof(R) * nSegments, cudaMemcpyDefault,
+                              cudaStreamPerThread));
+    if (synchronize)
+        gpuErrchk(cudaStreamSynchronize(cudaStreamPerThread));
+}
+
+// Reduces transform(0), ..., transform(n - 1) with op. init must be the
+// identity of op, it is returned when n is 0. transform is called on the
+// device (a functor or a __device__ lambda).
+template <typename R, typename Transform, typename Op>
+R transform_reduce(int n, Transform transform, R init, Op op) {
+    R result;
+    segmented_transform_reduce(
+        n, 1, reduce_single_segment_op<Transform>{transform}, init, op,
+        &result);
+    return result;
+}
+
+template <typename C, typename Op>
+C reduce(d_array<C> &array, C init, Op op) {
+    assert(array.is_device);
+    return transform_reduce(array.n, reduce_load_op<C>{array.data}, init, op);
+}
+
+template <typename C> C reduce_sum(d_array<C> &array) {
+    return reduce(array, C(0), reduce_sum_op<C>());
+}
+
+// +inf (or the largest value) on an empty array
+template <typename C> C reduce_min(d_array<C> &array) {
+    C init = std::numeric_limits<C>::has_infinity
+                 ? std::numeric_limits<C>::infinity()
+                 : std::numeric_limits<C>::max();
+    return reduce(array, init, reduce_min_op<C>());
+}
+
+// -inf (or the lowest value) on an empty array
+template <typename C> C reduce_max(d_array<C> &array) {
+    C init = std::numeric_limits<C>::has_infinity
+                 ? -std::numeric_limits<C>::infinity()
+                 : std::numeric_limits<C>::lowest();
+    return reduce(array, init, reduce_max_op<C>());
+}
+
+template <typename C> struct reduce_arg_load_op {
+    const C *data;
+    __device__ arg_value<C> operator()(int i) const {
+        return arg_value<C>{data[i], i};
+    }
+};
+
+// Index -1 on an empty array
+template <typename C> arg_value<C> reduce_argmax(d_array<C> &array) {
+    assert(array.is_device);
+    return transform_reduce(array.n, reduce_arg_load_op<C>{array.data},
+                            arg_value<C>{C(0), -1}, reduce_argmax_op<C>());
+}
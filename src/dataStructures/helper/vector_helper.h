@@ -21,6 +21,16 @@ __device__ __host__ void print_vectorBody(const d_array<int> &vector,
     printf("%i]\n", vector.data[vector.n - 1]);
 }
 
+__device__ __host__ void
+print_vectorBody(const d_array<unsigned long long> &vector, int printCount) {
+    printf("[ ");
+    for (int i = 0; i < vector.n - 1 && i < printCount; i++)
+        printf("%016llx, ", vector.data[i]);
+    if (printCount < vector.n - 1)
+        printf("... ");
+    printf("%016llx]\n", vector.data[vector.n - 1]);
+}
+
 __device__ __host__ void print_vectorBody(const d_array<bool> &vector,
                                           int printCount) {
     printf("Printing d_array<bool> has not been implemented\n");
@@ -41,6 +51,10 @@ __global__ void print_vectorK(const d_array<T> &vector, int printCount) {
 __global__ void print_vectorK(const d_array<int> &vector, int printCount) {
     print_vectorBody(vector, printCount);
 }
+__global__ void print_vectorK(const d_array<unsigned long long> &vector,
+                              int printCount) {
+    print_vectorBody(vector, printCount);
+}
 __global__ void print_vectorK(const d_array<bool> &vector, int printCount) {
     print_vectorBody(vector, printCount);
 }
@@ -66,7 +66,6 @@ __host__ __device__ void matrix_elm::updateIandJ() {
         hd_data<int> d_i(i);
         hd_data<int> d_j(j);
         updateIandJK<<<1, 1>>>(matrix->_device, &d_i(true), &d_j(true), k);
-        cudaDeviceSynchronize();
         d_i.update_host();
         d_j.update_host();
         i = d_i();
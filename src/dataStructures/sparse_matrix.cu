@@ -7,6 +7,7 @@
 #include "hd_data.hpp"
 #include "helper/cuda/cuda_error_check.h"
 #include "helper/cuda/cuda_reduction_operation.hpp"
+#include "helper/cuda/cuda_scan.hpp"
 #include "helper/cuda/cuda_thread_manager.hpp"
 #include "helper/cuda/cusolverSP_error_check.h"
 #include "helper/cuda/cusparse_error_check.h"
@@ -65,7 +66,6 @@ __host__ bool d_spmatrix::operator==(const d_spmatrix &other) {
         is_equalK<<<1, 1>>>(*(this->_device), *(other._device), result(true));
         result.update_host();
         return result();
-        gpuErrchk(cudaDeviceSynchronize());
     } else
         return is_equalBody(*this, other);
 }
@@ -142,7 +142,7 @@ __host__ __device__ void d_spmatrix::print(int printCount) const {
 #ifndef __CUDA_ARCH__
     if (is_device) {
         print_matrixK<<<1, 1>>>(_device, printCount);
-        gpuErrchk(cudaDeviceSynchronize());
+        gpuErrchk(cudaStreamSynchronize(cudaStreamPerThread));
     } else
 #endif
         print_matrixBody(this, printCount);
@@ -170,7 +170,7 @@ __host__ __device__ void d_spmatrix::add_element(int i, int j, T val) {
 #ifndef __CUDA_ARCH__
     if (is_device) {
         add_elementK<<<1, 1>>>(_device, i, j, val);
-        gpuErrchk(cudaDeviceSynchronize());
+        gpuErrchk(cudaPeekAtLastError());
     } else
 #endif
         add_elementBody(this, i, j, val);
@@ -209,8 +209,13 @@ __host__ void d_spmatrix::to_compress_dtype(matrix_type toType) {
     int *newArray;
     if (is_device) {
         gpuErrchk(cudaMalloc(&newArray, newSize * sizeof(int)));
-        convert_arrayK<<<1, 1>>>(_device, (toType == CSR) ? rowPtr : colPtr,
-                                 newArray, newSize);
+        gpuErrchk(cudaMemset(newArray, 0, newSize * sizeof(int)));
+        if (nnz > 0) {
+            auto tb = make1DThreadBlock(nnz);
+            count_entriesK<<<tb.block, tb.thread>>>(
+                nnz, (toType == CSR) ? rowPtr : colPtr, newArray);
+        }
+        inclusive_scan(newArray, newArray, newSize);
         cudaFree((toType == CSR) ? rowPtr : colPtr);
     } else {
         newArray = new int[newSize];
@@ -230,7 +235,6 @@ __host__ void d_spmatrix::to_compress_dtype(matrix_type toType) {
         loaded_elements = nnz; // Warning!! There is no assert to protect this!
         gpuErrchk(cudaMemcpy(_device, this, sizeof(d_spmatrix),
                              cudaMemcpyHostToDevice));
-        gpuErrchk(cudaDeviceSynchronize());
     }
 }
 
@@ -249,7 +253,6 @@ __host__ bool d_spmatrix::is_convertible_to(matrix_type toType) const {
         gpuErrchk(
             cudaMemcpy(&isOK, _isOK, sizeof(bool), cudaMemcpyDeviceToHost));
         gpuErrchk(cudaFree(_isOK));
-        gpuErrchk(cudaDeviceSynchronize());
     } else {
         check_orderedBody(analyzedArray, nnz, &isOK);
     }
@@ -291,11 +294,10 @@ __host__ bool d_spmatrix::is_symetric() {
         bool *_returnGpu;
         gpuErrchk(cudaMalloc(&_returnGpu, sizeof(bool)));
         is_symetricK<<<1, 1>>>(_device, _returnGpu);
-        gpuErrchk(cudaDeviceSynchronize());
+        gpuErrchk(cudaPeekAtLastError());
         gpuErrchk(cudaMemcpy(_return, _returnGpu, sizeof(bool),
                              cudaMemcpyDeviceToHost));
         gpuErrchk(cudaFree(_returnGpu));
-        gpuErrchk(cudaDeviceSynchronize());
     } else {
         is_symetricBody(this, _return);
     }
@@ -341,10 +343,7 @@ __host__ void d_spmatrix::make_datawidth() {
     d_vector width(rows);
     get_datawidthK<<<threadblock.block, threadblock.thread>>>(
         *_device, *(d_vector *)width._device);
-    ReductionOperation(width, maximum);
-    T dataWidthFloat;
-    cudaMemcpy(&dataWidthFloat, width.data, sizeof(T), cudaMemcpyDeviceToHost);
-    dataWidth = (int)dataWidthFloat;
+    dataWidth = (int)ReductionOperation(width, maximum);
 }
 
 __host__ d_spmatrix::~d_spmatrix() { mem_free(); }
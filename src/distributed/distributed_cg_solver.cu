@@ -0,0 +1,72 @@
+#ifdef ARDIS_USE_MPI
+
+#include <assert.h>
+#include <cmath>
+#include <cstdio>
+
+#include "distributed_cg_solver.hpp"
+#include "helper/cuda/cuda_error_check.h"
+#include "matrixOperations/basic_operations.hpp"
+
+distributed_cg_solver::distributed_cg_solver(distributed_layout &layout)
+    : layout(layout), q(layout.n_owned), r(layout.n_owned), p(layout.n_owned),
+      extended(layout.n_owned + layout.n_ghost) {}
+
+void distributed_cg_solver::multiply(d_spmatrix &mat, d_vector &x,
+                                     d_vector &y) {
+    assert(mat.rows == layout.n_owned &&
+           mat.cols == layout.n_owned + layout.n_ghost);
+    gpuErrchk(cudaMemcpy(extended.data, x.data, sizeof(T) * layout.n_owned,
+                         cudaMemcpyDeviceToDevice));
+    layout.exchange(extended);
+    dot(mat, extended, y);
+}
+
+// Same steps as cg_solver::cg_solve, with the reductions over all the ranks
+bool distributed_cg_solver::cg_solve(d_spmatrix &mat, d_vector &b,
+                                     d_vector &x, T epsilon) {
+    int n = layout.n_owned;
+    assert(b.n == n && x.n == n);
+
+    multiply(mat, x, q);
+    gpuErrchk(
+        cudaMemcpy(r.data, b.data, sizeof(T) * n, cudaMemcpyDeviceToDevice));
+    alpha() = -1;
+    alpha.update_dev();
+    vector_sum(r, q, alpha(true), r);
+    gpuErrchk(
+        cudaMemcpy(p.data, r.data, sizeof(T) * n, cudaMemcpyDeviceToDevice));
+    T diff = layout.dot(r, r);
+    T diff0 = diff;
+    residual0_last = sqrt(diff0);
+
+    int nIter = 0;
+    while (diff > epsilon * epsilon * diff0 && nIter < max_iter) {
+        nIter++;
+        multiply(mat, p, q);
+        T pq = layout.dot(p, q);
+        if (pq == 0)
+            break;
+        T a = diff / pq;
+        alpha() = a;
+        alpha.update_dev();
+        vector_sum(x, p, alpha(true), x);
+        alpha() = -a;
+        alpha.update_dev();
+        vector_sum(r, q, alpha(true), r);
+        T previous = diff;
+        diff = layout.dot(r, r);
+        if (diff == 0)
+            break;
+        alpha() = diff / previous;
+        alpha.update_dev();
+        vector_sum(r, p, alpha(true), p);
+    }
+
+    n_iter_last = nIter;
+    residual_last = sqrt(diff);
+    converged_last = !(diff > epsilon * epsilon * diff0);
+    return converged_last;
+}
+
+#endif
@@ -0,0 +1,43 @@
+#pragma once
+
+#ifdef ARDIS_USE_MPI
+
+#include "constants.hpp"
+#include "dataStructures/array.hpp"
+#include "dataStructures/hd_data.hpp"
+#include "dataStructures/sparse_matrix.hpp"
+#include "distributed_layout.hpp"
+
+// Conjugate gradient on a matrix distributed by rows: each rank holds the
+// rows of its owned nodes, with columns numbered as the nodes of its layout
+// (owned then ghosts). The products exchange the ghost values of the search
+// direction, and the dot products are reduced over all the ranks, so every
+// rank takes the same steps as a solve of the whole matrix.
+class distributed_cg_solver {
+  public:
+    distributed_layout &layout;
+    int max_iter = 1000;
+
+    distributed_cg_solver(distributed_layout &layout);
+
+    // Solves mat x = b (b and x hold the owned values). Stops once the norm
+    // of the residual is under epsilon times the norm of the initial one.
+    bool cg_solve(d_spmatrix &mat, d_vector &b, d_vector &x, T epsilon);
+    // y = mat x, x and y hold the owned values
+    void multiply(d_spmatrix &mat, d_vector &x, d_vector &y);
+
+    // Outcome of the last call to cg_solve
+    int n_iter_last = 0;
+    T residual0_last = 0;
+    T residual_last = 0;
+    bool converged_last = true;
+
+  private:
+    d_vector q;
+    d_vector r;
+    d_vector p;
+    d_vector extended; // Owned and ghost values
+    hd_data<T> alpha;
+};
+
+#endif
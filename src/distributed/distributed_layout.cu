@@ -0,0 +1,315 @@
+#ifdef ARDIS_USE_MPI
+
+#include <algorithm>
+#include <assert.h>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+#include "distributed_layout.hpp"
+#include "geometry/mesh_partition.hpp"
+#include "geometry/mesh_read_write.hpp"
+#include "helper/cuda/cuda_error_check.h"
+#include "helper/cuda/cuda_thread_manager.hpp"
+#include "matrixOperations/basic_operations.hpp"
+
+namespace {
+
+const int exchange_tag = 1;
+const int part_tag = 2;
+
+// Nodes of one rank and the triangles with one of them
+struct mesh_part {
+    int n_owned = 0;
+    std::vector<int> nodes; // Global index, owned then ghosts
+    std::vector<int> ghost_owner;
+    std::vector<T> x;
+    std::vector<T> y;
+    std::vector<int> triangles; // Local numbering
+};
+
+// local maps the global index to the local one, -1 outside of the part. It
+// is restored before returning.
+mesh_part make_part(d_mesh &mesh, const std::vector<int> &part,
+                    const std::vector<int> &ownedNodes,
+                    const std::vector<int> &partTriangles,
+                    std::vector<int> &local) {
+    mesh_part result;
+    const int *triangles = mesh.triangles.data;
+    result.nodes = ownedNodes;
+    result.n_owned = ownedNodes.size();
+    for (int k = 0; k < result.n_owned; k++)
+        local[ownedNodes[k]] = k;
+    std::vector<int> ghosts;
+    for (int t : partTriangles)
+        for (int c = 0; c < 3; c++) {
+            int v = triangles[3 * t + c];
+            if (local[v] == -1) {
+                local[v] = -2;
+                ghosts.push_back(v);
+            }
+        }
+    std::sort(ghosts.begin(), ghosts.end(), [&part](int a, int b) {
+        return part[a] < part[b] || (part[a] == part[b] && a < b);
+    });
+    for (int v : ghosts) {
+        local[v] = result.nodes.size();
+        result.nodes.push_back(v);
+        result.ghost_owner.push_back(part[v]);
+    }
+    for (int t : partTriangles)
+        for (int c = 0; c < 3; c++)
+            result.triangles.push_back(local[triangles[3 * t + c]]);
+    for (int v : result.nodes) {
+        result.x.push_back(mesh.X.data[v]);
+        result.y.push_back(mesh.Y.data[v]);
+        local[v] = -1;
+    }
+    return result;
+}
+
+void send_part(const mesh_part &part, int r, MPI_Comm comm) {
+    int sizes[3] = {part.n_owned, (int)part.nodes.size(),
+                    (int)part.triangles.size()};
+    MPI_Send(sizes, 3, MPI_INT, r, part_tag, comm);
+    MPI_Send(part.nodes.data(), sizes[1], MPI_INT, r, part_tag, comm);
+    MPI_Send(part.ghost_owner.data(), sizes[1] - sizes[0], MPI_INT, r,
+             part_tag, comm);
+    MPI_Send(part.x.data(), sizes[1], MPI_T, r, part_tag, comm);
+    MPI_Send(part.y.data(), sizes[1], MPI_T, r, part_tag, comm);
+    MPI_Send(part.triangles.data(), sizes[2], MPI_INT, r, part_tag, comm);
+}
+
+mesh_part receive_part(int root, MPI_Comm comm) {
+    mesh_part part;
+    int sizes[3];
+    MPI_Recv(sizes, 3, MPI_INT, root, part_tag, comm, MPI_STATUS_IGNORE);
+    part.n_owned = sizes[0];
+    part.nodes.resize(sizes[1]);
+    part.ghost_owner.resize(sizes[1] - sizes[0]);
+    part.x.resize(sizes[1]);
+    part.y.resize(sizes[1]);
+    part.triangles.resize(sizes[2]);
+    MPI_Recv(part.nodes.data(), sizes[1], MPI_INT, root, part_tag, comm,
+             MPI_STATUS_IGNORE);
+    MPI_Recv(part.ghost_owner.data(), sizes[1] - sizes[0], MPI_INT, root,
+             part_tag, comm, MPI_STATUS_IGNORE);
+    MPI_Recv(part.x.data(), sizes[1], MPI_T, root, part_tag, comm,
+             MPI_STATUS_IGNORE);
+    MPI_Recv(part.y.data(), sizes[1], MPI_T, root, part_tag, comm,
+             MPI_STATUS_IGNORE);
+    MPI_Recv(part.triangles.data(), sizes[2], MPI_INT, root, part_tag, comm,
+             MPI_STATUS_IGNORE);
+    return part;
+}
+
+} // namespace
+
+__global__ void gather_valuesK(int n, const int *nodes, const T *x, T *out) {
+    int k = threadIdx.x + blockIdx.x * blockDim.x;
+    if (k >= n)
+        return;
+    out[k] = x[nodes[k]];
+}
+
+distributed_layout::distributed_layout(MPI_Comm comm, d_mesh *globalMesh,
+                                       int root)
+    : comm(comm), root(root) {
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &n_ranks);
+    std::string error;
+    std::unique_ptr<d_mesh> hostMesh;
+    if (rank == root) {
+        if (!globalMesh || globalMesh->n_triangles() == 0)
+            error = "The root must give a mesh with triangles\n";
+        else if (globalMesh->size() < n_ranks)
+            error = "The mesh has fewer nodes than ranks\n";
+        else {
+            if (globalMesh->is_device()) {
+                hostMesh = std::make_unique<d_mesh>(*globalMesh, true);
+                globalMesh = hostMesh.get();
+            }
+            try {
+                check_triangles(*globalMesh);
+            } catch (const std::invalid_argument &e) {
+                error = e.what();
+            }
+        }
+    }
+    // The other ranks would wait for their part forever: the root tells them
+    // whether it fails, before sending anything, and they all throw with it
+    int length = error.size();
+    MPI_Bcast(&length, 1, MPI_INT, root, comm);
+    if (length > 0) {
+        error.resize(length);
+        MPI_Bcast(&error[0], length, MPI_CHAR, root, comm);
+        throw std::invalid_argument(error);
+    }
+    distribute((rank == root) ? globalMesh : nullptr);
+}
+
+// On the root, partitions the mesh (on the host, already checked) and sends
+// their part to the other ranks; elsewhere, receives it. Then sets up the
+// exchanges.
+void distributed_layout::distribute(d_mesh *globalMesh) {
+    mesh_part own;
+    if (rank == root) {
+        d_mesh &mesh = *globalMesh;
+        n_global = mesh.size();
+        auto part = rcb_partition(mesh, n_ranks);
+        std::vector<std::vector<int>> ownedNodes(n_ranks);
+        for (int v = 0; v < n_global; v++)
+            ownedNodes[part[v]].push_back(v);
+        // A triangle belongs to the parts of its nodes
+        std::vector<std::vector<int>> partTriangles(n_ranks);
+        for (int t = 0; t < mesh.n_triangles(); t++) {
+            int parts[3];
+            for (int c = 0; c < 3; c++)
+                parts[c] = part[mesh.triangles.data[3 * t + c]];
+            for (int c = 0; c < 3; c++)
+                if (std::find(parts, parts + c, parts[c]) == parts + c)
+                    partTriangles[parts[c]].push_back(t);
+        }
+
+        std::vector<int> local(n_global, -1);
+        for (int r = 0; r < n_ranks; r++) {
+            auto rankPart =
+                make_part(mesh, part, ownedNodes[r], partTriangles[r], local);
+            if (r == root)
+                own = std::move(rankPart);
+            else
+                send_part(rankPart, r, comm);
+            gather_counts.push_back(ownedNodes[r].size());
+            gather_offsets.push_back(gather_index.size());
+            gather_index.insert(gather_index.end(), ownedNodes[r].begin(),
+                                ownedNodes[r].end());
+        }
+    } else
+        own = receive_part(root, comm);
+    MPI_Bcast(&n_global, 1, MPI_INT, root, comm);
+
+    n_owned = own.n_owned;
+    n_ghost = own.nodes.size() - own.n_owned;
+    global_index = own.nodes;
+    d_mesh hostMesh(own.nodes.size(), own.triangles.size() / 3, false);
+    std::copy(own.x.begin(), own.x.end(), hostMesh.X.data);
+    std::copy(own.y.begin(), own.y.end(), hostMesh.Y.data);
+    std::copy(own.triangles.begin(), own.triangles.end(),
+              hostMesh.triangles.data);
+    mesh = std::make_shared<d_mesh>(hostMesh, true);
+    setup_exchange(own.ghost_owner);
+}
+
+// Each rank asks the owners of its ghosts for their values, once: the
+// answers give the values each rank sends at every exchange
+void distributed_layout::setup_exchange(const std::vector<int> &ghostOwner) {
+    std::vector<int> recvCounts(n_ranks, 0), sendCounts(n_ranks);
+    for (int owner : ghostOwner)
+        recvCounts[owner]++;
+    MPI_Alltoall(recvCounts.data(), 1, MPI_INT, sendCounts.data(), 1, MPI_INT,
+                 comm);
+    recv_offsets.assign(n_ranks + 1, 0);
+    send_offsets.assign(n_ranks + 1, 0);
+    for (int r = 0; r < n_ranks; r++) {
+        recv_offsets[r + 1] = recv_offsets[r] + recvCounts[r];
+        send_offsets[r + 1] = send_offsets[r] + sendCounts[r];
+    }
+    int nSend = send_offsets[n_ranks];
+    std::vector<int> wanted(nSend);
+    MPI_Alltoallv(global_index.data() + n_owned, recvCounts.data(),
+                  recv_offsets.data(), MPI_INT, wanted.data(),
+                  sendCounts.data(), send_offsets.data(), MPI_INT, comm);
+
+    // The owned nodes are sorted by global index
+    auto first = global_index.begin();
+    auto last = first + n_owned;
+    for (auto &v : wanted) {
+        auto found = std::lower_bound(first, last, v);
+        if (found == last || *found != v)
+            throw std::runtime_error("A ghost node is not owned by its rank\n");
+        v = found - first;
+    }
+    send_nodes.resize(nSend);
+    send_values.resize(nSend);
+    if (nSend > 0)
+        gpuErrchk(cudaMemcpy(send_nodes.data, wanted.data(),
+                             sizeof(int) * nSend, cudaMemcpyHostToDevice));
+    h_send.resize(nSend);
+    h_recv.resize(n_ghost);
+}
+
+void distributed_layout::exchange(d_vector &x) {
+    assert(x.n == n_owned + n_ghost);
+    int nSend = send_offsets[n_ranks];
+    if (nSend > 0) {
+        auto tb = make1DThreadBlock(nSend);
+        gather_valuesK<<<tb.block, tb.thread>>>(nSend, send_nodes.data, x.data,
+                                                send_values.data);
+        gpuErrchk(cudaPeekAtLastError());
+        gpuErrchk(cudaMemcpy(h_send.data(), send_values.data,
+                             sizeof(T) * nSend, cudaMemcpyDeviceToHost));
+    }
+    std::vector<MPI_Request> requests;
+    for (int r = 0; r < n_ranks; r++) {
+        int count = recv_offsets[r + 1] - recv_offsets[r];
+        if (count == 0)
+            continue;
+        requests.emplace_back();
+        MPI_Irecv(h_recv.data() + recv_offsets[r], count, MPI_T, r,
+                  exchange_tag, comm, &requests.back());
+    }
+    for (int r = 0; r < n_ranks; r++) {
+        int count = send_offsets[r + 1] - send_offsets[r];
+        if (count == 0)
+            continue;
+        requests.emplace_back();
+        MPI_Isend(h_send.data() + send_offsets[r], count, MPI_T, r,
+                  exchange_tag, comm, &requests.back());
+    }
+    MPI_Waitall(requests.size(), requests.data(), MPI_STATUSES_IGNORE);
+    if (n_ghost > 0)
+        gpuErrchk(cudaMemcpy(x.data + n_owned, h_recv.data(),
+                             sizeof(T) * n_ghost, cudaMemcpyHostToDevice));
+}
+
+T distributed_layout::dot(d_vector &x, d_vector &y) {
+    assert(x.n == n_owned && y.n == n_owned);
+    T local = 0;
+    T global = 0;
+    ::dot(x, y, local);
+    MPI_Allreduce(&local, &global, 1, MPI_T, MPI_SUM, comm);
+    return global;
+}
+
+std::vector<T> distributed_layout::gather(d_vector &x) {
+    assert(x.n >= n_owned);
+    std::vector<T> owned(n_owned);
+    gpuErrchk(cudaMemcpy(owned.data(), x.data, sizeof(T) * n_owned,
+                         cudaMemcpyDefault));
+    std::vector<T> buffer((rank == root) ? n_global : 0);
+    MPI_Gatherv(owned.data(), n_owned, MPI_T, buffer.data(),
+                gather_counts.data(), gather_offsets.data(), MPI_T, root, comm);
+    if (rank != root)
+        return {};
+    std::vector<T> result(n_global);
+    for (int k = 0; k < n_global; k++)
+        result[gather_index[k]] = buffer[k];
+    return result;
+}
+
+void distributed_layout::scatter(const T *global, d_vector &x) {
+    assert(x.n >= n_owned);
+    std::vector<T> buffer;
+    if (rank == root) {
+        buffer.resize(n_global);
+        for (int k = 0; k < n_global; k++)
+            buffer[k] = global[gather_index[k]];
+    }
+    std::vector<T> owned(n_owned);
+    MPI_Scatterv(buffer.data(), gather_counts.data(), gather_offsets.data(),
+                 MPI_T, owned.data(), n_owned, MPI_T, root, comm);
+    gpuErrchk(cudaMemcpy(x.data, owned.data(), sizeof(T) * n_owned,
+                         cudaMemcpyDefault));
+}
+
+#endif
@@ -0,0 +1,80 @@
+#pragma once
+
+#ifdef ARDIS_USE_MPI
+
+#include <memory>
+#include <mpi.h>
+#include <vector>
+
+#include "constants.hpp"
+#include "dataStructures/array.hpp"
+#include "geometry/mesh.hpp"
+
+#ifdef USE_DOUBLE
+#define MPI_T MPI_DOUBLE
+#else
+#define MPI_T MPI_FLOAT
+#endif
+
+// Nodes of one rank of a mesh partitioned across the ranks of a communicator
+// (see rcb_partition). The rank owns n_owned nodes, numbered first in the
+// order of their global index, and has a copy of the n_ghost nodes of the
+// other ranks that share a triangle with one of its nodes, numbered after,
+// grouped by owner. The rows of the owned nodes of an operator only refer to
+// owned and ghost nodes, so a product by a vector only needs the ghost values
+// to be refreshed from their owners (exchange).
+// The values are staged through the host, so any MPI implementation works,
+// CUDA-aware or not.
+class distributed_layout {
+  public:
+    MPI_Comm comm;
+    int root;
+    int rank;
+    int n_ranks;
+    int n_global = 0;
+    int n_owned = 0;
+    int n_ghost = 0;
+    // Global index of each node, owned then ghosts
+    std::vector<int> global_index;
+    // The owned and ghost nodes, and the triangles with an owned node, in the
+    // local numbering (device)
+    std::shared_ptr<d_mesh> mesh;
+
+    // Collective. The root gives the whole mesh, the other ranks nullptr:
+    // each rank only receives its part. If the mesh of the root has no
+    // triangles, fewer nodes than ranks or a triangle out of the mesh, every
+    // rank throws std::invalid_argument.
+    distributed_layout(MPI_Comm comm, d_mesh *globalMesh, int root = 0);
+    distributed_layout(const distributed_layout &) = delete;
+
+    // Refreshes the ghost values of x (n_owned + n_ghost values, device)
+    void exchange(d_vector &x);
+    // Dot product of two vectors of n_owned values, over all the ranks
+    T dot(d_vector &x, d_vector &y);
+
+    // The whole vector on the root, in the global numbering, from the
+    // n_owned values of x of each rank. Empty on the other ranks.
+    std::vector<T> gather(d_vector &x);
+    // The n_owned values of x of each rank, from the whole vector given on
+    // the root (ignored on the other ranks)
+    void scatter(const T *global, d_vector &x);
+
+  private:
+    // Ghost values received from each rank, and owned values sent to it:
+    // [offsets[r], offsets[r + 1])
+    std::vector<int> recv_offsets;
+    std::vector<int> send_offsets;
+    d_array<int> send_nodes; // Local index of the values sent
+    d_vector send_values;
+    std::vector<T> h_send;
+    std::vector<T> h_recv;
+    // On the root: the owned nodes of all the ranks, rank after rank
+    std::vector<int> gather_index;
+    std::vector<int> gather_counts;
+    std::vector<int> gather_offsets;
+
+    void distribute(d_mesh *globalMesh);
+    void setup_exchange(const std::vector<int> &ghostOwner);
+};
+
+#endif
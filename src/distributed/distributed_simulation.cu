@@ -0,0 +1,123 @@
+#ifdef ARDIS_USE_MPI
+
+#include <algorithm>
+
+#include "distributed_simulation.hpp"
+#include "geometry/p1_assembly.hpp"
+#include "helper/cuda/cuda_error_check.h"
+#include "matrixOperations/basic_operations.hpp"
+#include "reactionDiffusionSystem/state_read_write.hpp"
+
+// The matrices of the part are assembled over its owned and ghost nodes: the
+// rows of the owned nodes are complete, as the part has all their triangles,
+// but not those of the ghosts, which are dropped
+static void keep_leading_rows(d_spmatrix &mat, int nRows) {
+    int nnz;
+    gpuErrchk(cudaMemcpy(&nnz, mat.rowPtr + nRows, sizeof(int),
+                         cudaMemcpyDeviceToHost));
+    d_spmatrix rows(nRows, mat.cols, nnz, CSR);
+    gpuErrchk(cudaMemcpy(rows.rowPtr, mat.rowPtr, sizeof(int) * (nRows + 1),
+                         cudaMemcpyDeviceToDevice));
+    gpuErrchk(cudaMemcpy(rows.colPtr, mat.colPtr, sizeof(int) * nnz,
+                         cudaMemcpyDeviceToDevice));
+    gpuErrchk(cudaMemcpy(rows.data, mat.data, sizeof(T) * nnz,
+                         cudaMemcpyDeviceToDevice));
+    mat = rows;
+}
+
+distributed_simulation::distributed_simulation(MPI_Comm comm,
+                                               d_mesh *globalMesh,
+                                               T diffusion, bool lumped,
+                                               int root)
+    : layout(comm, globalMesh, root), local(layout.n_owned), solver(layout),
+      b(layout.n_owned) {
+    // Every owned node has a triangle
+    assemble_p1_matrices(*layout.mesh, damp_mat, stiff_mat, lumped);
+    hd_data<T> scale(diffusion);
+    scalar_mult(stiff_mat, scale(true));
+    keep_leading_rows(damp_mat, layout.n_owned);
+    keep_leading_rows(stiff_mat, layout.n_owned);
+}
+
+void distributed_simulation::add_species(const std::string &name,
+                                         bool diffusion) {
+    local.current_state.add_species(name, species_options(diffusion))
+        .fill(0);
+}
+
+void distributed_simulation::set_species(const std::string &name,
+                                         const T *global) {
+    layout.scatter(global, local.current_state.get_species(name));
+}
+
+std::vector<T> distributed_simulation::gather_species(const std::string &name) {
+    return layout.gather(local.current_state.get_species(name));
+}
+
+bool distributed_simulation::iterate_diffusion(T dt) {
+    if (last_used_dt != dt) {
+        hd_data<T> m(-dt);
+        matrix_sum(damp_mat, stiff_mat, m(true), diffusion_matrix);
+        last_used_dt = dt;
+    }
+    auto &state = local.current_state;
+    for (int i = 0; i < state.n_species(); i++) {
+        if (!state.options_holder.at(i).diffusion)
+            continue;
+        auto &species = state.vector_holder.at(i);
+        solver.multiply(damp_mat, species, b);
+        // The reductions make the outcome the same on every rank
+        if (!solver.cg_solve(diffusion_matrix, b, species, epsilon))
+            return false;
+    }
+    n_diffusion_steps++;
+    return true;
+}
+
+void distributed_simulation::iterate_reaction(T dt) {
+    local.iterate_reaction(dt);
+}
+
+bool distributed_simulation::iterate(T dt) {
+    if (!iterate_diffusion(dt))
+        return false;
+    iterate_reaction(dt);
+    return true;
+}
+
+int distributed_simulation::run(T dt, int nSteps) {
+    for (int step = 1; step <= nSteps; step++)
+        if (!iterate(dt))
+            return step - 1;
+    return std::max(nSteps, 0);
+}
+
+void distributed_simulation::write_snapshot(const std::string &path) {
+    std::vector<int> owned(layout.global_index.begin(),
+                           layout.global_index.begin() + layout.n_owned);
+    write_state_snapshot(local.current_state,
+                         path + "." + std::to_string(layout.rank), owned,
+                         layout.n_global);
+}
+
+void distributed_simulation::gather_snapshot(const std::string &path) {
+    auto &state = local.current_state;
+    state_snapshot snapshot;
+    snapshot.n_global_nodes = layout.n_global;
+    snapshot.names.resize(state.n_species());
+    for (auto &name : state.names)
+        snapshot.names.at(name.second) = name.first;
+    for (int s = 0; s < state.n_species(); s++) {
+        snapshot.diffusion.push_back(state.options_holder[s].diffusion);
+        auto values = layout.gather(state.vector_holder[s]);
+        snapshot.values.insert(snapshot.values.end(), values.begin(),
+                               values.end());
+    }
+    if (layout.rank != layout.root)
+        return;
+    for (int i = 0; i < layout.n_global; i++)
+        snapshot.global_index.push_back(i);
+    write_state_snapshot(snapshot, path);
+}
+
+#endif
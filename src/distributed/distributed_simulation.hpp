@@ -0,0 +1,65 @@
+#pragma once
+
+#ifdef ARDIS_USE_MPI
+
+#include <string>
+#include <vector>
+
+#include "constants.hpp"
+#include "dataStructures/sparse_matrix.hpp"
+#include "distributed_cg_solver.hpp"
+#include "distributed_layout.hpp"
+#include "reactionDiffusionSystem/simulation.hpp"
+
+// Simulation of a mesh partitioned across the ranks of a communicator. Each
+// rank assembles the P1 matrices of its part of the mesh and keeps the rows
+// of its owned nodes; its state only holds the owned nodes. The diffusion
+// step solves the whole system with distributed_cg_solver, and the reaction
+// step is the one of local, node by node, without communication.
+// All the methods are collective, and every rank must add the same species
+// and reactions.
+class distributed_simulation {
+  public:
+    distributed_layout layout;
+    // The owned nodes: species and reactions are added to it, and its
+    // reaction options (integrator, active set...) apply
+    simulation local;
+
+    d_spmatrix damp_mat;
+    d_spmatrix stiff_mat;
+    d_spmatrix diffusion_matrix;
+    distributed_cg_solver solver;
+    T epsilon = 1e-3;
+    int n_diffusion_steps = 0;
+
+    // The root gives the whole mesh, with its triangles, the other ranks
+    // nullptr. The stiffness matrix is scaled by diffusion.
+    distributed_simulation(MPI_Comm comm, d_mesh *globalMesh,
+                           T diffusion = 1, bool lumped = false,
+                           int root = 0);
+    distributed_simulation(const distributed_simulation &) = delete;
+
+    void add_species(const std::string &name, bool diffusion = true);
+    // From the values of the whole mesh given on the root
+    void set_species(const std::string &name, const T *global);
+    // The values of the whole mesh on the root, empty elsewhere
+    std::vector<T> gather_species(const std::string &name);
+
+    bool iterate_diffusion(T dt);
+    void iterate_reaction(T dt);
+    bool iterate(T dt);
+    // Returns the number of steps performed, see simulation::run
+    int run(T dt, int nSteps);
+
+    // Each rank writes the snapshot of its nodes (see state_read_write.hpp)
+    // to path.<rank>
+    void write_snapshot(const std::string &path);
+    // The root writes the snapshot of the whole mesh to path
+    void gather_snapshot(const std::string &path);
+
+  private:
+    d_vector b;
+    T last_used_dt = 0;
+};
+
+#endif
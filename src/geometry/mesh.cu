@@ -1,10 +1,71 @@
+#include <algorithm>
+
 #include "mesh.hpp"
 #include <cuda_runtime.h>
 
-d_mesh::d_mesh(int n) : X(n), Y(n) {}
-d_mesh::d_mesh(int n, T *x, T *y) : X(n), Y(n) {}
-d_mesh::d_mesh(d_vector &X, d_vector &Y) : X(X), Y(Y) { assert(X.n == Y.n); }
+d_mesh::d_mesh(int n, int nTriangles, bool is_device)
+    : X(n, is_device), Y(n, is_device), triangles(3 * nTriangles, is_device) {}
+d_mesh::d_mesh(int n, T *x, T *y) : X(n), Y(n), triangles(0) {
+    gpuErrchk(cudaMemcpy(X.data, x, sizeof(T) * n, cudaMemcpyHostToDevice));
+    gpuErrchk(cudaMemcpy(Y.data, y, sizeof(T) * n, cudaMemcpyHostToDevice));
+}
+d_mesh::d_mesh(d_vector &X, d_vector &Y)
+    : X(X), Y(Y), triangles(0, X.is_device) {
+    assert(X.n == Y.n);
+}
+d_mesh::d_mesh(const d_mesh &other, bool copyToOtherMem)
+    : X(other.X, copyToOtherMem), Y(other.Y, copyToOtherMem),
+      triangles(other.triangles, copyToOtherMem) {}
 
 __host__ __device__ int d_mesh::size() { return X.n; }
 
-d_mesh::~d_mesh() {}
\ No newline at end of file
+__host__ __device__ int d_mesh::n_triangles() { return triangles.n / 3; }
+
+mesh_grid &d_mesh::index() {
+    assert(is_device());
+    std::lock_guard<std::mutex> lock(index_mutex);
+    if (!grid.is_built())
+        grid.build(X, Y);
+    return grid;
+}
+
+void d_mesh::clear_index() {
+    std::lock_guard<std::mutex> lock(index_mutex);
+    grid.clear();
+    zone_masks.clear();
+}
+
+std::shared_ptr<zone_mask> d_mesh::cached_zone_mask(const std::string &key) {
+    std::lock_guard<std::mutex> lock(index_mutex);
+    for (auto it = zone_masks.begin(); it != zone_masks.end(); it++)
+        if (it->first == key) {
+            zone_masks.splice(zone_masks.begin(), zone_masks, it);
+            return it->second;
+        }
+    return nullptr;
+}
+
+void d_mesh::cache_zone_mask(const std::string &key,
+                             std::shared_ptr<zone_mask> mask) {
+    std::lock_guard<std::mutex> lock(index_mutex);
+    if (mask_capacity <= 0)
+        return;
+    zone_masks.remove_if([&key](auto &entry) { return entry.first == key; });
+    zone_masks.emplace_front(key, mask);
+    if ((int)zone_masks.size() > mask_capacity)
+        zone_masks.pop_back();
+}
+
+void d_mesh::clear_zone_masks() {
+    std::lock_guard<std::mutex> lock(index_mutex);
+    zone_masks.clear();
+}
+
+void d_mesh::set_zone_mask_capacity(int capacity) {
+    std::lock_guard<std::mutex> lock(index_mutex);
+    mask_capacity = capacity;
+    while ((int)zone_masks.size() > std::max(capacity, 0))
+        zone_masks.pop_back();
+}
+
+d_mesh::~d_mesh() {}
@@ -1,16 +1,50 @@
 #pragma once
 
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+
 #include "dataStructures/array.hpp"
+#include "mesh_grid.hpp"
+#include "zone_mask.hpp"
 
 class d_mesh {
   public:
     d_vector X;
     d_vector Y;
+    d_array<int> triangles; // 3 node indices per triangle, may be empty
+
+    // Spatial index of the nodes, built on first use by index() (which may
+    // be called from several threads), and masks of the zones already
+    // queried (see get_zone_mask). Call clear_index() after moving the nodes,
+    // while no other thread queries the mesh.
+    mesh_grid grid;
+    mesh_grid &index();
+    void clear_index();
+
+    // Mask cache, keyed by zone::key(). It keeps the zone_mask_capacity()
+    // masks used last (64 by default, 0 disables it)
+    std::shared_ptr<zone_mask> cached_zone_mask(const std::string &key);
+    void cache_zone_mask(const std::string &key,
+                         std::shared_ptr<zone_mask> mask);
+    void clear_zone_masks();
+    int zone_mask_capacity() const { return mask_capacity; }
+    void set_zone_mask_capacity(int capacity);
 
     __host__ __device__ int size();
+    __host__ __device__ int n_triangles();
+    __host__ bool is_device() const { return X.is_device; }
 
-    d_mesh(int n);
+    d_mesh(int n, int nTriangles = 0, bool is_device = true);
     d_mesh(int n, T *x, T *y); // Initialize from a host pointer
     d_mesh(d_vector &X, d_vector &Y);
+    d_mesh(const d_mesh &other, bool copyToOtherMem = false);
     ~d_mesh();
-};
\ No newline at end of file
+
+  private:
+    std::mutex index_mutex; // Guards grid and zone_masks
+    // The most recently used first
+    std::list<std::pair<std::string, std::shared_ptr<zone_mask>>> zone_masks;
+    int mask_capacity = 64;
+};
@@ -0,0 +1,190 @@
+#include <algorithm>
+#include <cmath>
+
+#include "helper/cuda/cuda_device_sort.hpp"
+#include "helper/cuda/cuda_error_check.h"
+#include "helper/cuda/cuda_scan.hpp"
+#include "helper/cuda/cuda_thread_manager.hpp"
+#include "mesh_grid.hpp"
+
+#define BBOX_BLOCK_SIZE 256
+#define BBOX_MAX_BLOCKS 256
+
+// Partial bounding boxes, one per block: xmin, ymin, xmax, ymax
+__global__ void bounding_boxK(const T *X, const T *Y, int n, T *partials) {
+    __shared__ T box[4][BBOX_BLOCK_SIZE];
+    T xmin = INFINITY, ymin = INFINITY, xmax = -INFINITY, ymax = -INFINITY;
+    for (int i = threadIdx.x + blockIdx.x * blockDim.x; i < n;
+         i += blockDim.x * gridDim.x) {
+        xmin = min(xmin, X[i]);
+        ymin = min(ymin, Y[i]);
+        xmax = max(xmax, X[i]);
+        ymax = max(ymax, Y[i]);
+    }
+    box[0][threadIdx.x] = xmin;
+    box[1][threadIdx.x] = ymin;
+    box[2][threadIdx.x] = xmax;
+    box[3][threadIdx.x] = ymax;
+    __syncthreads();
+    for (int stride = BBOX_BLOCK_SIZE / 2; stride > 0; stride /= 2) {
+        if (threadIdx.x < stride) {
+            int other = threadIdx.x + stride;
+            box[0][threadIdx.x] = min(box[0][threadIdx.x], box[0][other]);
+            box[1][threadIdx.x] = min(box[1][threadIdx.x], box[1][other]);
+            box[2][threadIdx.x] = max(box[2][threadIdx.x], box[2][other]);
+            box[3][threadIdx.x] = max(box[3][threadIdx.x], box[3][other]);
+        }
+        __syncthreads();
+    }
+    if (threadIdx.x < 4)
+        partials[4 * blockIdx.x + threadIdx.x] = box[threadIdx.x][0];
+}
+
+__device__ inline int cell_coordinate(T x, T origin, T cellSize, int nCells) {
+    int c = floor((x - origin) / cellSize);
+    return (c < 0) ? 0 : (c >= nCells) ? nCells - 1 : c;
+}
+
+__global__ void count_cellsK(const T *X, const T *Y, int n, T x0, T y0,
+                             T cellSize, int nx, int ny, int *cells,
+                             int *cellStart) {
+    int i = threadIdx.x + blockIdx.x * blockDim.x;
+    if (i >= n)
+        return;
+    int cell = cell_coordinate(Y[i], y0, cellSize, ny) * nx +
+               cell_coordinate(X[i], x0, cellSize, nx);
+    cells[i] = cell;
+    atomicAdd(&cellStart[cell + 1], 1);
+}
+
+__global__ void fill_cellsK(const int *cells, int n, const int *cellStart,
+                            int *cursor, int *sortedNodes) {
+    int i = threadIdx.x + blockIdx.x * blockDim.x;
+    if (i >= n)
+        return;
+    int cell = cells[i];
+    sortedNodes[cellStart[cell] + atomicAdd(&cursor[cell], 1)] = i;
+}
+
+// fill_cellsK places the nodes of a cell in the order of their atomicAdd:
+// sorting them by index makes sorted_nodes (and the order of the candidates)
+// the same on every build
+__global__ void sort_cellsK(const int *cellStart, int nCells,
+                            int *sortedNodes) {
+    int c = threadIdx.x + blockIdx.x * blockDim.x;
+    if (c >= nCells)
+        return;
+    insertion_sort(sortedNodes + cellStart[c], cellStart[c + 1] - cellStart[c]);
+}
+
+void mesh_grid::build(d_vector &X, d_vector &Y) {
+    assert(X.is_device && X.n == Y.n);
+    clear();
+    int n = X.n;
+    if (n == 0)
+        return;
+
+    int nBlocks = std::min((n - 1) / BBOX_BLOCK_SIZE + 1, BBOX_MAX_BLOCKS);
+    d_vector partials(4 * nBlocks);
+    bounding_boxK<<<nBlocks, BBOX_BLOCK_SIZE>>>(X.data, Y.data, n,
+                                                partials.data);
+    std::vector<T> h_partials(4 * nBlocks);
+    gpuErrchk(cudaMemcpy(h_partials.data(), partials.data,
+                         sizeof(T) * 4 * nBlocks, cudaMemcpyDeviceToHost));
+    T box[4] = {h_partials[0], h_partials[1], h_partials[2], h_partials[3]};
+    for (int b = 1; b < nBlocks; b++) {
+        box[0] = std::min(box[0], h_partials[4 * b]);
+        box[1] = std::min(box[1], h_partials[4 * b + 1]);
+        box[2] = std::max(box[2], h_partials[4 * b + 2]);
+        box[3] = std::max(box[3], h_partials[4 * b + 3]);
+    }
+
+    // About 2 nodes per cell on a uniformly filled box
+    T width = box[2] - box[0];
+    T height = box[3] - box[1];
+    int nCellsTarget = std::max(1, n / 2);
+    if (width > 0 && height > 0)
+        cell_size = std::sqrt(width * height / nCellsTarget);
+    else if (width > 0 || height > 0)
+        cell_size = std::max(width, height) / nCellsTarget;
+    else
+        cell_size = 1;
+    x0 = box[0];
+    y0 = box[1];
+    nx = std::min((int)std::floor(width / cell_size) + 1, nCellsTarget);
+    ny = std::min((int)std::floor(height / cell_size) + 1, nCellsTarget / nx);
+    ny = std::max(ny, 1);
+    int nCells = nx * ny;
+
+    cell_start.resize(nCells + 1);
+    sorted_nodes.resize(n);
+    d_array<int> cells(n);
+    d_array<int> cursor(nCells);
+    cell_start.fill(0);
+    cursor.fill(0);
+
+    auto tb = make1DThreadBlock(n);
+    count_cellsK<<<tb.block, tb.thread>>>(X.data, Y.data, n, x0, y0,
+                                          cell_size, nx, ny, cells.data,
+                                          cell_start.data);
+    inclusive_scan(cell_start);
+    fill_cellsK<<<tb.block, tb.thread>>>(cells.data, n, cell_start.data,
+                                         cursor.data, sorted_nodes.data);
+    auto tbCells = make1DThreadBlock(nCells);
+    sort_cellsK<<<tbCells.block, tbCells.thread>>>(cell_start.data, nCells,
+                                                   sorted_nodes.data);
+
+    h_cell_start.resize(nCells + 1);
+    gpuErrchk(cudaMemcpy(h_cell_start.data(), cell_start.data,
+                         sizeof(int) * (nCells + 1), cudaMemcpyDeviceToHost));
+}
+
+void mesh_grid::clear() {
+    nx = 0;
+    ny = 0;
+    cell_start.resize(0);
+    sorted_nodes.resize(0);
+    h_cell_start.clear();
+}
+
+grid_candidates mesh_grid::candidates(const bounding_box &box) {
+    assert(is_built());
+    grid_candidates result;
+    // Cell range covered by the box, clamped like the nodes (the border cells
+    // also hold the nodes beyond them). Clamping happens before the
+    // conversion to int so that infinite boxes are supported.
+    auto cellRange = [this](T low, T high, T origin, int nCells, int &c0,
+                            int &c1) {
+        T f0 = std::floor((low - origin) / cell_size);
+        T f1 = std::floor((high - origin) / cell_size);
+        if (!(f0 <= f1))
+            return false;
+        c0 = (f0 < 0) ? 0 : (f0 >= nCells) ? nCells - 1 : (int)f0;
+        c1 = (f1 < 0) ? 0 : (f1 >= nCells) ? nCells - 1 : (int)f1;
+        return true;
+    };
+    int i0, i1, j0, j1;
+    if (!cellRange(box.x0, box.x1, x0, nx, i0, i1) ||
+        !cellRange(box.y0, box.y1, y0, ny, j0, j1))
+        return result;
+
+    std::vector<int> offsets{0}, starts;
+    for (int j = j0; j <= j1; j++) {
+        int begin = h_cell_start[j * nx + i0];
+        int end = h_cell_start[j * nx + i1 + 1];
+        if (end > begin) {
+            starts.push_back(begin);
+            offsets.push_back(offsets.back() + end - begin);
+        }
+    }
+    result.n_ranges = starts.size();
+    result.n_candidates = offsets.back();
+    if (result.n_candidates == 0)
+        return result;
+    offsets.insert(offsets.end(), starts.begin(), starts.end());
+    result.ranges.resize(offsets.size());
+    gpuErrchk(cudaMemcpy(result.ranges.data, offsets.data(),
+                         sizeof(int) * offsets.size(),
+                         cudaMemcpyHostToDevice));
+    return result;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <vector>
+
+#include "dataStructures/array.hpp"
+#include "point_2d.hpp"
+
+// Nodes of a mesh that may lie in a bounding box: a list of ranges of
+// mesh_grid::sorted_nodes, one per row of grid cells. Device layout of
+// ranges: offsets[n_ranges + 1] (prefix sums of the range lengths), then the
+// first position of each range.
+struct grid_candidates {
+    int n_ranges = 0;
+    int n_candidates = 0;
+    d_array<int> ranges;
+};
+
+// k'th candidate node
+__device__ inline int candidate_node(const int *sortedNodes, const int *ranges,
+                                     int nRanges, int k) {
+    int low = 0;
+    int high = nRanges - 1;
+    while (low < high) {
+        int mid = (low + high + 1) / 2;
+        if (ranges[mid] <= k)
+            low = mid;
+        else
+            high = mid - 1;
+    }
+    return sortedNodes[ranges[nRanges + 1 + low] + k - ranges[low]];
+}
+
+// Uniform grid over the bounding box of the mesh nodes, with about 2 nodes
+// per cell. The nodes are sorted by cell (and by index within a cell), so
+// that the nodes of a row of consecutive cells are contiguous.
+class mesh_grid {
+  public:
+    T x0 = 0, y0 = 0;
+    T cell_size = 1;
+    int nx = 0, ny = 0;
+
+    d_array<int> cell_start;   // nx * ny + 1 offsets in sorted_nodes
+    d_array<int> sorted_nodes;
+
+    bool is_built() const { return nx > 0; }
+    void build(d_vector &X, d_vector &Y);
+    void clear();
+
+    // Ranges of nodes whose cells intersect the box
+    grid_candidates candidates(const bounding_box &box);
+
+  private:
+    std::vector<int> h_cell_start;
+};
@@ -0,0 +1,175 @@
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+
+#include "mesh_partition.hpp"
+
+// Assigns the parts [firstPart, firstPart + nParts) to the nodes of
+// [first, last)
+static void bisect(const T *x, const T *y, int *first, int *last,
+                   int firstPart, int nParts, std::vector<int> &part) {
+    if (nParts == 1) {
+        for (int *node = first; node != last; node++)
+            part[*node] = firstPart;
+        return;
+    }
+    T xMin = x[*first], xMax = xMin, yMin = y[*first], yMax = yMin;
+    for (int *node = first; node != last; node++) {
+        xMin = std::min(xMin, x[*node]);
+        xMax = std::max(xMax, x[*node]);
+        yMin = std::min(yMin, y[*node]);
+        yMax = std::max(yMax, y[*node]);
+    }
+    const T *c = (xMax - xMin >= yMax - yMin) ? x : y;
+    int nLeft = nParts / 2;
+    int *middle = first + (long long)(last - first) * nLeft / nParts;
+    // Ties are broken by the index, so that the result is deterministic
+    std::nth_element(first, middle, last, [c](int a, int b) {
+        return c[a] < c[b] || (c[a] == c[b] && a < b);
+    });
+    bisect(x, y, first, middle, firstPart, nLeft, part);
+    bisect(x, y, middle, last, firstPart + nLeft, nParts - nLeft, part);
+}
+
+std::vector<int> rcb_partition(const T *x, const T *y, int n, int nParts) {
+    if (nParts < 1)
+        throw std::invalid_argument("The number of parts must be positive\n");
+    std::vector<int> part(n, 0);
+    if (n == 0)
+        return part;
+    std::vector<int> nodes(n);
+    for (int i = 0; i < n; i++)
+        nodes[i] = i;
+    bisect(x, y, nodes.data(), nodes.data() + n, 0, nParts, part);
+    return part;
+}
+
+std::vector<int> rcb_partition(d_mesh &mesh, int nParts) {
+    if (mesh.is_device()) {
+        d_mesh hostMesh(mesh, true);
+        return rcb_partition(hostMesh, nParts);
+    }
+    return rcb_partition(mesh.X.data, mesh.Y.data, mesh.size(), nParts);
+}
+
+// The orderings index per-node arrays with the triangle indices
+static void check_triangle_nodes(const int *triangles, int nTriangles, int n) {
+    for (int k = 0; k < 3 * nTriangles; k++)
+        if (triangles[k] < 0 || triangles[k] >= n)
+            throw std::invalid_argument(
+                "Triangle " + std::to_string(k / 3) + " refers to node " +
+                std::to_string(triangles[k]) + ", the mesh has " +
+                std::to_string(n) + " nodes\n");
+}
+
+std::vector<int> block_ordering(const T *x, const T *y, int n,
+                                const int *triangles, int nTriangles,
+                                int blockSize) {
+    if (blockSize < 1)
+        throw std::invalid_argument("The block size must be positive\n");
+    check_triangle_nodes(triangles, nTriangles, n);
+    std::vector<int> order;
+    order.reserve(n);
+    if (n == 0)
+        return order;
+    int nBlocks = (n + blockSize - 1) / blockSize;
+    auto block = rcb_partition(x, y, n, nBlocks);
+
+    // Edges inside the blocks, as adjacency lists in CSR
+    std::vector<int> adjPtr(n + 1, 0), adj;
+    auto forInnerEdges = [&](auto f) {
+        for (int t = 0; t < nTriangles; t++)
+            for (int k = 0; k < 3; k++) {
+                int a = triangles[3 * t + k];
+                int b = triangles[3 * t + (k + 1) % 3];
+                if (block[a] == block[b]) {
+                    f(a, b);
+                    f(b, a);
+                }
+            }
+    };
+    forInnerEdges([&](int a, int) { adjPtr[a + 1]++; });
+    std::partial_sum(adjPtr.begin(), adjPtr.end(), adjPtr.begin());
+    adj.resize(adjPtr[n]);
+    std::vector<int> fill(adjPtr.begin(), adjPtr.end() - 1);
+    forInnerEdges([&](int a, int b) { adj[fill[a]++] = b; });
+
+    // The nodes of each block, by index
+    std::vector<int> blockPtr(nBlocks + 1, 0), blockNodes(n);
+    for (int i = 0; i < n; i++)
+        blockPtr[block[i] + 1]++;
+    std::partial_sum(blockPtr.begin(), blockPtr.end(), blockPtr.begin());
+    fill.assign(blockPtr.begin(), blockPtr.end() - 1);
+    for (int i = 0; i < n; i++)
+        blockNodes[fill[block[i]]++] = i;
+
+    std::vector<bool> visited(n, false);
+    for (int b = 0; b < nBlocks; b++)
+        for (int k = blockPtr[b]; k < blockPtr[b + 1]; k++) {
+            int start = blockNodes[k];
+            if (visited[start])
+                continue;
+            // The order vector is the queue of the traversal
+            size_t head = order.size();
+            order.push_back(start);
+            visited[start] = true;
+            for (; head < order.size(); head++) {
+                int node = order[head];
+                for (int e = adjPtr[node]; e < adjPtr[node + 1]; e++)
+                    if (!visited[adj[e]]) {
+                        visited[adj[e]] = true;
+                        order.push_back(adj[e]);
+                    }
+            }
+        }
+    return order;
+}
+
+std::vector<int> block_ordering(d_mesh &mesh, int blockSize) {
+    if (mesh.is_device()) {
+        d_mesh hostMesh(mesh, true);
+        return block_ordering(hostMesh, blockSize);
+    }
+    return block_ordering(mesh.X.data, mesh.Y.data, mesh.size(),
+                          mesh.triangles.data, mesh.n_triangles(), blockSize);
+}
+
+d_mesh reorder_mesh(d_mesh &mesh, const std::vector<int> &order) {
+    if (mesh.is_device()) {
+        d_mesh hostMesh(mesh, true);
+        return d_mesh(reorder_mesh(hostMesh, order), true);
+    }
+    int n = mesh.size();
+    if ((int)order.size() != n)
+        throw std::invalid_argument("The order must have one entry per node\n");
+    std::vector<int> newIndex(n, -1);
+    for (int i = 0; i < n; i++) {
+        if (order[i] < 0 || order[i] >= n || newIndex[order[i]] != -1)
+            throw std::invalid_argument("The order is not a permutation\n");
+        newIndex[order[i]] = i;
+    }
+
+    int nTriangles = mesh.n_triangles();
+    check_triangle_nodes(mesh.triangles.data, nTriangles, n);
+    d_mesh reordered(n, nTriangles, false);
+    for (int i = 0; i < n; i++) {
+        reordered.X.data[i] = mesh.X.data[order[i]];
+        reordered.Y.data[i] = mesh.Y.data[order[i]];
+    }
+    const int *triangles = mesh.triangles.data;
+    std::vector<int> first(nTriangles), sorted(nTriangles);
+    for (int t = 0; t < nTriangles; t++) {
+        first[t] = std::min({newIndex[triangles[3 * t]],
+                             newIndex[triangles[3 * t + 1]],
+                             newIndex[triangles[3 * t + 2]]});
+        sorted[t] = t;
+    }
+    std::stable_sort(sorted.begin(), sorted.end(),
+                     [&first](int a, int b) { return first[a] < first[b]; });
+    for (int t = 0; t < nTriangles; t++)
+        for (int k = 0; k < 3; k++)
+            reordered.triangles.data[3 * t + k] =
+                newIndex[triangles[3 * sorted[t] + k]];
+    return reordered;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <vector>
+
+#include "constants.hpp"
+#include "mesh.hpp"
+
+// Recursive coordinate bisection of the nodes of a mesh: the nodes are cut
+// across the longest side of their bounding box, at the node that splits them
+// in proportion to the number of parts on each side, and each side is cut
+// again until there are nParts parts. The parts have sizes differing by at
+// most one and are compact, so that few of their nodes have neighbors in
+// other parts.
+// Returns the part of each node.
+std::vector<int> rcb_partition(const T *x, const T *y, int n, int nParts);
+std::vector<int> rcb_partition(d_mesh &mesh, int nParts);
+
+// Node ordering by blocks of about blockSize nodes: the blocks are the parts
+// of rcb_partition, taken in the order of the bisection so that consecutive
+// blocks are neighbors, and the nodes of a block are numbered by a breadth
+// first traversal of the triangle edges inside the block (by index without
+// triangles), which keeps each connected piece of a block together.
+// Renumbering the mesh with it before assembling the matrices makes the rows
+// handled by a thread block read a compact range of the vectors.
+// Returns order, where order[i] is the node that becomes node i. Throws
+// std::invalid_argument if a triangle refers to a node out of [0, n).
+std::vector<int> block_ordering(const T *x, const T *y, int n,
+                                const int *triangles, int nTriangles,
+                                int blockSize = 256);
+std::vector<int> block_ordering(d_mesh &mesh, int blockSize = 256);
+
+// Copy of the mesh, in the same memory, with node i being node order[i] of
+// mesh. The triangles are renumbered and sorted by their first node, so that
+// the assembly visits them block by block. Throws std::invalid_argument if
+// order is not a permutation of the nodes or a triangle refers to a node out
+// of the mesh.
+d_mesh reorder_mesh(d_mesh &mesh, const std::vector<int> &order);
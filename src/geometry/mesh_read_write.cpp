@@ -0,0 +1,359 @@
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#include "mesh_read_write.hpp"
+
+namespace {
+
+const char mesh_magic[4] = {'A', 'R', 'D', 'M'};
+const int32_t mesh_version = 1;
+
+struct mesh_header {
+    char magic[4];
+    int32_t version;
+    int32_t scalar_size;
+    int32_t reserved;
+    int64_t n_nodes;
+    int64_t n_triangles;
+};
+static_assert(sizeof(mesh_header) == 32, "Unexpected mesh header layout");
+
+[[noreturn]] void mesh_error(const std::string &path,
+                             const std::string &message) {
+    throw std::runtime_error("Mesh file " + path + ": " + message);
+}
+
+struct file_closer {
+    void operator()(FILE *file) { fclose(file); }
+};
+typedef std::unique_ptr<FILE, file_closer> file_ptr;
+
+file_ptr open_file(const std::string &path, const char *mode) {
+    file_ptr file(fopen(path.c_str(), mode));
+    if (!file)
+        mesh_error(path, std::string("cannot open the file (") +
+                             strerror(errno) + ")");
+    return file;
+}
+
+d_mesh make_host_mesh(const std::vector<T> &x, const std::vector<T> &y,
+                      const std::vector<int> &triangles) {
+    d_mesh mesh(x.size(), triangles.size() / 3, false);
+    std::copy(x.begin(), x.end(), mesh.X.data);
+    std::copy(y.begin(), y.end(), mesh.Y.data);
+    std::copy(triangles.begin(), triangles.end(), mesh.triangles.data);
+    return mesh;
+}
+
+// Empty if all the triangles refer to nodes of the mesh (on the host)
+std::string triangle_error(d_mesh &mesh) {
+    int n = mesh.size();
+    for (int k = 0; k < mesh.triangles.n; k++)
+        if (mesh.triangles.data[k] < 0 || mesh.triangles.data[k] >= n)
+            return "triangle " + std::to_string(k / 3) + " refers to node " +
+                   std::to_string(mesh.triangles.data[k]) + ", the mesh has " +
+                   std::to_string(n) + " nodes";
+    return "";
+}
+
+void check_triangles(const std::string &path, d_mesh &mesh) {
+    std::string message = triangle_error(mesh);
+    if (!message.empty())
+        mesh_error(path, message);
+}
+
+// Tokenizer working on the whole content of a text file
+class text_cursor {
+  public:
+    text_cursor(const std::string &path, const std::string &content)
+        : path(path), p(content.c_str()),
+          end(content.c_str() + content.size()) {}
+
+    // Skips blanks and comments, stops at the end of the line if asked
+    void skip_blanks(bool stopAtNewLine = false) {
+        while (p < end) {
+            if (*p == '\n') {
+                if (stopAtNewLine)
+                    return;
+                line++;
+                p++;
+            } else if (*p == '%') {
+                while (p < end && *p != '\n')
+                    p++;
+            } else if (isspace((unsigned char)*p))
+                p++;
+            else
+                return;
+        }
+    }
+
+    bool at_end() {
+        skip_blanks();
+        return p >= end;
+    }
+
+    bool at_line_end() {
+        skip_blanks(true);
+        return p >= end || *p == '\n';
+    }
+
+    void next_line() {
+        while (p < end && *p != '\n')
+            p++;
+    }
+
+    char peek() { return *p; }
+
+    std::string word() {
+        skip_blanks();
+        const char *start = p;
+        while (p < end && !isspace((unsigned char)*p))
+            p++;
+        return std::string(start, p);
+    }
+
+    bool try_scalar(T &value) {
+        if (at_line_end())
+            return false;
+        char *next;
+        double parsed = strtod(p, &next);
+        if (next == p)
+            return false;
+        p = next;
+        value = parsed;
+        return true;
+    }
+
+    T scalar() {
+        skip_blanks();
+        T value;
+        if (!try_scalar(value))
+            error("expected a number");
+        return value;
+    }
+
+    // Fails on values that do not fit in an int
+    int integer() {
+        skip_blanks();
+        bool negative = (p < end && *p == '-');
+        if (negative)
+            p++;
+        if (p >= end || !isdigit((unsigned char)*p))
+            error("expected an integer");
+        long value = 0;
+        while (p < end && isdigit((unsigned char)*p)) {
+            value = 10 * value + (*p++ - '0');
+            if (value > std::numeric_limits<int>::max())
+                error("integer out of range");
+        }
+        if (p < end && !isspace((unsigned char)*p) && *p != '%')
+            error("expected an integer");
+        return (negative) ? -value : value;
+    }
+
+    [[noreturn]] void error(const std::string &message) {
+        mesh_error(path, "line " + std::to_string(line) + ": " + message);
+    }
+
+  private:
+    const std::string &path;
+    const char *p;
+    const char *end;
+    int line = 1;
+};
+
+d_mesh read_legacy_text(const std::string &path, text_cursor &cursor) {
+    std::vector<T> x, y;
+    int nSkipped = 0;
+    while (!cursor.at_end()) {
+        T values[3];
+        int nValues = 0;
+        while (nValues < 3 && cursor.try_scalar(values[nValues]))
+            nValues++;
+        if (nValues == 2 && cursor.at_line_end()) {
+            x.push_back(values[0]);
+            y.push_back(values[1]);
+        } else
+            nSkipped++;
+        cursor.next_line();
+    }
+    if (nSkipped > 0)
+        std::cerr << "read_mesh: skipped " << nSkipped
+                  << " lines that do not hold 2 values in " << path << "\n";
+    return make_host_mesh(x, y, {});
+}
+
+d_mesh read_text(const std::string &path, const std::string &content) {
+    text_cursor cursor(path, content);
+    if (cursor.at_end() || cursor.peek() != '$')
+        return read_legacy_text(path, cursor);
+
+    std::vector<T> x, y;
+    std::vector<int> triangles;
+    bool hasNodes = false;
+    while (!cursor.at_end()) {
+        std::string section = cursor.word();
+        if (section == "$Nodes") {
+            long n = cursor.integer();
+            if (n < 0)
+                cursor.error("invalid number of nodes");
+            x.resize(n);
+            y.resize(n);
+            for (long i = 0; i < n; i++) {
+                x[i] = cursor.scalar();
+                y[i] = cursor.scalar();
+            }
+            hasNodes = true;
+        } else if (section == "$Triangles") {
+            long m = cursor.integer();
+            if (m < 0 || 3 * m > std::numeric_limits<int>::max())
+                cursor.error("invalid number of triangles");
+            triangles.resize(3 * m);
+            for (long k = 0; k < 3 * m; k++)
+                triangles[k] = cursor.integer();
+        } else if (section == "$End")
+            break;
+        else
+            cursor.error("unknown section '" + section + "'");
+    }
+    if (!hasNodes)
+        mesh_error(path, "no $Nodes section");
+
+    auto mesh = make_host_mesh(x, y, triangles);
+    check_triangles(path, mesh);
+    return mesh;
+}
+
+template <typename S>
+void read_scalars(const std::string &path, FILE *file, T *data, size_t n) {
+    if (std::is_same<S, T>::value) {
+        if (fread(data, sizeof(T), n, file) != n)
+            mesh_error(path, "unexpected end of file");
+        return;
+    }
+    std::vector<S> buffer(n);
+    if (fread(buffer.data(), sizeof(S), n, file) != n)
+        mesh_error(path, "unexpected end of file");
+    std::copy(buffer.begin(), buffer.end(), data);
+}
+
+d_mesh read_binary(const std::string &path, FILE *file) {
+    mesh_header header;
+    if (fread(&header, sizeof(header), 1, file) != 1)
+        mesh_error(path, "truncated header");
+    if (header.version != mesh_version)
+        mesh_error(path, "unsupported version " +
+                             std::to_string(header.version));
+    if (header.scalar_size != sizeof(float) &&
+        header.scalar_size != sizeof(double))
+        mesh_error(path, "invalid scalar size");
+    if (header.n_nodes < 0 || header.n_triangles < 0 ||
+        header.n_nodes > std::numeric_limits<int>::max() ||
+        3 * header.n_triangles > std::numeric_limits<int>::max())
+        mesh_error(path, "invalid number of nodes or triangles");
+
+    d_mesh mesh(header.n_nodes, header.n_triangles, false);
+    for (T *data : {mesh.X.data, mesh.Y.data}) {
+        if (header.scalar_size == sizeof(float))
+            read_scalars<float>(path, file, data, header.n_nodes);
+        else
+            read_scalars<double>(path, file, data, header.n_nodes);
+    }
+    size_t nIndices = mesh.triangles.n;
+    if (fread(mesh.triangles.data, sizeof(int), nIndices, file) != nIndices)
+        mesh_error(path, "unexpected end of file");
+    check_triangles(path, mesh);
+    return mesh;
+}
+
+d_mesh read_host_mesh(const std::string &path) {
+    auto file = open_file(path, "rb");
+    char magic[sizeof(mesh_magic)];
+    size_t nMagic = fread(magic, 1, sizeof(magic), file.get());
+    rewind(file.get());
+    if (nMagic == sizeof(magic) && memcmp(magic, mesh_magic, nMagic) == 0)
+        return read_binary(path, file.get());
+
+    // The whole file is parsed at once
+    fseek(file.get(), 0, SEEK_END);
+    long size = ftell(file.get());
+    rewind(file.get());
+    std::string content(size, '\0');
+    if (fread(&content[0], 1, size, file.get()) != (size_t)size)
+        mesh_error(path, "read error");
+    return read_text(path, content);
+}
+
+void write_text(d_mesh &mesh, FILE *file) {
+    const int digits = std::numeric_limits<T>::max_digits10;
+    fprintf(file, "$Nodes\n%d\n", mesh.size());
+    for (int i = 0; i < mesh.size(); i++)
+        fprintf(file, "%.*g %.*g\n", digits, (double)mesh.X.data[i], digits,
+                (double)mesh.Y.data[i]);
+    if (mesh.n_triangles() == 0)
+        return;
+    fprintf(file, "$Triangles\n%d\n", mesh.n_triangles());
+    const int *triangles = mesh.triangles.data;
+    for (int t = 0; t < mesh.n_triangles(); t++)
+        fprintf(file, "%d %d %d\n", triangles[3 * t], triangles[3 * t + 1],
+                triangles[3 * t + 2]);
+}
+
+void write_binary(d_mesh &mesh, FILE *file) {
+    mesh_header header;
+    memcpy(header.magic, mesh_magic, sizeof(mesh_magic));
+    header.version = mesh_version;
+    header.scalar_size = sizeof(T);
+    header.reserved = 0;
+    header.n_nodes = mesh.size();
+    header.n_triangles = mesh.n_triangles();
+    fwrite(&header, sizeof(header), 1, file);
+    fwrite(mesh.X.data, sizeof(T), mesh.size(), file);
+    fwrite(mesh.Y.data, sizeof(T), mesh.size(), file);
+    fwrite(mesh.triangles.data, sizeof(int), mesh.triangles.n, file);
+}
+
+} // namespace
+
+void check_triangles(d_mesh &mesh) {
+    if (mesh.is_device()) {
+        d_mesh hostMesh(mesh, true);
+        check_triangles(hostMesh);
+        return;
+    }
+    std::string message = triangle_error(mesh);
+    if (!message.empty())
+        throw std::invalid_argument("The " + message + "\n");
+}
+
+d_mesh read_mesh(const std::string &path, bool toDevice) {
+    if (!toDevice)
+        return read_host_mesh(path);
+    return d_mesh(read_host_mesh(path), true);
+}
+
+void write_mesh(d_mesh &mesh, const std::string &path, bool binary) {
+    if (mesh.is_device()) { // Copy to the host and restart the function
+        d_mesh hostMesh(mesh, true);
+        write_mesh(hostMesh, path, binary);
+        return;
+    }
+    auto file = open_file(path, (binary) ? "wb" : "w");
+    if (binary)
+        write_binary(mesh, file.get());
+    else
+        write_text(mesh, file.get());
+    if (ferror(file.get()))
+        mesh_error(path, "write error");
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <string>
+
+#include "mesh.hpp"
+
+// Mesh files hold the node coordinates and, optionally, the triangles (3
+// node indices per triangle, starting at 0).
+//
+// Text format, one item per line ('%' starts a comment line):
+//     $Nodes
+//     <number of nodes>
+//     x y
+//     ...
+//     $Triangles
+//     <number of triangles>
+//     i j k
+//     ...
+// Files without sections are read as the legacy format: every line holding
+// two values is a node, and there are no triangles.
+//
+// Binary format (native byte order): the magic "ARDM", then int32 version,
+// int32 size of a scalar (4 or 8), int32 reserved, int64 number of nodes,
+// int64 number of triangles, the X and Y arrays and the int32 triangles.
+//
+// The format is detected from the content of the file. Errors are reported
+// by throwing std::runtime_error.
+
+// Throws std::invalid_argument if a triangle refers to a node out of the mesh
+void check_triangles(d_mesh &mesh);
+
+d_mesh read_mesh(const std::string &path, bool toDevice = true);
+
+void write_mesh(d_mesh &mesh, const std::string &path, bool binary = false);
@@ -0,0 +1,256 @@
+#include <stdexcept>
+#include <string>
+
+#include "helper/cuda/cuda_device_sort.hpp"
+#include "helper/cuda/cuda_error_check.h"
+#include "helper/cuda/cuda_scan.hpp"
+#include "helper/cuda/cuda_thread_manager.hpp"
+#include "p1_assembly.hpp"
+
+// Position of column j in row i of a CSR pattern
+__device__ inline int find_column(const int *rowPtr, const int *colPtr, int i,
+                                  int j) {
+    int low = rowPtr[i];
+    int high = rowPtr[i + 1] - 1;
+    while (low < high) {
+        int mid = (low + high) / 2;
+        if (colPtr[mid] < j)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    return low;
+}
+
+// first[0] is the first triangle with a node out of [0, n), first[1] the
+// first one with a zero area (nTriangles if there are none)
+__global__ void check_trianglesK(const T *X, const T *Y, const int *triangles,
+                                 int nTriangles, int n, int *first) {
+    int t = threadIdx.x + blockIdx.x * blockDim.x;
+    if (t >= nTriangles)
+        return;
+    const int *v = triangles + 3 * t;
+    for (int k = 0; k < 3; k++)
+        if (v[k] < 0 || v[k] >= n) {
+            atomicMin(&first[0], t);
+            return;
+        }
+    T det = (X[v[1]] - X[v[0]]) * (Y[v[2]] - Y[v[0]]) -
+            (X[v[2]] - X[v[0]]) * (Y[v[1]] - Y[v[0]]);
+    if (det == 0)
+        atomicMin(&first[1], t);
+}
+
+__global__ void count_incidencesK(const int *triangles, int nTriangles,
+                                  int *elemPtr) {
+    int t = threadIdx.x + blockIdx.x * blockDim.x;
+    if (t >= nTriangles)
+        return;
+    for (int k = 0; k < 3; k++)
+        atomicAdd(&elemPtr[triangles[3 * t + k] + 1], 1);
+}
+
+__global__ void fill_incidencesK(const int *triangles, int nTriangles,
+                                 const int *elemPtr, int *cursor,
+                                 int *elements) {
+    int t = threadIdx.x + blockIdx.x * blockDim.x;
+    if (t >= nTriangles)
+        return;
+    for (int k = 0; k < 3; k++) {
+        int node = triangles[3 * t + k];
+        elements[elemPtr[node] + atomicAdd(&cursor[node], 1)] = t;
+    }
+}
+
+// Lists the distinct neighbours of each node (itself included), in increasing
+// order, at the beginning of its slot of the candidates buffer
+__global__ void make_patternK(const int *triangles, const int *elemPtr,
+                              int *elements, int n, int *candidates,
+                              int *rowPtr) {
+    int i = threadIdx.x + blockIdx.x * blockDim.x;
+    if (i >= n)
+        return;
+    if (i == 0)
+        rowPtr[0] = 0;
+    int start = elemPtr[i];
+    int nElements = elemPtr[i + 1] - start;
+    // fill_incidencesK appends the triangles of a node with atomics: sorted,
+    // the values of the row are summed in the same order on every run
+    insertion_sort(elements + start, nElements);
+
+    int *cand = candidates + 3 * start;
+    for (int e = 0; e < nElements; e++)
+        for (int k = 0; k < 3; k++)
+            cand[3 * e + k] = triangles[3 * elements[start + e] + k];
+    insertion_sort(cand, 3 * nElements);
+
+    int nUnique = 0;
+    for (int k = 0; k < 3 * nElements; k++)
+        if (k == 0 || cand[k] != cand[k - 1])
+            cand[nUnique++] = cand[k];
+    rowPtr[i + 1] = nUnique;
+}
+
+__global__ void fill_patternK(const int *elemPtr, const int *candidates,
+                              const int *rowPtr, int n, int *colPtr) {
+    int i = threadIdx.x + blockIdx.x * blockDim.x;
+    if (i >= n)
+        return;
+    const int *cand = candidates + 3 * elemPtr[i];
+    for (int k = rowPtr[i]; k < rowPtr[i + 1]; k++)
+        colPtr[k] = cand[k - rowPtr[i]];
+}
+
+__global__ void fill_valuesK(const T *X, const T *Y, const int *triangles,
+                             const int *elemPtr, const int *elements,
+                             const int *rowPtr, const int *colPtr, int n,
+                             T *mass, T *stiffness, T *lumpedMass) {
+    int i = threadIdx.x + blockIdx.x * blockDim.x;
+    if (i >= n)
+        return;
+    for (int k = rowPtr[i]; k < rowPtr[i + 1]; k++) {
+        mass[k] = 0;
+        stiffness[k] = 0;
+    }
+    T lumped = 0;
+    for (int e = elemPtr[i]; e < elemPtr[i + 1]; e++) {
+        const int *v = triangles + 3 * elements[e];
+        T x[3], y[3];
+        int a = 0;
+        for (int k = 0; k < 3; k++) {
+            x[k] = X[v[k]];
+            y[k] = Y[v[k]];
+            if (v[k] == i)
+                a = k;
+        }
+        T det = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+        T area = fabs(det) / 2;
+        // Gradients of the barycentric coordinates
+        T b[3], c[3];
+        for (int k = 0; k < 3; k++) {
+            b[k] = (y[(k + 1) % 3] - y[(k + 2) % 3]) / det;
+            c[k] = (x[(k + 2) % 3] - x[(k + 1) % 3]) / det;
+        }
+        for (int l = 0; l < 3; l++) {
+            int pos = find_column(rowPtr, colPtr, i, v[l]);
+            mass[pos] += area / 12 * ((a == l) ? 2 : 1);
+            stiffness[pos] -= area * (b[a] * b[l] + c[a] * c[l]);
+        }
+        lumped += area / 3;
+    }
+    if (lumpedMass)
+        lumpedMass[i] = lumped;
+}
+
+__global__ void fill_diagonalK(int n, int *rowPtr, int *colPtr) {
+    int i = threadIdx.x + blockIdx.x * blockDim.x;
+    if (i > n)
+        return;
+    rowPtr[i] = i;
+    if (i < n)
+        colPtr[i] = i;
+}
+
+void assemble_p1_matrices(d_mesh &mesh, d_array<int> &triangles,
+                          d_spmatrix &damping, d_spmatrix &stiffness,
+                          bool lumped) {
+    if (!triangles.is_device || !mesh.is_device())
+        throw std::invalid_argument("The mesh and triangles must be on the "
+                                    "device\n");
+    if (triangles.n % 3 != 0)
+        throw std::invalid_argument("The number of triangle indices must be a "
+                                    "multiple of 3\n");
+    int n = mesh.size();
+    int nTriangles = triangles.n / 3;
+    if (nTriangles == 0)
+        throw std::invalid_argument("The mesh has no triangles\n");
+
+    d_array<int> first(2);
+    first.fill(nTriangles);
+    auto tbTri = make1DThreadBlock(nTriangles);
+    check_trianglesK<<<tbTri.block, tbTri.thread>>>(
+        mesh.X.data, mesh.Y.data, triangles.data, nTriangles, n, first.data);
+    gpuErrchk(cudaPeekAtLastError());
+    int hostFirst[2];
+    gpuErrchk(cudaMemcpy(hostFirst, first.data, sizeof(hostFirst),
+                         cudaMemcpyDeviceToHost));
+    if (hostFirst[0] < nTriangles)
+        throw std::invalid_argument(
+            "Triangle " + std::to_string(hostFirst[0]) +
+            " refers to a node out of the mesh, which has " +
+            std::to_string(n) + " nodes\n");
+    if (hostFirst[1] < nTriangles)
+        throw std::invalid_argument("Triangle " +
+                                    std::to_string(hostFirst[1]) +
+                                    " is degenerate (zero area)\n");
+
+    // Node to triangle adjacency
+    d_array<int> elemPtr(n + 1);
+    d_array<int> cursor(n);
+    d_array<int> elements(3 * nTriangles);
+    elemPtr.fill(0);
+    cursor.fill(0);
+    count_incidencesK<<<tbTri.block, tbTri.thread>>>(triangles.data,
+                                                     nTriangles, elemPtr.data);
+    inclusive_scan(elemPtr);
+    fill_incidencesK<<<tbTri.block, tbTri.thread>>>(
+        triangles.data, nTriangles, elemPtr.data, cursor.data, elements.data);
+
+    // Sparsity pattern
+    d_array<int> candidates(9 * nTriangles);
+    d_array<int> rowPtr(n + 1);
+    auto tb = make1DThreadBlock(n);
+    make_patternK<<<tb.block, tb.thread>>>(triangles.data, elemPtr.data,
+                                           elements.data, n, candidates.data,
+                                           rowPtr.data);
+    inclusive_scan(rowPtr);
+    int nnz;
+    gpuErrchk(cudaMemcpy(&nnz, rowPtr.data + n, sizeof(int),
+                         cudaMemcpyDeviceToHost));
+
+    stiffness.rows = n;
+    stiffness.cols = n;
+    stiffness.type = CSR;
+    stiffness.set_nnz(nnz);
+    gpuErrchk(cudaMemcpy(stiffness.rowPtr, rowPtr.data, sizeof(int) * (n + 1),
+                         cudaMemcpyDeviceToDevice));
+    fill_patternK<<<tb.block, tb.thread>>>(elemPtr.data, candidates.data,
+                                           rowPtr.data, n, stiffness.colPtr);
+
+    damping.rows = n;
+    damping.cols = n;
+    damping.type = CSR;
+    damping.set_nnz((lumped) ? n : nnz);
+
+    // Values
+    if (lumped) {
+        d_vector fullMass(nnz);
+        fill_valuesK<<<tb.block, tb.thread>>>(
+            mesh.X.data, mesh.Y.data, triangles.data, elemPtr.data,
+            elements.data, stiffness.rowPtr, stiffness.colPtr, n,
+            fullMass.data, stiffness.data, damping.data);
+        auto tbDiag = make1DThreadBlock(n + 1);
+        fill_diagonalK<<<tbDiag.block, tbDiag.thread>>>(n, damping.rowPtr,
+                                                        damping.colPtr);
+    } else {
+        gpuErrchk(cudaMemcpy(damping.rowPtr, stiffness.rowPtr,
+                             sizeof(int) * (n + 1), cudaMemcpyDeviceToDevice));
+        gpuErrchk(cudaMemcpy(damping.colPtr, stiffness.colPtr,
+                             sizeof(int) * nnz, cudaMemcpyDeviceToDevice));
+        fill_valuesK<<<tb.block, tb.thread>>>(
+            mesh.X.data, mesh.Y.data, triangles.data, elemPtr.data,
+            elements.data, stiffness.rowPtr, stiffness.colPtr, n, damping.data,
+            stiffness.data, nullptr);
+    }
+    gpuErrchk(cudaPeekAtLastError());
+}
+
+void assemble_p1_matrices(d_mesh &mesh, d_spmatrix &damping,
+                          d_spmatrix &stiffness, bool lumped) {
+    if (!mesh.is_device()) {
+        d_mesh deviceMesh(mesh, true);
+        assemble_p1_matrices(deviceMesh, damping, stiffness, lumped);
+        return;
+    }
+    assemble_p1_matrices(mesh, mesh.triangles, damping, stiffness, lumped);
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "dataStructures/array.hpp"
+#include "dataStructures/sparse_matrix.hpp"
+#include "mesh.hpp"
+
+// Assembles the P1 finite element damping (mass) and stiffness matrices of a
+// triangle mesh, as device CSR matrices that can be given directly to
+// simulation::load_dampness_matrix and simulation::load_stiffness_matrix.
+//
+// triangles holds 3 node indices per triangle (device array). Throws
+// std::invalid_argument if there are no triangles, or if a triangle refers to
+// a node out of the mesh or has a zero area.
+// The stiffness matrix is -\int grad(phi_i).grad(phi_j), with the sign
+// expected by the simulation (which solves with damping - dt * stiffness).
+// With lumped = true, the damping matrix is diagonal (row sums of the mass
+// matrix).
+//
+// Each row is computed by a single thread from the triangles adjacent to its
+// node, so no coloring and no atomic scatter of the values are needed, and the
+// result does not depend on the launch configuration.
+void assemble_p1_matrices(d_mesh &mesh, d_array<int> &triangles,
+                          d_spmatrix &damping, d_spmatrix &stiffness,
+                          bool lumped = false);
+
+// Same, with the triangles stored in the mesh
+void assemble_p1_matrices(d_mesh &mesh, d_spmatrix &damping,
+                          d_spmatrix &stiffness, bool lumped = false);
@@ -6,4 +6,9 @@ struct point2d {
     T x, y;
     point2d();
     point2d(T x, T y);
-};
\ No newline at end of file
+};
+
+// Axis-aligned box, empty if x0 > x1
+struct bounding_box {
+    T x0, y0, x1, y1;
+};
@@ -1,9 +1,31 @@
 #include "zone.hpp"
 #include <math.h>
+#include <stdio.h>
+
+// Exact representation of the parameters of a zone
+static std::string zone_key(const char *type, std::initializer_list<T> values) {
+    std::string key = type;
+    char buffer[32];
+    for (T value : values) {
+        snprintf(buffer, sizeof(buffer), " %a", (double)value);
+        key += buffer;
+    }
+    return key;
+}
 
 simple_zone simple_zone::all = simple_zone(true);
 simple_zone simple_zone::none = simple_zone(false);
 
+bounding_box simple_zone::bbox() {
+    if (always_return)
+        return bounding_box{-INFINITY, -INFINITY, INFINITY, INFINITY};
+    return bounding_box{INFINITY, INFINITY, -INFINITY, -INFINITY};
+}
+
+std::string simple_zone::key() {
+    return (always_return) ? "all" : "none";
+}
+
 rect_zone::rect_zone() : rect_zone(0, 0, 0, 0){};
 rect_zone::rect_zone(T x0, T y0, T x1, T y1)
     : x0(min(x0, x1)), x1(max(x0, x1)), y0(min(y0, y1)), y1(max(y0, y1)){};
@@ -17,6 +39,10 @@ __device__ __host__ bool rect_zone::is_inside(point2d p) {
     return is_inside(p.x, p.y);
 }
 
+bounding_box rect_zone::bbox() { return bounding_box{x0, y0, x1, y1}; }
+
+std::string rect_zone::key() { return zone_key("rect", {x0, y0, x1, y1}); }
+
 tri_zone::tri_zone() : tri_zone(0, 0, 0, 0, 0, 0){};
 tri_zone::tri_zone(T x0, T y0, T x1, T y1, T x2, T y2)
     : x0(x0), x1(x1), y0(y0), y1(y1), x2(x2), y2(y2){};
@@ -38,6 +64,15 @@ __device__ __host__ bool tri_zone::is_inside(point2d p) {
     return is_inside(p.x, p.y);
 }
 
+bounding_box tri_zone::bbox() {
+    return bounding_box{min(x0, min(x1, x2)), min(y0, min(y1, y2)),
+                        max(x0, max(x1, x2)), max(y0, max(y1, y2))};
+}
+
+std::string tri_zone::key() {
+    return zone_key("tri", {x0, y0, x1, y1, x2, y2});
+}
+
 circle_zone::circle_zone() : circle_zone(0, 0, 0){};
 circle_zone::circle_zone(T x0, T y0, T r) : x0(x0), y0(y0), r(r){};
 circle_zone::circle_zone(point2d center, T r)
@@ -50,3 +85,9 @@ __device__ __host__ bool circle_zone::is_inside(T x, T y) {
 __device__ __host__ bool circle_zone::is_inside(point2d p) {
     return is_inside(p.x, p.y);
 }
+
+bounding_box circle_zone::bbox() {
+    return bounding_box{x0 - r, y0 - r, x0 + r, y0 + r};
+}
+
+std::string circle_zone::key() { return zone_key("circle", {x0, y0, r}); }
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <string>
+
 #include "point_2d.hpp"
 #include "pybind11_include.hpp"
 #include <constants.hpp>
@@ -15,6 +17,8 @@ struct simple_zone : zone {
     simple_zone(bool b) : always_return(b){};
     __device__ __host__ bool is_inside(T x, T y) { return always_return; }
     __device__ __host__ bool is_inside(point2d p) { return always_return; }
+    bounding_box bbox();
+    std::string key(); // Identifies the zone in the mask cache of a mesh
 
     static simple_zone all;
     static simple_zone none;
@@ -29,6 +33,8 @@ struct rect_zone : zone {
 
     __device__ __host__ bool is_inside(T x, T y);
     __device__ __host__ bool is_inside(point2d p);
+    bounding_box bbox();
+    std::string key();
 };
 
 struct tri_zone : zone {
@@ -40,6 +46,8 @@ struct tri_zone : zone {
 
     __device__ __host__ bool is_inside(T x, T y);
     __device__ __host__ bool is_inside(point2d p);
+    bounding_box bbox();
+    std::string key();
 
     void print() {
         printf("tri_zone: P0(%f,%f) P1(%f,%f) P2(%f,%f) \n", x0, y0, x1, y1, x2,
@@ -56,6 +64,8 @@ struct circle_zone : zone {
 
     __device__ __host__ bool is_inside(T x, T y);
     __device__ __host__ bool is_inside(point2d p);
+    bounding_box bbox();
+    std::string key();
 
     void print() {
         printf("circle_zone: Center(%f,%f) Radius(%f) \n", x0, y0, r);
@@ -0,0 +1,99 @@
+#include "helper/cuda/cuda_error_check.h"
+#include "helper/cuda/cuda_scan.hpp"
+#include "helper/cuda/cuda_thread_manager.hpp"
+#include "zone_mask.hpp"
+
+zone_mask::zone_mask(int n)
+    : n(n), count(0), words(n_words(n)), active_words(0) {
+    if (words.n > 0)
+        gpuErrchk(cudaMemset(words.data, 0, sizeof(unsigned long long) *
+                                                words.n));
+}
+
+__global__ void count_wordsK(const unsigned long long *words, int nWords,
+                             int *activePtr, int *countPtr) {
+    int w = threadIdx.x + blockIdx.x * blockDim.x;
+    if (w >= nWords)
+        return;
+    if (w == 0) {
+        activePtr[0] = 0;
+        countPtr[0] = 0;
+    }
+    activePtr[w + 1] = (words[w] != 0);
+    countPtr[w + 1] = __popcll(words[w]);
+}
+
+__global__ void fill_active_wordsK(const unsigned long long *words, int nWords,
+                                   const int *activePtr, int *activeWords) {
+    int w = threadIdx.x + blockIdx.x * blockDim.x;
+    if (w >= nWords)
+        return;
+    if (words[w] != 0)
+        activeWords[activePtr[w]] = w;
+}
+
+void zone_mask::update() {
+    int nWords = words.n;
+    if (nWords == 0)
+        return;
+    d_array<int> activePtr(nWords + 1);
+    d_array<int> countPtr(nWords + 1);
+    auto tb = make1DThreadBlock(nWords);
+    count_wordsK<<<tb.block, tb.thread>>>(words.data, nWords, activePtr.data,
+                                          countPtr.data);
+    inclusive_scan(activePtr);
+    inclusive_scan(countPtr);
+
+    int nActive;
+    gpuErrchk(cudaMemcpy(&nActive, activePtr.data + nWords, sizeof(int),
+                         cudaMemcpyDeviceToHost));
+    gpuErrchk(cudaMemcpy(&count, countPtr.data + nWords, sizeof(int),
+                         cudaMemcpyDeviceToHost));
+    active_words.resize(nActive);
+    if (nActive > 0)
+        fill_active_wordsK<<<tb.block, tb.thread>>>(
+            words.data, nWords, activePtr.data, active_words.data);
+    gpuErrchk(cudaPeekAtLastError());
+}
+
+// op: 0 union, 1 intersection, 2 complement of a
+__global__ void combine_masksK(const unsigned long long *a,
+                               const unsigned long long *b, int nWords, int n,
+                               int op, unsigned long long *result) {
+    int w = threadIdx.x + blockIdx.x * blockDim.x;
+    if (w >= nWords)
+        return;
+    if (op == 0)
+        result[w] = a[w] | b[w];
+    else if (op == 1)
+        result[w] = a[w] & b[w];
+    else {
+        result[w] = ~a[w];
+        // Bits past the last node stay at 0
+        if (w == nWords - 1 && n % 64 != 0)
+            result[w] &= (1ULL << (n % 64)) - 1;
+    }
+}
+
+static zone_mask combine_masks(zone_mask &a, zone_mask *b, int op) {
+    assert(b == nullptr || a.n == b->n);
+    zone_mask result(a.n);
+    if (a.words.n == 0)
+        return result;
+    auto tb = make1DThreadBlock(a.words.n);
+    combine_masksK<<<tb.block, tb.thread>>>(
+        a.words.data, (b) ? b->words.data : nullptr, a.words.n, a.n, op,
+        result.words.data);
+    result.update();
+    return result;
+}
+
+zone_mask zone_mask::operator|(zone_mask &other) {
+    return combine_masks(*this, &other, 0);
+}
+
+zone_mask zone_mask::operator&(zone_mask &other) {
+    return combine_masks(*this, &other, 1);
+}
+
+zone_mask zone_mask::operator~() { return combine_masks(*this, nullptr, 2); }
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "dataStructures/array.hpp"
+
+// Set of nodes of a mesh, one bit per node (node i is bit i % 64 of word
+// i / 64). The bits past the last node are always 0.
+// The indices of the non-zero words are kept, so that the nodes of a small
+// zone are visited without scanning the whole mask.
+class zone_mask {
+  public:
+    int n;     // Number of nodes of the mesh
+    int count; // Number of nodes in the set
+    d_array<unsigned long long> words;
+    d_array<int> active_words;
+
+    zone_mask(int n);
+
+    __host__ __device__ static int n_words(int n) { return (n + 63) / 64; }
+
+    // Recomputes count and active_words after the words changed
+    void update();
+
+    zone_mask operator|(zone_mask &other);
+    zone_mask operator&(zone_mask &other);
+    zone_mask operator~();
+};
@@ -1,80 +1,137 @@
-#include "dataStructures/helper/apply_operation.h"
-#include "helper/cuda/cuda_device_converter.h"
-#include "matrixOperations/basic_operations.hpp"
+#include <vector>
+
+#include "helper/cuda/cuda_error_check.h"
+#include "helper/cuda/cuda_thread_manager.hpp"
 #include "zone_methods.hpp"
+#include "zone_statistics.hpp"
 
-__global__ void is_inside_arrayK(d_vector &mesh_x, d_vector &mesh_y,
-                                 rect_zone &zone, d_array<bool> &is_inside) {
-    int i = threadIdx.x + blockIdx.x * blockDim.x;
-    if (i >= is_inside.n)
+// Sets the bits of the candidate nodes given by the mesh index that are
+// inside the zone
+template <typename Zone>
+__global__ void fill_maskK(const T *X, const T *Y, const int *sortedNodes,
+                           const int *ranges, int nRanges, int nCandidates,
+                           Zone zone, unsigned long long *words) {
+    int k = threadIdx.x + blockIdx.x * blockDim.x;
+    if (k >= nCandidates)
         return;
-    is_inside.data[i] = zone.is_inside(mesh_x.data[i], mesh_y.data[i]);
+    int i = candidate_node(sortedNodes, ranges, nRanges, k);
+    if (zone.is_inside(X[i], Y[i]))
+        atomicOr(&words[i / 64], 1ULL << (i % 64));
 }
 
-d_array<bool> is_inside_array(d_mesh &mesh, rect_zone &zone) {
-    rect_zone *d_zone;
-    cudaMalloc(&d_zone, sizeof(rect_zone));
-    cudaMemcpy(d_zone, &zone, sizeof(zone), cudaMemcpyHostToDevice);
+template <typename Zone>
+std::shared_ptr<zone_mask> get_zone_mask(d_mesh &mesh, Zone &zone) {
+    std::string key = zone.key();
+    if (auto cached = mesh.cached_zone_mask(key))
+        return cached;
 
-    d_array<bool> is_inside(mesh.size());
-    auto tb = make1DThreadBlock(mesh.size());
+    auto mask = std::make_shared<zone_mask>(mesh.size());
+    auto &grid = mesh.index();
+    auto candidates = grid.candidates(zone.bbox());
+    if (candidates.n_candidates > 0) {
+        auto tb = make1DThreadBlock(candidates.n_candidates);
+        fill_maskK<<<tb.block, tb.thread>>>(
+            mesh.X.data, mesh.Y.data, grid.sorted_nodes.data,
+            candidates.ranges.data, candidates.n_ranges,
+            candidates.n_candidates, zone, mask->words.data);
+        mask->update();
+    }
+    mesh.cache_zone_mask(key, mask);
+    return mask;
+}
 
-    is_inside_arrayK<<<tb.block, tb.thread>>>(
-        *(d_vector *)mesh.X._device, *(d_vector *)mesh.Y._device, *d_zone,
-        *(d_array<bool> *)is_inside._device);
-    cudaFree(d_zone);
-    return is_inside;
+// Complement of a zone, cached next to the zone
+template <typename Zone>
+std::shared_ptr<zone_mask> get_outside_zone_mask(d_mesh &mesh, Zone &zone) {
+    std::string key = "~" + zone.key();
+    if (auto cached = mesh.cached_zone_mask(key))
+        return cached;
+    auto mask = std::make_shared<zone_mask>(~*get_zone_mask(mesh, zone));
+    mesh.cache_zone_mask(key, mask);
+    return mask;
 }
 
-void fill_zone(d_vector &u, d_mesh &mesh, rect_zone &zone, T value) {
-    assert(u.n == mesh.size());
-    auto setToVal = [value] __device__(T & a) { a = value; };
-    auto is_inside = is_inside_array(mesh, zone);
-    apply_func_cond(u, is_inside, setToVal);
+// Calls visit(i) for every node of the mask, one thread per bit of the
+// non-zero words
+template <typename Visit>
+__global__ void visit_maskK(const unsigned long long *words,
+                            const int *activeWords, int nActive, Visit visit) {
+    int k = threadIdx.x + blockIdx.x * blockDim.x;
+    if (k >= 64 * nActive)
+        return;
+    int w = activeWords[k / 64];
+    if ((words[w] >> (k % 64)) & 1ULL)
+        visit(64 * w + k % 64);
 }
 
-void fill_outside_zone(d_vector &u, d_mesh &mesh, rect_zone &zone, T value) {
-    assert(u.n == mesh.size());
-    auto setToVal = [value] __device__(T & a) { a = value; };
-    d_vector is_outside(u.n);
-    auto is_inside = is_inside_array(mesh, zone);
-    hd_data<T> m1(-1);
-    apply_func(is_inside, [] __device__(bool &a) { a = !a; });
-    apply_func_cond(u, is_inside, setToVal);
+// Statistics of one species over one zone
+zone_statistics zone_stats(d_vector &u, zone_mask &mask) {
+    assert(u.n == mask.n);
+    std::vector<d_vector *> species{&u};
+    std::vector<zone_mask *> masks{&mask};
+    return compute_zone_statistics(species, masks);
 }
 
-T min_zone(d_vector &u, d_mesh &mesh, rect_zone &zone) {
-    assert(u.n == mesh.size());
-    auto min = [] __device__(T & a, T & b) { return (a < b) ? a : b; };
-    d_vector u_copy(u);
-    auto is_inside = is_inside_array(mesh, zone);
-    reduction_func_cond(u_copy, is_inside, min);
-    T result = -1;
-    cudaMemcpy(&result, u_copy.data, sizeof(T), cudaMemcpyDeviceToHost);
-    return result;
-};
-
-T max_zone(d_vector &u, d_mesh &mesh, rect_zone &zone) {
-    assert(u.n == mesh.size());
-    auto max = [] __device__(T & a, T & b) { return (a > b) ? a : b; };
-    d_vector u_copy(u);
-    auto is_inside = is_inside_array(mesh, zone);
-    reduction_func_cond(u_copy, is_inside, max);
-    T result = -1;
-    cudaMemcpy(&result, u_copy.data, sizeof(T), cudaMemcpyDeviceToHost);
-    return result;
-};
-
-T mean_zone(d_vector &u, d_mesh &mesh, rect_zone &zone) {
-    assert(u.n == mesh.size());
-    d_array<int> ones(u.n);
-    ones.fill(1);
-    auto is_inside = is_inside_array(mesh, zone);
-    reduction_func_cond(ones, is_inside,
-                        [] __device__(int &a, int &b) { return a + b; });
-    hd_data<int> n_vals(ones.data, true);
-    reduction_func_cond(u, is_inside,
-                        [] __device__(T & a, T & b) { return a + b; });
-    hd_data<T> total_sum(u.data, true);
-    return total_sum() / n_vals();
-};
\ No newline at end of file
+void fill_zone(d_vector &u, zone_mask &mask, T value) {
+    assert(u.n == mask.n);
+    if (mask.count == 0)
+        return;
+    T *data = u.data;
+    auto tb = make1DThreadBlock(64 * mask.active_words.n);
+    visit_maskK<<<tb.block, tb.thread>>>(
+        mask.words.data, mask.active_words.data, mask.active_words.n,
+        [data, value] __device__(int i) { data[i] = value; });
+    gpuErrchk(cudaPeekAtLastError());
+}
+
+T min_zone(d_vector &u, zone_mask &mask) {
+    return zone_stats(u, mask).min[0];
+}
+
+T max_zone(d_vector &u, zone_mask &mask) {
+    return zone_stats(u, mask).max[0];
+}
+
+T mean_zone(d_vector &u, zone_mask &mask) {
+    return zone_stats(u, mask).mean[0];
+}
+
+template <typename Zone>
+void fill_zone(d_vector &u, d_mesh &mesh, Zone &zone, T value) {
+    fill_zone(u, *get_zone_mask(mesh, zone), value);
+}
+
+template <typename Zone>
+void fill_outside_zone(d_vector &u, d_mesh &mesh, Zone &zone, T value) {
+    fill_zone(u, *get_outside_zone_mask(mesh, zone), value);
+}
+
+template <typename Zone> int count_zone(d_mesh &mesh, Zone &zone) {
+    return get_zone_mask(mesh, zone)->count;
+}
+
+template <typename Zone> T min_zone(d_vector &u, d_mesh &mesh, Zone &zone) {
+    return min_zone(u, *get_zone_mask(mesh, zone));
+}
+
+template <typename Zone> T max_zone(d_vector &u, d_mesh &mesh, Zone &zone) {
+    return max_zone(u, *get_zone_mask(mesh, zone));
+}
+
+template <typename Zone> T mean_zone(d_vector &u, d_mesh &mesh, Zone &zone) {
+    return mean_zone(u, *get_zone_mask(mesh, zone));
+}
+
+#define INSTANTIATE_ZONE_METHODS(Zone)                                         \
+    template std::shared_ptr<zone_mask> get_zone_mask(d_mesh &, Zone &);       \
+    template void fill_zone(d_vector &, d_mesh &, Zone &, T);                  \
+    template void fill_outside_zone(d_vector &, d_mesh &, Zone &, T);          \
+    template int count_zone(d_mesh &, Zone &);                                 \
+    template T min_zone(d_vector &, d_mesh &, Zone &);                         \
+    template T max_zone(d_vector &, d_mesh &, Zone &);                         \
+    template T mean_zone(d_vector &, d_mesh &, Zone &);
+
+INSTANTIATE_ZONE_METHODS(rect_zone)
+INSTANTIATE_ZONE_METHODS(tri_zone)
+INSTANTIATE_ZONE_METHODS(circle_zone)
+INSTANTIATE_ZONE_METHODS(simple_zone)
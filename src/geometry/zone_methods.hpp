@@ -1,15 +1,41 @@
 #pragma once
 
+#include <memory>
+
 #include "mesh.hpp"
 #include "zone.hpp"
+#include "zone_mask.hpp"
 #include <dataStructures/array.hpp>
 
-void fill_zone(d_vector &u, d_mesh &mesh, rect_zone &rect_zone, T value);
+// Zone functions are defined for rect_zone, tri_zone, circle_zone and
+// simple_zone. The first query of a zone builds its mask, from the nodes of
+// the cells of the mesh index that intersect the bounding box of the zone
+// (see d_mesh::index), and caches it on the mesh. Later queries of the same
+// zone only visit the non-zero words of the mask.
+// On an empty zone, min_zone returns +inf, max_zone -inf and mean_zone NaN.
+
+template <typename Zone>
+std::shared_ptr<zone_mask> get_zone_mask(d_mesh &mesh, Zone &zone);
+
+template <typename Zone>
+void fill_zone(d_vector &u, d_mesh &mesh, Zone &zone, T value);
+
+template <typename Zone>
+void fill_outside_zone(d_vector &u, d_mesh &mesh, Zone &zone, T value);
+
+template <typename Zone> int count_zone(d_mesh &mesh, Zone &zone);
+
+template <typename Zone> T min_zone(d_vector &u, d_mesh &mesh, Zone &zone);
+
+template <typename Zone> T max_zone(d_vector &u, d_mesh &mesh, Zone &zone);
+
+template <typename Zone> T mean_zone(d_vector &u, d_mesh &mesh, Zone &zone);
 
-void fill_outside_zone(d_vector &u, d_mesh &mesh, rect_zone &zone, T value);
+// Same on a mask, e.g. a combination of zones
+void fill_zone(d_vector &u, zone_mask &mask, T value);
 
-T min_zone(d_vector &u, d_mesh &mesh, rect_zone &zone);
+T min_zone(d_vector &u, zone_mask &mask);
 
-T max_zone(d_vector &u, d_mesh &mesh, rect_zone &zone);
+T max_zone(d_vector &u, zone_mask &mask);
 
-T mean_zone(d_vector &u, d_mesh &mesh, rect_zone &zone);
\ No newline at end of file
+T mean_zone(d_vector &u, zone_mask &mask);
@@ -0,0 +1,177 @@
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+
+#include "helper/cuda/cuda_error_check.h"
+#include "matrixOperations/basic_operations.hpp"
+#include "zone_statistics.hpp"
+
+// Fixed rather than the default block size: each block sums its words in a
+// tree of this width, so the statistics are the same on every device
+#define STATS_BLOCK_SIZE 128
+
+struct stats_zone {
+    const unsigned long long *words;
+    const int *active_words;
+    int n_active;
+};
+
+// Block (x, z) reduces the words [x * STATS_BLOCK_SIZE, (x + 1) *
+// STATS_BLOCK_SIZE) of the active words of zone z, one word per thread, and
+// writes one partial (sum, min, max, integral) per species
+__global__ void zone_statisticsK(T *const *species, int nSpecies,
+                                 const T *weights, const stats_zone *zones,
+                                 T *partials) {
+    __shared__ T sum[STATS_BLOCK_SIZE];
+    __shared__ T minimum[STATS_BLOCK_SIZE];
+    __shared__ T maximum[STATS_BLOCK_SIZE];
+    __shared__ T integral[STATS_BLOCK_SIZE];
+
+    const stats_zone zone = zones[blockIdx.y];
+    int k = threadIdx.x + blockIdx.x * blockDim.x;
+    unsigned long long word = 0;
+    int first = 0;
+    if (k < zone.n_active) {
+        int w = zone.active_words[k];
+        word = zone.words[w];
+        first = 64 * w;
+    }
+
+    for (int s = 0; s < nSpecies; s++) {
+        const T *u = species[s];
+        T localSum = 0, localMin = INFINITY, localMax = -INFINITY;
+        T localIntegral = 0;
+        for (unsigned long long bits = word; bits != 0; bits &= bits - 1) {
+            int i = first + __ffsll(bits) - 1;
+            localSum += u[i];
+            localMin = min(localMin, u[i]);
+            localMax = max(localMax, u[i]);
+            if (weights)
+                localIntegral += weights[i] * u[i];
+        }
+        sum[threadIdx.x] = localSum;
+        minimum[threadIdx.x] = localMin;
+        maximum[threadIdx.x] = localMax;
+        integral[threadIdx.x] = localIntegral;
+        __syncthreads();
+        for (int stride = STATS_BLOCK_SIZE / 2; stride > 0; stride /= 2) {
+            if (threadIdx.x < stride) {
+                int a = threadIdx.x;
+                int b = threadIdx.x + stride;
+                sum[a] += sum[b];
+                minimum[a] = min(minimum[a], minimum[b]);
+                maximum[a] = max(maximum[a], maximum[b]);
+                integral[a] += integral[b];
+            }
+            __syncthreads();
+        }
+        if (threadIdx.x == 0) {
+            T *partial =
+                partials +
+                4 * ((blockIdx.y * gridDim.x + blockIdx.x) * nSpecies + s);
+            partial[0] = sum[0];
+            partial[1] = minimum[0];
+            partial[2] = maximum[0];
+            partial[3] = integral[0];
+        }
+        __syncthreads();
+    }
+}
+
+zone_statistics compute_zone_statistics(std::vector<d_vector *> &species,
+                                        std::vector<zone_mask *> &masks,
+                                        d_vector *weights) {
+    zone_statistics stats;
+    int nZones = masks.size();
+    int nSpecies = species.size();
+    stats.n_zones = nZones;
+    stats.n_species = nSpecies;
+    stats.count.resize(nZones);
+    stats.sum.assign(nZones * nSpecies, 0);
+    stats.min.assign(nZones * nSpecies, INFINITY);
+    stats.max.assign(nZones * nSpecies, -INFINITY);
+    stats.mean.assign(nZones * nSpecies, NAN);
+    if (weights)
+        stats.integral.assign(nZones * nSpecies, 0);
+
+    // Bit i of a mask is node i of the species vectors
+    int n = (nSpecies > 0) ? species[0]->n : 0;
+    for (int s = 0; s < nSpecies; s++)
+        if (species[s]->n != n)
+            throw std::invalid_argument(
+                "The species vectors must have the same size\n");
+    if (nSpecies > 0 && weights && weights->n != n)
+        throw std::invalid_argument(
+            "The weights must have the size of the species vectors\n");
+    for (int z = 0; z < nZones; z++)
+        if (nSpecies > 0 && masks[z]->n != n)
+            throw std::invalid_argument(
+                "Zone mask " + std::to_string(z) + " has " +
+                std::to_string(masks[z]->n) + " nodes, the species vectors " +
+                std::to_string(n) + "\n");
+
+    int maxActive = 0;
+    std::vector<stats_zone> h_zones(nZones);
+    for (int z = 0; z < nZones; z++) {
+        stats.count[z] = masks[z]->count;
+        h_zones[z] = stats_zone{masks[z]->words.data,
+                                masks[z]->active_words.data,
+                                masks[z]->active_words.n};
+        maxActive = std::max(maxActive, masks[z]->active_words.n);
+    }
+    std::vector<T *> h_species(nSpecies);
+    for (int s = 0; s < nSpecies; s++)
+        h_species[s] = species[s]->data;
+    if (maxActive == 0 || nSpecies == 0)
+        return stats;
+
+    int nBlocks = (maxActive - 1) / STATS_BLOCK_SIZE + 1;
+    int nPartials = 4 * nZones * nBlocks * nSpecies;
+    stats_zone *d_zones;
+    T **d_species;
+    T *d_partials;
+    gpuErrchk(cudaMalloc(&d_zones, sizeof(stats_zone) * nZones));
+    gpuErrchk(cudaMalloc(&d_species, sizeof(T *) * nSpecies));
+    gpuErrchk(cudaMalloc(&d_partials, sizeof(T) * nPartials));
+    gpuErrchk(cudaMemcpy(d_zones, h_zones.data(), sizeof(stats_zone) * nZones,
+                         cudaMemcpyHostToDevice));
+    gpuErrchk(cudaMemcpy(d_species, h_species.data(), sizeof(T *) * nSpecies,
+                         cudaMemcpyHostToDevice));
+
+    zone_statisticsK<<<dim3(nBlocks, nZones), STATS_BLOCK_SIZE>>>(
+        d_species, nSpecies, (weights) ? weights->data : nullptr, d_zones,
+        d_partials);
+    std::vector<T> partials(nPartials);
+    gpuErrchk(cudaMemcpy(partials.data(), d_partials, sizeof(T) * nPartials,
+                         cudaMemcpyDeviceToHost));
+    gpuErrchk(cudaFree(d_zones));
+    gpuErrchk(cudaFree(d_species));
+    gpuErrchk(cudaFree(d_partials));
+
+    for (int z = 0; z < nZones; z++)
+        for (int b = 0; b < nBlocks; b++)
+            for (int s = 0; s < nSpecies; s++) {
+                int k = z * nSpecies + s;
+                const T *partial =
+                    &partials[4 * ((z * nBlocks + b) * nSpecies + s)];
+                stats.sum[k] += partial[0];
+                stats.min[k] = std::min(stats.min[k], partial[1]);
+                stats.max[k] = std::max(stats.max[k], partial[2]);
+                if (weights)
+                    stats.integral[k] += partial[3];
+            }
+    for (int z = 0; z < nZones; z++)
+        for (int s = 0; s < nSpecies; s++)
+            if (stats.count[z] > 0)
+                stats.mean[z * nSpecies + s] =
+                    stats.sum[z * nSpecies + s] / stats.count[z];
+    return stats;
+}
+
+void lumped_mass(d_spmatrix &mass, d_vector &weights) {
+    assert(weights.n == mass.rows);
+    d_vector ones(mass.cols);
+    ones.fill(1);
+    dot(mass, ones, weights);
+}
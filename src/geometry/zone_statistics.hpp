@@ -0,0 +1,34 @@
+#pragma once
+
+#include <vector>
+
+#include "dataStructures/array.hpp"
+#include "dataStructures/sparse_matrix.hpp"
+#include "zone_mask.hpp"
+
+// Statistics of several species over several zones. Per species values are
+// stored zone by zone: value[z * n_species + s].
+struct zone_statistics {
+    int n_zones = 0;
+    int n_species = 0;
+    std::vector<int> count; // Number of nodes of each zone
+    std::vector<T> sum;
+    std::vector<T> min; // +inf on an empty zone
+    std::vector<T> max; // -inf on an empty zone
+    std::vector<T> mean; // NaN on an empty zone
+    // sum of weights[i] * u[i], only computed when weights are given
+    std::vector<T> integral;
+};
+
+// Computes the statistics of all (zone, species) pairs in one kernel, without
+// modifying the species. Each zone only visits the non-zero words of its
+// mask. The result does not depend on the launch configuration. Throws
+// std::invalid_argument if the species, the weights and the masks do not all
+// have the same size.
+zone_statistics compute_zone_statistics(std::vector<d_vector *> &species,
+                                        std::vector<zone_mask *> &masks,
+                                        d_vector *weights = nullptr);
+
+// Row sums of the mass matrix: with them as weights, the integral of a P1
+// field over a zone is approximated by the lumped quadrature
+void lumped_mass(d_spmatrix &mass, d_vector &weights);
@@ -1,39 +1,239 @@
 #include "chrono_profiler.hpp"
-#include <assert.h>
 
-chrono_profiler::chrono_profiler() { time = clock(); }
+#ifndef NDEBUG_PROFILING
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <mutex>
+#include <sstream>
+
+namespace {
+
+struct profiler_frame {
+    std::shared_ptr<chrono_profiler::handle> owner;
+    std::string name;
+    std::string path;
+    double start;
+    bool flat;
+};
+
+struct trace_event {
+    std::string name;
+    std::string category;
+    int thread;
+    double start;
+    double duration;
+};
+
+const size_t max_trace_events = 1 << 20;
+
+std::mutex profiler_mutex;
+std::vector<trace_event> trace_events;
+size_t dropped_trace_events = 0;
+std::atomic<bool> tracing(false);
+
+const auto epoch = std::chrono::steady_clock::now();
+
+// Seconds elapsed since the library was loaded
+double now() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                         epoch)
+        .count();
+}
+
+int thread_id() {
+    static std::atomic<int> n_threads(0);
+    thread_local int id = n_threads++;
+    return id;
+}
+
+thread_local std::vector<profiler_frame> frames;
+
+std::string escape(const std::string &str) {
+    std::string escaped;
+    for (char c : str) {
+        if (c == '"' || c == '\\')
+            escaped += '\\';
+        escaped += c;
+    }
+    return escaped;
+}
+
+} // namespace
+
+chrono_profiler::chrono_profiler(std::string name)
+    : name(name), self(std::make_shared<handle>(handle{this})) {}
+
+chrono_profiler::chrono_profiler(const chrono_profiler &other)
+    : name(other.name), names(other.names), sections(other.sections),
+      self(std::make_shared<handle>(handle{this})) {}
+
+chrono_profiler &chrono_profiler::operator=(const chrono_profiler &other) {
+    name = other.name;
+    names = other.names;
+    sections = other.sections;
+    return *this;
+}
+
+chrono_profiler::~chrono_profiler() {
+    frames.erase(std::remove_if(frames.begin(), frames.end(),
+                                [this](const profiler_frame &frame) {
+                                    return frame.owner == self;
+                                }),
+                 frames.end());
+    // The frames of the other threads cannot be reached from here
+    std::lock_guard<std::mutex> lock(profiler_mutex);
+    self->owner = nullptr;
+}
 
 int chrono_profiler::start(std::string name) {
-    count_time();
+    close_flat();
+    open(name, true);
 
+    std::lock_guard<std::mutex> lock(profiler_mutex);
     auto currentElement = names.find(name);
-
     if (currentElement == names.end()) {
-        current = chronos.size();
-        names[name] = current;
-        chronos.push_back(0.0);
-    } else {
-        current = currentElement->second;
+        int id = names.size();
+        names[name] = id;
+        return id;
+    }
+    return currentElement->second;
+}
+
+void chrono_profiler::end() { close_flat(); }
+
+void chrono_profiler::push(std::string name) { open(name, false); }
+
+void chrono_profiler::pop() {
+    for (size_t depth = frames.size(); depth > 0; depth--) {
+        if (frames[depth - 1].owner == self && !frames[depth - 1].flat) {
+            close_frames(depth - 1);
+            return;
+        }
     }
-    time = clock();
-    return current;
 }
 
-void chrono_profiler::end() {
-    count_time();
-    current = -1;
+void chrono_profiler::open(const std::string &name, bool flat) {
+    std::string path =
+        (frames.empty()) ? name : frames.back().path + "/" + name;
+    frames.push_back(profiler_frame{self, name, path, now(), flat});
+}
+
+// Sections left open by an early return of a child are closed with it
+bool chrono_profiler::close_flat() {
+    for (size_t depth = frames.size(); depth > 0; depth--) {
+        if (frames[depth - 1].owner == self && frames[depth - 1].flat) {
+            close_frames(depth - 1);
+            return true;
+        }
+    }
+    return false;
+}
+
+void chrono_profiler::close_frames(size_t depth) {
+    double end = now();
+    std::lock_guard<std::mutex> lock(profiler_mutex);
+    while (frames.size() > depth) {
+        auto &frame = frames.back();
+        // Sections of a destroyed profiler are dropped
+        if (frame.owner->owner)
+            frame.owner->owner->record(frame.path, frame.name, thread_id(),
+                                       frame.start, end - frame.start);
+        frames.pop_back();
+    }
+}
+
+void chrono_profiler::record(const std::string &path, const std::string &name,
+                             int thread, double start, double duration) {
+    auto &section = sections[path];
+    if (section.count == 0 || duration < section.min)
+        section.min = duration;
+    if (section.count == 0 || duration > section.max)
+        section.max = duration;
+    section.total += duration;
+    section.count++;
+
+    if (!tracing)
+        return;
+    if (trace_events.size() < max_trace_events)
+        trace_events.push_back(
+            trace_event{name, this->name, thread, start, duration});
+    else
+        dropped_trace_events++;
 }
 
 void chrono_profiler::print() {
-    count_time();
-    for (auto name = names.begin(); name != names.end(); name++) {
-        std::cout << name->first << " :\n" << chronos[name->second] << "\n";
+    auto sections = stats();
+    for (auto &section : sections) {
+        // Children of a section opened by another profiler keep their path
+        auto &path = section.first;
+        int depth = std::count(path.begin(), path.end(), '/');
+        auto parentEnd = path.rfind('/');
+        bool hasParent = parentEnd != std::string::npos &&
+                         sections.count(path.substr(0, parentEnd)) > 0;
+        std::cout << std::string(2 * depth, ' ')
+                  << ((hasParent) ? path.substr(parentEnd + 1) : path)
+                  << " : " << section.second.total << "s ("
+                  << section.second.count
+                  << " calls, mean=" << section.second.mean()
+                  << "s, min=" << section.second.min
+                  << "s, max=" << section.second.max << "s)\n";
     }
 }
 
-void chrono_profiler::count_time() {
-    if (current >= 0) {
-        chronos.at(current) += (double)(clock() - time) / CLOCKS_PER_SEC;
+void chrono_profiler::reset() {
+    std::lock_guard<std::mutex> lock(profiler_mutex);
+    sections.clear();
+}
+
+std::map<std::string, profiler_stats> chrono_profiler::stats() {
+    std::lock_guard<std::mutex> lock(profiler_mutex);
+    return sections;
+}
+
+chrono_profiler::scope::scope(chrono_profiler &profiler, std::string name)
+    : profiler(profiler) {
+    profiler.push(name);
+}
+
+chrono_profiler::scope::~scope() { profiler.pop(); }
+
+void chrono_profiler::set_tracing(bool enabled) { tracing = enabled; }
+
+bool chrono_profiler::is_tracing() { return tracing; }
+
+void chrono_profiler::clear_trace() {
+    std::lock_guard<std::mutex> lock(profiler_mutex);
+    trace_events.clear();
+    dropped_trace_events = 0;
+}
+
+std::string chrono_profiler::chrome_trace() {
+    std::lock_guard<std::mutex> lock(profiler_mutex);
+    std::stringstream strs;
+    strs << std::fixed << std::setprecision(3);
+    strs << "{\"traceEvents\":[";
+    for (size_t k = 0; k < trace_events.size(); k++) {
+        auto &event = trace_events[k];
+        strs << ((k == 0) ? "\n" : ",\n") << "{\"name\":\""
+             << escape(event.name) << "\",\"cat\":\""
+             << escape(event.category) << "\",\"ph\":\"X\",\"ts\":"
+             << event.start * 1e6 << ",\"dur\":" << event.duration * 1e6
+             << ",\"pid\":0,\"tid\":" << event.thread << "}";
     }
-    time = clock();
-}
\ No newline at end of file
+    strs << "\n],\"displayTimeUnit\":\"ms\",\"otherData\":{\"dropped\":"
+         << dropped_trace_events << "}}\n";
+    return strs.str();
+}
+
+void chrono_profiler::write_chrome_trace(const std::string &path) {
+    std::ofstream fout;
+    fout.open(path);
+    fout << chrome_trace();
+    fout.close();
+}
+
+#endif
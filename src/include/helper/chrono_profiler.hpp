@@ -2,26 +2,128 @@
 
 #include <iostream>
 #include <map>
+#include <memory>
 #include <string>
-#include <time.h>
 #include <vector>
 
-#define NCHRONO
+#include "constants.hpp"
 
+// Statistics accumulated for one section of a profiler (durations in seconds)
+struct profiler_stats {
+    int count = 0;
+    double total = 0;
+    double min = 0;
+    double max = 0;
+
+    double mean() const { return (count > 0) ? total / count : 0; }
+};
+
+#ifndef NDEBUG_PROFILING
+
+// Wall-clock profiler.
+// Sections opened while another one is still open on the same thread are
+// recorded as its children, whichever profiler opened the parent. Their stats
+// are stored under the full path, e.g. "Diffusion/MatMult".
+// When tracing is enabled, every closed section is also appended to a
+// process-wide event log that can be exported in the Chrome trace format
+// (chrome://tracing, Perfetto).
 class chrono_profiler {
   public:
-    chrono_profiler();
+    chrono_profiler(std::string name = "");
+    // A copy has the stats of other, but its own sections
+    chrono_profiler(const chrono_profiler &other);
+    chrono_profiler &operator=(const chrono_profiler &other);
+    ~chrono_profiler();
+
+    // Flat interface: starting a section ends the one previously started by
+    // this profiler on the calling thread
     int start(std::string name);
     void end();
+
+    // Nested interface: push opens a child of the innermost open section
+    void push(std::string name);
+    void pop();
+
     void print();
+    void reset();
+    std::map<std::string, profiler_stats> stats();
 
-  private:
-    clock_t time;
+    // Opens a section for the lifetime of the object
+    class scope {
+      public:
+        scope(chrono_profiler &profiler, std::string name);
+        ~scope();
+
+      private:
+        chrono_profiler &profiler;
+    };
+
+    // Shared event log
+    static void set_tracing(bool enabled);
+    static bool is_tracing();
+    static void clear_trace();
+    static std::string chrome_trace();
+    static void write_chrome_trace(const std::string &path);
 
+    std::string name;
+
+    // Shared with the sections opened by the profiler: the destructor clears
+    // owner, so that the sections still open on other threads are dropped
+    struct handle {
+        chrono_profiler *owner;
+    };
+
+  private:
     std::map<std::string, int> names;
-    std::vector<double> chronos;
+    std::map<std::string, profiler_stats> sections;
+    std::shared_ptr<handle> self;
+
+    void open(const std::string &name, bool flat);
+    bool close_flat();
+    // With profiler_mutex held
+    void record(const std::string &path, const std::string &name, int thread,
+                double start, double duration);
+
+    // Closes the sections open on the calling thread down to the given depth
+    static void close_frames(size_t depth);
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_SCOPE(profiler, name)                                          \
+    chrono_profiler::scope PROFILE_CONCAT(_profile_scope_, __LINE__)(profiler, \
+                                                                     name)
+
+#else
+
+// Profiling is compiled out: the same interface, where every call is an
+// inline no-op
+class chrono_profiler {
+  public:
+    chrono_profiler(std::string name = "") : name(name) {}
+
+    int start(std::string name) { return -1; }
+    void end() {}
+    void push(std::string name) {}
+    void pop() {}
+    void print() {}
+    void reset() {}
+    std::map<std::string, profiler_stats> stats() { return {}; }
+
+    class scope {
+      public:
+        scope(chrono_profiler &profiler, std::string name) {}
+    };
+
+    static void set_tracing(bool enabled) {}
+    static bool is_tracing() { return false; }
+    static void clear_trace() {}
+    static std::string chrome_trace() { return "{\"traceEvents\":[]}"; }
+    static void write_chrome_trace(const std::string &path) {}
+
+    std::string name;
+};
 
-    int current = -1;
+#define PROFILE_SCOPE(profiler, name)
 
-    void count_time();
-};
\ No newline at end of file
+#endif
@@ -0,0 +1,36 @@
+#include <cuda_runtime.h>
+
+#include "cuda_context.hpp"
+#include "cuda_error_check.h"
+#include "cusparse_error_check.h"
+
+static thread_local cuda_context context;
+
+cuda_context &thread_context() { return context; }
+
+cusparseHandle_t cuda_context::cusparse() {
+    if (!cusparse_handle) {
+        cusparseErrchk(cusparseCreate(&cusparse_handle));
+        cusparseErrchk(cusparseSetStream(cusparse_handle, cudaStreamPerThread));
+    }
+    return cusparse_handle;
+}
+
+void *cuda_context::scratch(size_t size) {
+    if (size > scratch_size) {
+        if (scratch_data)
+            gpuErrchk(cudaFree(scratch_data));
+        gpuErrchk(cudaMalloc(&scratch_data, size));
+        scratch_size = size;
+    }
+    return scratch_data;
+}
+
+// The CUDA runtime may already be shut down when the main thread exits, so
+// errors are ignored here
+cuda_context::~cuda_context() {
+    if (cusparse_handle)
+        cusparseDestroy(cusparse_handle);
+    if (scratch_data)
+        cudaFree(scratch_data);
+}
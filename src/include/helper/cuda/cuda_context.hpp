@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <cusparse.h>
+
+// Library state of one host thread: the cuSPARSE handle and a scratch buffer
+// for the reductions. Each thread that calls into the library gets its own
+// context, created on first use and destroyed with the thread, so that
+// independent simulations can run on different threads at the same time.
+// The handle is bound to the per-thread default stream, which the library is
+// built with (see CMakeLists.txt), so each thread also has its own stream.
+class cuda_context {
+  public:
+    cuda_context() = default;
+    cuda_context(const cuda_context &) = delete;
+    ~cuda_context();
+
+    cusparseHandle_t cusparse();
+
+    // Device buffer of at least size bytes. It is reused by the next call on
+    // the same thread.
+    void *scratch(size_t size);
+
+  private:
+    cusparseHandle_t cusparse_handle = nullptr;
+    void *scratch_data = nullptr;
+    size_t scratch_size = 0;
+};
+
+// Context of the calling thread
+cuda_context &thread_context();
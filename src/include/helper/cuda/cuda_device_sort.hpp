@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cuda_runtime.h>
+
+// Sorts a short array in increasing order, from a single thread
+template <typename C> __device__ inline void insertion_sort(C *array, int n) {
+    for (int k = 1; k < n; k++) {
+        C value = array[k];
+        int l = k - 1;
+        while (l >= 0 && array[l] > value) {
+            array[l + 1] = array[l];
+            l--;
+        }
+        array[l + 1] = value;
+    }
+}
@@ -1,82 +1,18 @@
-#include "cuda_reduction_operation.hpp"
+#include <stdexcept>
 
-__global__ void ReductionK(d_vector &A, int nValues, int shift, int op) {
-    int i = threadIdx.x + blockIdx.x * blockDim.x;
-    if (i >= nValues)
-        return;
-    for (int exp = 0; (1 << exp) < blockDim.x; exp++) {
-        if (threadIdx.x % (2 << exp) == 0 &&
-            threadIdx.x + (1 << exp) < blockDim.x && i + (1 << exp) < nValues) {
-            if (op == sum)
-                A.data[shift * i] =
-                    A.data[shift * i] + A.data[shift * (i + (1 << exp))];
-            else if (op == maximum)
-                A.data[shift * i] =
-                    (A.data[shift * i] > A.data[shift * (i + (1 << exp))])
-                        ? A.data[shift * i]
-                        : A.data[shift * (i + (1 << exp))];
-        }
-        __syncthreads();
-    }
-};
+#include "cuda_reduction_operation.hpp"
+#include "dataStructures/helper/reduce_operation.h"
 
 T ReductionOperation(d_vector &A, OpType op) {
-    int nValues = A.n;
-    dim3Pair threadblock;
-    int shift = 1;
-    do {
-        threadblock = make1DThreadBlock(nValues);
-        ReductionK<<<threadblock.block.x, threadblock.thread.x>>>(
-            *(d_vector *)A._device, nValues, shift, static_cast<int>(op));
-        gpuErrchk(cudaDeviceSynchronize());
-        nValues = int((nValues - 1) / threadblock.thread.x) + 1;
-        shift *= threadblock.thread.x;
-    } while (nValues > 1);
-    return 0;
-}
-
-__device__ int *bufferRed;
-int bufferRedSize = 0;
-__global__ void AllocateBuffer(int size) {
-    if (bufferRed)
-        delete[] bufferRed;
-    bufferRed = new int[size];
-}
-
-__global__ void ReductionIncreasing1K(int *A, int n, int shift) {
-    int i = threadIdx.x + blockIdx.x * blockDim.x;
-    if (i >= n)
-        return;
-    if (i - shift >= 0) {
-        bufferRed[i] = A[i] + A[i - shift];
-    }
-};
-
-__global__ void ReductionIncreasing2K(int *A, int n, int shift) {
-    int i = threadIdx.x + blockIdx.x * blockDim.x;
-    if (i >= n)
-        return;
-    if (i - shift >= 0) {
-        A[i] = bufferRed[i];
+    switch (op) {
+    case sum:
+        return reduce_sum(A);
+    case minimum:
+        return reduce_min(A);
+    case maximum:
+        return reduce_max(A);
     }
-};
+    throw std::invalid_argument("Unknown reduction operation\n");
+}
 
-T ReductionIncreasing(int *A, int n) {
-    if (bufferRedSize < n) {
-        AllocateBuffer<<<1, 1>>>(n);
-        bufferRedSize = n;
-    }
-    dim3Pair threadblock;
-    int shift = 1;
-    do {
-        threadblock = make1DThreadBlock(n);
-        ReductionIncreasing1K<<<threadblock.block.x, threadblock.thread.x>>>(
-            A, n, shift);
-        cudaDeviceSynchronize();
-        ReductionIncreasing2K<<<threadblock.block.x, threadblock.thread.x>>>(
-            A, n, shift);
-        cudaDeviceSynchronize();
-        shift *= 2;
-    } while (shift < n);
-    return 0;
-}
\ No newline at end of file
+int ReductionArgMax(d_vector &A) { return reduce_argmax(A).index; }
@@ -7,8 +7,11 @@
 #include "dataStructures/hd_data.hpp"
 #include "helper/cuda/cuda_thread_manager.hpp"
 
-enum OpType { sum, maximum };
+enum OpType { sum, minimum, maximum };
 
+// Sum, minimum or maximum of the values of A, without modifying A. The result
+// is reproducible bit for bit (see reduce_operation.h)
 T ReductionOperation(d_vector &A, OpType op);
 
-T ReductionIncreasing(int *A, int n);
\ No newline at end of file
+// Index of the first maximum of A, -1 if A is empty
+int ReductionArgMax(d_vector &A);
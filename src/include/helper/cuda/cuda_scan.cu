@@ -0,0 +1,133 @@
+#include <assert.h>
+
+#include "cuda_context.hpp"
+#include "cuda_error_check.h"
+#include "cuda_scan.hpp"
+
+// Fixed rather than the default block size: the shared tiles are sized at
+// compile time, and a tile is the unit of the two-pass scan
+#define SCAN_BLOCK_SIZE 256
+#define SCAN_ITEMS 8
+#define SCAN_TILE_SIZE (SCAN_BLOCK_SIZE * SCAN_ITEMS)
+
+// Inclusive scan of the tile of the block, left in tile. Thread t scans the
+// SCAN_ITEMS consecutive values starting at t * SCAN_ITEMS, then the totals
+// of the threads are scanned and added back. Values past n count as 0.
+template <typename C>
+__device__ void scan_tile(const C *in, int n, C *tile, C *totals) {
+    int first = blockIdx.x * SCAN_TILE_SIZE;
+    for (int k = 0; k < SCAN_ITEMS; k++) {
+        int j = threadIdx.x + k * SCAN_BLOCK_SIZE;
+        tile[j] = (first + j < n) ? in[first + j] : C(0);
+    }
+    __syncthreads();
+
+    C *items = tile + threadIdx.x * SCAN_ITEMS;
+    for (int k = 1; k < SCAN_ITEMS; k++)
+        items[k] += items[k - 1];
+    totals[threadIdx.x] = items[SCAN_ITEMS - 1];
+    __syncthreads();
+
+    for (int shift = 1; shift < SCAN_BLOCK_SIZE; shift *= 2) {
+        C value = totals[threadIdx.x];
+        if (threadIdx.x >= shift)
+            value += totals[threadIdx.x - shift];
+        __syncthreads();
+        totals[threadIdx.x] = value;
+        __syncthreads();
+    }
+
+    if (threadIdx.x > 0) {
+        C offset = totals[threadIdx.x - 1];
+        for (int k = 0; k < SCAN_ITEMS; k++)
+            items[k] += offset;
+    }
+    __syncthreads();
+}
+
+template <typename C>
+__global__ void tile_totalsK(const C *in, int n, C *tileTotals) {
+    __shared__ C tile[SCAN_TILE_SIZE];
+    __shared__ C totals[SCAN_BLOCK_SIZE];
+    scan_tile(in, n, tile, totals);
+    if (threadIdx.x == 0)
+        tileTotals[blockIdx.x] = totals[SCAN_BLOCK_SIZE - 1];
+}
+
+// offsets[b] is added to the values of tile b, offsets may be null when there
+// is a single tile
+template <typename C>
+__global__ void scan_tilesK(const C *in, int n, const C *offsets,
+                            bool inclusive, C *out) {
+    __shared__ C tile[SCAN_TILE_SIZE];
+    __shared__ C totals[SCAN_BLOCK_SIZE];
+    scan_tile(in, n, tile, totals);
+    C offset = (offsets) ? offsets[blockIdx.x] : C(0);
+    int first = blockIdx.x * SCAN_TILE_SIZE;
+    for (int k = 0; k < SCAN_ITEMS; k++) {
+        int j = threadIdx.x + k * SCAN_BLOCK_SIZE;
+        if (first + j >= n)
+            return;
+        if (inclusive)
+            out[first + j] = offset + tile[j];
+        else
+            out[first + j] = (j > 0) ? offset + tile[j - 1] : offset;
+    }
+}
+
+// offsets has room for the tile offsets of this level and the levels below
+template <typename C>
+void scan_levels(const C *in, C *out, int n, bool inclusive, C *offsets) {
+    int nTiles = (n - 1) / SCAN_TILE_SIZE + 1;
+    if (nTiles > 1) {
+        tile_totalsK<<<nTiles, SCAN_BLOCK_SIZE>>>(in, n, offsets);
+        gpuErrchk(cudaPeekAtLastError());
+        scan_levels(offsets, offsets, nTiles, false, offsets + nTiles);
+    }
+    scan_tilesK<<<nTiles, SCAN_BLOCK_SIZE>>>(in, n, (nTiles > 1) ? offsets
+                                                                  : nullptr,
+                                             inclusive, out);
+    gpuErrchk(cudaPeekAtLastError());
+}
+
+template <typename C> void scan(const C *in, C *out, int n, bool inclusive) {
+    if (n <= 0)
+        return;
+    // The tile offsets of all the levels live in the scratch of the thread
+    // context: allocating them on each call would synchronize the device
+    size_t nOffsets = 0;
+    for (int m = n; m > SCAN_TILE_SIZE;) {
+        m = (m - 1) / SCAN_TILE_SIZE + 1;
+        nOffsets += m;
+    }
+    C *offsets = (nOffsets > 0)
+                     ? (C *)thread_context().scratch(sizeof(C) * nOffsets)
+                     : nullptr;
+    scan_levels(in, out, n, inclusive, offsets);
+}
+
+void inclusive_scan(const int *in, int *out, int n) {
+    scan(in, out, n, true);
+}
+void exclusive_scan(const int *in, int *out, int n) {
+    scan(in, out, n, false);
+}
+void inclusive_scan(const T *in, T *out, int n) { scan(in, out, n, true); }
+void exclusive_scan(const T *in, T *out, int n) { scan(in, out, n, false); }
+
+void inclusive_scan(d_array<int> &array) {
+    assert(array.is_device);
+    scan(array.data, array.data, array.n, true);
+}
+void exclusive_scan(d_array<int> &array) {
+    assert(array.is_device);
+    scan(array.data, array.data, array.n, false);
+}
+void inclusive_scan(d_vector &array) {
+    assert(array.is_device);
+    scan(array.data, array.data, array.n, true);
+}
+void exclusive_scan(d_vector &array) {
+    assert(array.is_device);
+    scan(array.data, array.data, array.n, false);
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include "constants.hpp"
+#include "dataStructures/array.hpp"
+
+// Prefix sums of the n values of in, written to out (in == out is allowed).
+// The values are cut in tiles: a first pass computes the total of each tile,
+// the totals are scanned (recursively), and a second pass scans each tile
+// from its offset, so the work is linear in n. The tile offsets are kept in
+// the scratch buffer of the thread context (no allocation in the common
+// case), so the scans can run on several threads at the same time, but a
+// scratch pointer obtained before a scan is no longer valid after it.
+// inclusive: out[i] = in[0] + ... + in[i]
+// exclusive: out[i] = in[0] + ... + in[i - 1], out[0] = 0
+void inclusive_scan(const int *in, int *out, int n);
+void exclusive_scan(const int *in, int *out, int n);
+void inclusive_scan(const T *in, T *out, int n);
+void exclusive_scan(const T *in, T *out, int n);
+
+// In place on a device array
+void inclusive_scan(d_array<int> &array);
+void exclusive_scan(d_array<int> &array);
+void inclusive_scan(d_vector &array);
+void exclusive_scan(d_vector &array);
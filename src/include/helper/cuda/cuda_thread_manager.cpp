@@ -1,3 +1,5 @@
+#include <assert.h>
+
 #include "cuda_thread_manager.hpp"
 
 dim3Pair::dim3Pair(){};
@@ -9,6 +11,14 @@ dim3Pair::dim3Pair(int blockX, int blockY, int blockZ, int threadX, int threadY,
                    int threadZ)
     : block(blockX, blockY, blockZ), thread(threadX, threadY, threadZ){};
 
+int default_block_size = BLOCK_SIZE * BLOCK_SIZE;
+
+void set_block_size(int blockSize) {
+    assert(blockSize > 0 && blockSize <= BLOCK_SIZE * BLOCK_SIZE);
+    default_block_size = blockSize;
+}
+int get_block_size() { return default_block_size; }
+
 dim3Pair make1DThreadBlock(int computeSize, int blockSize) {
     return MakeWide1DThreadBlock(computeSize, 1, blockSize);
 }
@@ -17,8 +17,13 @@ struct dim3Pair {
              int threadZ);
 };
 
+// Number of threads per block used by default for 1D launches
+extern int default_block_size;
+void set_block_size(int blockSize);
+int get_block_size();
+
 dim3Pair make1DThreadBlock(int computeSize,
-                           int blockSize = BLOCK_SIZE * BLOCK_SIZE);
+                           int blockSize = default_block_size);
 
 dim3Pair MakeWide1DThreadBlock(int computeSize, int width,
-                               int blockSize = BLOCK_SIZE * BLOCK_SIZE);
\ No newline at end of file
+                               int blockSize = default_block_size);
\ No newline at end of file
@@ -0,0 +1,117 @@
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <cuda_runtime.h>
+#include <fstream>
+#include <new>
+#include <pthread.h>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unistd.h>
+
+#include "cuda_error_check.h"
+#include "numa_host_memory.hpp"
+
+// Parses a sysfs CPU list, e.g. "0-11,24-35"
+static std::vector<int> parse_cpu_list(const std::string &text) {
+    std::vector<int> cpus;
+    std::stringstream stream(text);
+    std::string range;
+    while (std::getline(stream, range, ',')) {
+        if (range.empty() || !std::isdigit(range[0]))
+            continue;
+        auto dash = range.find('-');
+        int first = std::stoi(range.substr(0, dash));
+        int last = (dash == std::string::npos)
+                       ? first
+                       : std::stoi(range.substr(dash + 1));
+        for (int cpu = first; cpu <= last; cpu++)
+            cpus.push_back(cpu);
+    }
+    return cpus;
+}
+
+std::vector<int> device_local_cpus(int device) {
+    char busId[32];
+    if (cudaDeviceGetPCIBusId(busId, sizeof(busId), device) != cudaSuccess)
+        return {};
+    std::string path = busId;
+    std::transform(path.begin(), path.end(), path.begin(), ::tolower);
+    std::ifstream file("/sys/bus/pci/devices/" + path + "/local_cpulist");
+    std::string text;
+    if (!std::getline(file, text))
+        return {};
+    auto cpus = parse_cpu_list(text);
+    // A device of no particular node lists all the CPUs: nothing to bind
+    if ((int)cpus.size() >= (int)std::thread::hardware_concurrency())
+        return {};
+    return cpus;
+}
+
+std::vector<int> row_partition(int n, int nParts) {
+    std::vector<int> bounds(nParts + 1);
+    for (int k = 0; k <= nParts; k++)
+        bounds[k] = (int)((long long)n * k / nParts);
+    return bounds;
+}
+
+cpu_binding::cpu_binding(const std::vector<int> &cpus) {
+    if (cpus.empty())
+        return;
+    pthread_t self = pthread_self();
+    if (pthread_getaffinity_np(self, sizeof(previous), &previous) != 0)
+        return;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : cpus)
+        if (cpu < CPU_SETSIZE)
+            CPU_SET(cpu, &set);
+    bound = pthread_setaffinity_np(self, sizeof(set), &set) == 0;
+}
+
+cpu_binding::~cpu_binding() {
+    if (bound)
+        pthread_setaffinity_np(pthread_self(), sizeof(previous), &previous);
+}
+
+void *numa_host_alloc(size_t size) {
+    size_t pageSize = sysconf(_SC_PAGESIZE);
+    size_t nPages = (size + pageSize - 1) / pageSize;
+    void *data = std::aligned_alloc(pageSize, nPages * pageSize);
+    if (!data)
+        throw std::bad_alloc();
+
+    int device = 0;
+    gpuErrchk(cudaGetDevice(&device));
+    auto cpus = device_local_cpus(device);
+    int nThreads = std::max<int>(
+        1, std::min<size_t>({cpus.size(), NUMA_TOUCH_THREADS, nPages}));
+    auto bounds = row_partition(nPages, nThreads);
+    auto touch = [&](int k) {
+        cpu_binding binding(cpus);
+        char *first = (char *)data + bounds[k] * pageSize;
+        std::memset(first, 0, (bounds[k + 1] - bounds[k]) * pageSize);
+    };
+    if (nThreads == 1) {
+        touch(0);
+    } else {
+        std::vector<std::thread> threads;
+        for (int k = 0; k < nThreads; k++)
+            threads.emplace_back(touch, k);
+        for (auto &thread : threads)
+            thread.join();
+    }
+
+    gpuErrchk(cudaHostRegister(data, nPages * pageSize,
+                               cudaHostRegisterDefault));
+    return data;
+}
+
+void numa_host_free(void *data) {
+    if (!data)
+        return;
+    cudaHostUnregister(data);
+    std::free(data);
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <sched.h>
+#include <vector>
+
+// Host memory placement on multi-socket nodes. Each GPU is attached to one
+// socket, and its transfers with the host memory of the other sockets cross
+// the socket link, at a fraction of the bandwidth. The pages of a buffer are
+// placed on the NUMA node of the thread that touches them first, so the
+// page-locked buffers of a device are first touched from the CPUs of its
+// node, and the host threads that drive the device run there too.
+// Without NUMA information (single socket, or no sysfs) nothing is bound.
+
+// CPUs of the NUMA node of the device, from sysfs. Empty if unknown.
+std::vector<int> device_local_cpus(int device);
+
+// Bounds of nParts contiguous blocks of n rows, of sizes differing by at most
+// one: block k is [bounds[k], bounds[k + 1])
+std::vector<int> row_partition(int n, int nParts);
+
+// Binds the calling thread to the CPUs while it exists, then restores its
+// previous affinity. Does nothing if cpus is empty or the binding fails.
+class cpu_binding {
+  public:
+    cpu_binding(const std::vector<int> &cpus);
+    cpu_binding(const cpu_binding &) = delete;
+    ~cpu_binding();
+
+  private:
+    bool bound = false;
+    cpu_set_t previous;
+};
+
+// Page-locked buffer of size bytes (zeroed) on the NUMA node of the current
+// device: its pages are first touched in row_partition blocks, one per CPU of
+// the node (at most NUMA_TOUCH_THREADS), each thread bound to the node, then
+// registered with CUDA. Free with numa_host_free.
+#define NUMA_TOUCH_THREADS 8
+void *numa_host_alloc(size_t size);
+void numa_host_free(void *data);
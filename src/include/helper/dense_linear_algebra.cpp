@@ -0,0 +1,113 @@
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+#include "dense_linear_algebra.hpp"
+
+bool cholesky(std::vector<T> &a, int n) {
+    for (int j = 0; j < n; j++) {
+        T diagonal = a[j * n + j];
+        for (int k = 0; k < j; k++)
+            diagonal -= a[j * n + k] * a[j * n + k];
+        if (!(diagonal > 0))
+            return false;
+        diagonal = std::sqrt(diagonal);
+        a[j * n + j] = diagonal;
+        for (int i = j + 1; i < n; i++) {
+            T value = a[i * n + j];
+            for (int k = 0; k < j; k++)
+                value -= a[i * n + k] * a[j * n + k];
+            a[i * n + j] = value / diagonal;
+        }
+        for (int k = j + 1; k < n; k++)
+            a[j * n + k] = 0;
+    }
+    return true;
+}
+
+void lower_solve(const std::vector<T> &L, int n, T *b, int m) {
+    for (int i = 0; i < n; i++)
+        for (int c = 0; c < m; c++) {
+            T value = b[i * m + c];
+            for (int k = 0; k < i; k++)
+                value -= L[i * n + k] * b[k * m + c];
+            b[i * m + c] = value / L[i * n + i];
+        }
+}
+
+void lower_transpose_solve(const std::vector<T> &L, int n, T *b, int m) {
+    for (int i = n - 1; i >= 0; i--)
+        for (int c = 0; c < m; c++) {
+            T value = b[i * m + c];
+            for (int k = i + 1; k < n; k++)
+                value -= L[k * n + i] * b[k * m + c];
+            b[i * m + c] = value / L[i * n + i];
+        }
+}
+
+void cholesky_solve(const std::vector<T> &L, int n, T *b) {
+    lower_solve(L, n, b, 1);
+    lower_transpose_solve(L, n, b, 1);
+}
+
+void symmetric_eigen(std::vector<T> &a, int n, std::vector<T> &values,
+                     std::vector<T> &vectors) {
+    std::vector<T> v(n * n, 0);
+    for (int i = 0; i < n; i++)
+        v[i * n + i] = 1;
+
+    for (int sweep = 0; sweep < 100; sweep++) {
+        T offDiagonal = 0;
+        T total = 0;
+        for (int i = 0; i < n; i++)
+            for (int j = 0; j < n; j++) {
+                total += a[i * n + j] * a[i * n + j];
+                if (i != j)
+                    offDiagonal += a[i * n + j] * a[i * n + j];
+            }
+        if (offDiagonal <= 1e-30 * total)
+            break;
+        for (int p = 0; p < n; p++)
+            for (int q = p + 1; q < n; q++) {
+                T apq = a[p * n + q];
+                if (apq == 0)
+                    continue;
+                // Rotation that zeroes a[p][q]
+                T theta = (a[q * n + q] - a[p * n + p]) / (2 * apq);
+                T t = ((theta >= 0) ? 1 : -1) /
+                      (std::fabs(theta) + std::sqrt(theta * theta + 1));
+                T c = 1 / std::sqrt(t * t + 1);
+                T s = t * c;
+                for (int k = 0; k < n; k++) {
+                    T akp = a[k * n + p];
+                    T akq = a[k * n + q];
+                    a[k * n + p] = c * akp - s * akq;
+                    a[k * n + q] = s * akp + c * akq;
+                }
+                for (int k = 0; k < n; k++) {
+                    T apk = a[p * n + k];
+                    T aqk = a[q * n + k];
+                    a[p * n + k] = c * apk - s * aqk;
+                    a[q * n + k] = s * apk + c * aqk;
+                }
+                for (int k = 0; k < n; k++) {
+                    T vkp = v[k * n + p];
+                    T vkq = v[k * n + q];
+                    v[k * n + p] = c * vkp - s * vkq;
+                    v[k * n + q] = s * vkp + c * vkq;
+                }
+            }
+    }
+
+    std::vector<int> order(n);
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(),
+              [&a, n](int i, int j) { return a[i * n + i] > a[j * n + j]; });
+    values.resize(n);
+    vectors.resize(n * n);
+    for (int c = 0; c < n; c++) {
+        values[c] = a[order[c] * n + order[c]];
+        for (int k = 0; k < n; k++)
+            vectors[k * n + c] = v[k * n + order[c]];
+    }
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <vector>
+
+#include "constants.hpp"
+
+// Small dense symmetric matrices on the host, stored row-major in a vector of
+// n * n values.
+
+// Cholesky factorization a = L L^T, L is written to the lower triangle of a
+// (the upper triangle is zeroed). Returns false if a is not positive definite.
+bool cholesky(std::vector<T> &a, int n);
+// Solves L L^T x = b in place, with L from cholesky
+void cholesky_solve(const std::vector<T> &L, int n, T *b);
+// In place on the columns of the n x m row-major matrix b: L^-1 b, L^-T b
+void lower_solve(const std::vector<T> &L, int n, T *b, int m);
+void lower_transpose_solve(const std::vector<T> &L, int n, T *b, int m);
+
+// Eigenvalues (in decreasing order) and eigenvectors (the columns of the
+// row-major n x n matrix vectors) of a symmetric matrix, by cyclic Jacobi
+// rotations. a is overwritten.
+void symmetric_eigen(std::vector<T> &a, int n, std::vector<T> &values,
+                     std::vector<T> &vectors);
@@ -0,0 +1,99 @@
+#include <algorithm>
+
+#include "thread_pool.hpp"
+
+thread_pool::thread_pool(int nThreads) {
+    if (nThreads <= 0)
+        nThreads = std::max(1u, std::thread::hardware_concurrency());
+    for (int k = 0; k < nThreads; k++)
+        queues.emplace_back(new job_queue());
+    for (int k = 0; k < nThreads; k++)
+        workers.emplace_back(&thread_pool::run, this, k);
+}
+
+thread_pool::~thread_pool() {
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        all_done.wait(lock, [this] { return n_pending == 0; });
+        stopping = true;
+    }
+    work_available.notify_all();
+    for (auto &worker : workers)
+        worker.join();
+}
+
+void thread_pool::submit(std::function<void()> job) {
+    int k;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        k = next_queue++ % queues.size();
+        n_pending++;
+    }
+    {
+        std::lock_guard<std::mutex> lock(queues[k]->mutex);
+        queues[k]->jobs.push_back(std::move(job));
+    }
+    {
+        // Under the lock, so that a worker can not miss the notification
+        // between checking n_queued and waiting
+        std::lock_guard<std::mutex> lock(mutex);
+        n_queued++;
+    }
+    work_available.notify_one();
+}
+
+void thread_pool::wait() {
+    std::unique_lock<std::mutex> lock(mutex);
+    all_done.wait(lock, [this] { return n_pending == 0; });
+    if (error) {
+        auto rethrown = error;
+        error = nullptr;
+        std::rethrow_exception(rethrown);
+    }
+}
+
+int thread_pool::size() const { return workers.size(); }
+
+bool thread_pool::take_job(int worker, std::function<void()> &job) {
+    int n = queues.size();
+    for (int k = 0; k < n; k++) {
+        auto &queue = *queues[(worker + k) % n];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.jobs.empty())
+            continue;
+        if (k == 0) {
+            job = std::move(queue.jobs.front());
+            queue.jobs.pop_front();
+        } else {
+            job = std::move(queue.jobs.back());
+            queue.jobs.pop_back();
+        }
+        n_queued--;
+        return true;
+    }
+    return false;
+}
+
+void thread_pool::run(int worker) {
+    while (true) {
+        std::function<void()> job;
+        if (take_job(worker, job)) {
+            try {
+                job();
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (!error)
+                    error = std::current_exception();
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--n_pending == 0)
+                all_done.notify_all();
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(mutex);
+        work_available.wait(lock,
+                            [this] { return stopping || n_queued > 0; });
+        if (stopping && n_queued == 0)
+            return;
+    }
+}
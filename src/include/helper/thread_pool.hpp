@@ -0,0 +1,52 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work-stealing thread pool. Each worker has its own queue of jobs: it takes
+// jobs from the front of its queue, and once it is empty steals from the back
+// of the queues of the other workers. Jobs are distributed round robin.
+class thread_pool {
+  public:
+    // nThreads = 0 uses one worker per hardware thread
+    thread_pool(int nThreads = 0);
+    thread_pool(const thread_pool &) = delete;
+    // Waits for the submitted jobs
+    ~thread_pool();
+
+    void submit(std::function<void()> job);
+
+    // Blocks until all the submitted jobs are done. Rethrows the first
+    // exception thrown by a job, if any.
+    void wait();
+
+    int size() const;
+
+  private:
+    struct job_queue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> jobs;
+    };
+
+    std::vector<std::unique_ptr<job_queue>> queues;
+    std::vector<std::thread> workers;
+
+    std::mutex mutex;
+    std::condition_variable work_available;
+    std::condition_variable all_done;
+    std::atomic<int> n_queued{0}; // Submitted, not started
+    int n_pending = 0;            // Submitted, not finished
+    unsigned next_queue = 0;
+    bool stopping = false;
+    std::exception_ptr error;
+
+    bool take_job(int worker, std::function<void()> &job);
+    void run(int worker);
+};
@@ -1,92 +1,113 @@
 #define GET_PROF
 
 #include "cuda_runtime.h"
-#include "include/helper/cuda/cublas_error_check.h"
 #include "include/helper/cuda/cusparse_error_check.h"
 #include <assert.h>
 #include <stdio.h>
 
 #include "basic_operations.hpp"
 #include "dataStructures/hd_data.hpp"
+#include "dataStructures/helper/reduce_operation.h"
 #include "dataStructures/matrix_element.hpp"
+#include "helper/cuda/cuda_context.hpp"
 #include "helper/cuda/cuda_error_check.h"
 #include "helper/cuda/cuda_reduction_operation.hpp"
+#include "helper/cuda/cuda_scan.hpp"
 #include "helper/cuda/cuda_thread_manager.hpp"
 
-chrono_profiler profDot;
-void print_dotprofiler() { profDot.print(); }
-
-cusparseHandle_t cusparseHandle = NULL;
-cublasHandle_t cublasHandle = NULL;
-
 void dot(d_spmatrix &d_mat, d_vector &x, d_vector &result, bool synchronize) {
-    if (!cusparseHandle)
-        cusparseErrchk(cusparseCreate(&cusparseHandle));
     assert(d_mat.is_device && x.is_device && result.is_device);
     if (&x == &result) {
         printf("Error: X and Result vectors should not be the same instance\n");
         return;
     }
+    auto &context = thread_context();
     T one = 1.0;
     T zero = 0.0;
     size_t size = 0;
-    T *buffer;
     auto mat_descr = d_mat.make_sp_descriptor();
     auto x_descr = x.make_descriptor();
     auto res_descr = result.make_descriptor();
     cusparseErrchk(cusparseSpMV_bufferSize(
-        cusparseHandle, CUSPARSE_OPERATION_NON_TRANSPOSE, &one, mat_descr,
+        context.cusparse(), CUSPARSE_OPERATION_NON_TRANSPOSE, &one, mat_descr,
         x_descr, &zero, res_descr, T_Cuda, CUSPARSE_MV_ALG_DEFAULT, &size));
-    if (size > 0)
-        printf("Alert! size >0 \n");
-    cudaMalloc(&buffer, size);
+    void *buffer = (size > 0) ? context.scratch(size) : nullptr;
     cusparseErrchk(cusparseSpMV(
-        cusparseHandle, CUSPARSE_OPERATION_NON_TRANSPOSE, &one, mat_descr,
+        context.cusparse(), CUSPARSE_OPERATION_NON_TRANSPOSE, &one, mat_descr,
         x_descr, &zero, res_descr, T_Cuda, CUSPARSE_MV_ALG_DEFAULT, buffer));
     cusparseDestroyDnVec(x_descr);
     cusparseDestroyDnVec(res_descr);
     cusparseDestroySpMat(mat_descr);
+    if (synchronize)
+        gpuErrchk(cudaStreamSynchronize(cudaStreamPerThread));
 }
 
-d_vector buffer(0);
-
-__global__ void dotK(d_vector &x, d_vector &y, d_vector &buffer) {
-    int i = threadIdx.x + blockIdx.x * blockDim.x;
-    if (i >= x.n)
-        return;
-    buffer.data[i] = x.data[i] * y.data[i];
-    return;
-}
+struct dot_op {
+    const T *x;
+    const T *y;
+    __device__ T operator()(int i) const { return x[i] * y[i]; }
+};
 
+// Deterministic, unlike cublas<t>dot whose summation order depends on the
+// device. result may be in host or device memory.
 void dot(d_vector &x, d_vector &y, T &result, bool synchronize) {
     assert(x.is_device && y.is_device);
     assert(x.n == y.n);
+    segmented_transform_reduce(
+        x.n, 1, reduce_single_segment_op<dot_op>{dot_op{x.data, y.data}}, T(0),
+        reduce_sum_op<T>(), &result, synchronize);
+}
 
-    if (!cublasHandle)
-        cublasErrchk(cublasCreate(&cublasHandle));
-
-#ifdef USE_DOUBLE
-    cublasErrchk(cublasDdot(cublasHandle, x.n, x.data, 1, y.data, 1, &result));
-#else
-    cublasErrchk(cublasSdot(cublasHandle, x.n, x.data, sizeof(T), y.data,
-                            sizeof(T), &result));
-#endif
-    // dim3Pair threadblock = make1DThreadBlock(x.n);
-    // if (buffer.n < x.n)
-    //     buffer.resize(x.n);
-    // else
-    //     buffer.n = x.n;
-
-    // dotK<<<threadblock.block, threadblock.thread>>>(*(d_vector *)x._device,
-    //                                                 *(d_vector *)y._device,
-    //                                                 *(d_vector
-    //                                                 *)buffer._device);
-    // ReductionOperation(buffer, sum);
-    // cudaMemcpy(&result, buffer.data, sizeof(T), cudaMemcpyDeviceToDevice);
-    if (synchronize) {
-        gpuErrchk(cudaDeviceSynchronize());
-    } else
-        return;
+void dot_block(d_spmatrix &d_mat, d_vector &x, d_vector &result,
+               int nColumns, bool synchronize) {
+    assert(d_mat.is_device && x.is_device && result.is_device);
+    assert(x.n == d_mat.cols * nColumns && result.n == d_mat.rows * nColumns);
+    assert(&x != &result);
+    auto &context = thread_context();
+    T one = 1.0;
+    T zero = 0.0;
+    size_t size = 0;
+    cusparseDnMatDescr_t x_descr, res_descr;
+    auto mat_descr = d_mat.make_sp_descriptor();
+    cusparseErrchk(cusparseCreateDnMat(&x_descr, d_mat.cols, nColumns,
+                                       d_mat.cols, x.data, T_Cuda,
+                                       CUSPARSE_ORDER_COL));
+    cusparseErrchk(cusparseCreateDnMat(&res_descr, d_mat.rows, nColumns,
+                                       d_mat.rows, result.data, T_Cuda,
+                                       CUSPARSE_ORDER_COL));
+    cusparseErrchk(cusparseSpMM_bufferSize(
+        context.cusparse(), CUSPARSE_OPERATION_NON_TRANSPOSE,
+        CUSPARSE_OPERATION_NON_TRANSPOSE, &one, mat_descr, x_descr, &zero,
+        res_descr, T_Cuda, CUSPARSE_MM_ALG_DEFAULT, &size));
+    void *buffer = (size > 0) ? context.scratch(size) : nullptr;
+    cusparseErrchk(cusparseSpMM(
+        context.cusparse(), CUSPARSE_OPERATION_NON_TRANSPOSE,
+        CUSPARSE_OPERATION_NON_TRANSPOSE, &one, mat_descr, x_descr, &zero,
+        res_descr, T_Cuda, CUSPARSE_MM_ALG_DEFAULT, buffer));
+    cusparseDestroyDnMat(x_descr);
+    cusparseDestroyDnMat(res_descr);
+    cusparseDestroySpMat(mat_descr);
+    if (synchronize)
+        gpuErrchk(cudaStreamSynchronize(cudaStreamPerThread));
+}
+
+struct dot_columns_op {
+    const T *x;
+    const T *y;
+    int n;
+    __device__ T operator()(int column, int i) const {
+        return x[column * n + i] * y[column * n + i];
+    }
+};
+
+void dot_columns(d_vector &x, d_vector &y, int nColumns, T *results,
+                 bool synchronize) {
+    assert(x.is_device && y.is_device);
+    assert(x.n == y.n && x.n % nColumns == 0);
+    int n = x.n / nColumns;
+    segmented_transform_reduce(n, nColumns, dot_columns_op{x.data, y.data, n},
+                               T(0), reduce_sum_op<T>(), results,
+                               synchronize);
 }
 
 __global__ void vector_sumK(d_vector &a, d_vector &b, T &alpha, d_vector &c) {
@@ -105,7 +126,7 @@ void vector_sum(d_vector &a, d_vector &b, T &alpha, d_vector &c,
         *(d_vector *)a._device, *(d_vector *)b._device, alpha,
         *(d_vector *)c._device);
     if (synchronize)
-        gpuErrchk(cudaDeviceSynchronize());
+        gpuErrchk(cudaStreamSynchronize(cudaStreamPerThread));
 }
 
 void vector_sum(d_vector &a, d_vector &b, d_vector &c, bool synchronize) {
@@ -200,7 +221,7 @@ void matrix_sum(d_spmatrix &a, d_spmatrix &b, T &alpha, d_spmatrix &c) {
     cudaMalloc(&nnzs, sizeof(int) * (a.rows + 1));
     auto tb = make1DThreadBlock(a.rows);
     sum_nnzK<<<tb.block, tb.thread>>>(*a._device, *b._device, nnzs);
-    ReductionIncreasing(nnzs, a.rows + 1);
+    inclusive_scan(nnzs, nnzs, a.rows + 1);
     hd_data<int> nnz(&nnzs[a.rows], true);
     c.set_nnz(nnz());
 
@@ -209,7 +230,7 @@ void matrix_sum(d_spmatrix &a, d_spmatrix &b, T &alpha, d_spmatrix &c) {
 
     set_valuesK<<<tb.block, tb.thread>>>(*a._device, *b._device, alpha,
                                          *c._device);
-    gpuErrchk(cudaDeviceSynchronize());
+    gpuErrchk(cudaStreamSynchronize(cudaStreamPerThread));
     return;
 }
 
@@ -218,6 +239,185 @@ void matrix_sum(d_spmatrix &a, d_spmatrix &b, d_spmatrix &c) {
     matrix_sum(a, b, d_alpha(true), c);
 }
 
+// Sorts the entries of each row of a CSR matrix by column, by insertion:
+// the rows are short, and equal columns keep their order
+__device__ void sort_row(int *cols, T *values, int n) {
+    for (int k = 1; k < n; k++) {
+        int col = cols[k];
+        T value = values[k];
+        int l = k - 1;
+        for (; l >= 0 && cols[l] > col; l--) {
+            cols[l + 1] = cols[l];
+            values[l + 1] = values[l];
+        }
+        cols[l + 1] = col;
+        values[l + 1] = value;
+    }
+}
+
+__global__ void count_columnsK(int nnz, const int *cols, int *counts) {
+    int k = threadIdx.x + blockIdx.x * blockDim.x;
+    if (k >= nnz)
+        return;
+    atomicAdd(&counts[cols[k] + 1], 1);
+}
+
+__global__ void scatter_transposeK(int rows, const int *rowPtr,
+                                   const int *cols, const T *values,
+                                   int *cursor, int *atCols, T *atValues) {
+    int i = threadIdx.x + blockIdx.x * blockDim.x;
+    if (i >= rows)
+        return;
+    for (int k = rowPtr[i]; k < rowPtr[i + 1]; k++) {
+        int position = atomicAdd(&cursor[cols[k]], 1);
+        atCols[position] = i;
+        atValues[position] = values[k];
+    }
+}
+
+__global__ void sort_rowsK(int rows, const int *rowPtr, int *cols, T *values) {
+    int i = threadIdx.x + blockIdx.x * blockDim.x;
+    if (i >= rows)
+        return;
+    sort_row(cols + rowPtr[i], values + rowPtr[i], rowPtr[i + 1] - rowPtr[i]);
+}
+
+void transpose(d_spmatrix &a, d_spmatrix &at) {
+    assert(a.is_device && at.is_device && a.type == CSR);
+    assert(&a != &at);
+    at.rows = a.cols;
+    at.cols = a.rows;
+    at.type = CSR;
+    at.set_nnz(a.nnz);
+    if (a.nnz == 0)
+        return;
+    d_array<int> cursor(a.cols + 1);
+    cursor.fill(0);
+    auto tb = make1DThreadBlock(a.nnz);
+    count_columnsK<<<tb.block, tb.thread>>>(a.nnz, a.colPtr, cursor.data);
+    gpuErrchk(cudaPeekAtLastError());
+    inclusive_scan(cursor.data, cursor.data, a.cols + 1);
+    gpuErrchk(cudaMemcpy(at.rowPtr, cursor.data, sizeof(int) * (a.cols + 1),
+                         cudaMemcpyDeviceToDevice));
+    tb = make1DThreadBlock(a.rows);
+    scatter_transposeK<<<tb.block, tb.thread>>>(a.rows, a.rowPtr, a.colPtr,
+                                                a.data, cursor.data, at.colPtr,
+                                                at.data);
+    gpuErrchk(cudaPeekAtLastError());
+    // The atomics leave the rows in any order
+    tb = make1DThreadBlock(at.rows);
+    sort_rowsK<<<tb.block, tb.thread>>>(at.rows, at.rowPtr, at.colPtr,
+                                        at.data);
+    gpuErrchk(cudaPeekAtLastError());
+    gpuErrchk(cudaStreamSynchronize(cudaStreamPerThread));
+}
+
+// bound[i + 1] = number of products of row i of a with the rows of b
+__global__ void product_boundK(int rows, const int *aRowPtr, const int *aCols,
+                               const int *bRowPtr, int *bound) {
+    int i = threadIdx.x + blockIdx.x * blockDim.x;
+    if (i >= rows)
+        return;
+    if (i == 0)
+        bound[0] = 0;
+    int count = 0;
+    for (int k = aRowPtr[i]; k < aRowPtr[i + 1]; k++)
+        count += bRowPtr[aCols[k] + 1] - bRowPtr[aCols[k]];
+    bound[i + 1] = count;
+}
+
+// Expands the products of row i in its slice of the buffers, sorts them by
+// column and sums the products of the same column (expand, sort, compress)
+__global__ void product_rowsK(int rows, const int *aRowPtr, const int *aCols,
+                              const T *aValues, const int *bRowPtr,
+                              const int *bCols, const T *bValues,
+                              const int *offsets, int *cols, T *values,
+                              int *counts) {
+    int i = threadIdx.x + blockIdx.x * blockDim.x;
+    if (i >= rows)
+        return;
+    if (i == 0)
+        counts[0] = 0;
+    int start = offsets[i];
+    int n = 0;
+    for (int k = aRowPtr[i]; k < aRowPtr[i + 1]; k++) {
+        int row = aCols[k];
+        for (int l = bRowPtr[row]; l < bRowPtr[row + 1]; l++) {
+            cols[start + n] = bCols[l];
+            values[start + n] = aValues[k] * bValues[l];
+            n++;
+        }
+    }
+    sort_row(cols + start, values + start, n);
+    int nUnique = 0;
+    for (int k = 0; k < n; k++) {
+        if (nUnique > 0 && cols[start + nUnique - 1] == cols[start + k]) {
+            values[start + nUnique - 1] += values[start + k];
+            continue;
+        }
+        cols[start + nUnique] = cols[start + k];
+        values[start + nUnique] = values[start + k];
+        nUnique++;
+    }
+    counts[i + 1] = nUnique;
+}
+
+__global__ void gather_rowsK(int rows, const int *offsets, const int *cols,
+                             const T *values, const int *rowPtr, int *cCols,
+                             T *cValues) {
+    int i = threadIdx.x + blockIdx.x * blockDim.x;
+    if (i >= rows)
+        return;
+    for (int k = 0; k < rowPtr[i + 1] - rowPtr[i]; k++) {
+        cCols[rowPtr[i] + k] = cols[offsets[i] + k];
+        cValues[rowPtr[i] + k] = values[offsets[i] + k];
+    }
+}
+
+void matrix_product(d_spmatrix &a, d_spmatrix &b, d_spmatrix &c) {
+    assert(a.is_device && b.is_device && c.is_device);
+    assert(a.type == CSR && b.type == CSR && a.cols == b.rows);
+    assert(&c != &a && &c != &b);
+    c.rows = a.rows;
+    c.cols = b.cols;
+    c.type = CSR;
+    if (a.nnz == 0 || b.nnz == 0) {
+        c.set_nnz(0);
+        return;
+    }
+    d_array<int> offsets(a.rows + 1);
+    auto tb = make1DThreadBlock(a.rows);
+    product_boundK<<<tb.block, tb.thread>>>(a.rows, a.rowPtr, a.colPtr,
+                                            b.rowPtr, offsets.data);
+    gpuErrchk(cudaPeekAtLastError());
+    inclusive_scan(offsets.data, offsets.data, a.rows + 1);
+    int nProducts;
+    gpuErrchk(cudaMemcpy(&nProducts, offsets.data + a.rows, sizeof(int),
+                         cudaMemcpyDeviceToHost));
+
+    d_array<int> cols(nProducts);
+    d_vector values(nProducts);
+    d_array<int> counts(a.rows + 1);
+    product_rowsK<<<tb.block, tb.thread>>>(
+        a.rows, a.rowPtr, a.colPtr, a.data, b.rowPtr, b.colPtr, b.data,
+        offsets.data, cols.data, values.data, counts.data);
+    gpuErrchk(cudaPeekAtLastError());
+    inclusive_scan(counts.data, counts.data, a.rows + 1);
+    int nnz;
+    gpuErrchk(cudaMemcpy(&nnz, counts.data + a.rows, sizeof(int),
+                         cudaMemcpyDeviceToHost));
+    c.set_nnz(nnz);
+    if (nnz == 0)
+        return;
+    gpuErrchk(cudaMemcpy(c.rowPtr, counts.data, sizeof(int) * (a.rows + 1),
+                         cudaMemcpyDeviceToDevice));
+    gather_rowsK<<<tb.block, tb.thread>>>(a.rows, offsets.data, cols.data,
+                                          values.data, c.rowPtr, c.colPtr,
+                                          c.data);
+    gpuErrchk(cudaPeekAtLastError());
+    gpuErrchk(cudaStreamSynchronize(cudaStreamPerThread));
+}
+
 __global__ void scalar_multK(T *data, int n, T &alpha) {
     int i = threadIdx.x + blockIdx.x * blockDim.x;
     if (i >= n)
@@ -16,6 +16,15 @@ const cudaDataType T_Cuda = CUDA_R_32F;
 void dot(d_spmatrix &d_mat, d_vector &x, d_vector &y, bool synchronize = true);
 void dot(d_vector &x, d_vector &y, T &result, bool synchronize = true);
 
+// Blocks of nColumns vectors, stored one after the other (column-major).
+// Computes result = d_mat * x for all the columns in one pass over d_mat
+void dot_block(d_spmatrix &d_mat, d_vector &x, d_vector &result,
+               int nColumns, bool synchronize = true);
+// results[k] = dot product of the columns k of x and y, results in host or
+// device memory
+void dot_columns(d_vector &x, d_vector &y, int nColumns, T *results,
+                 bool synchronize = true);
+
 // Computes C = A + alpha*B
 void vector_sum(d_vector &a, d_vector &b, T &alpha, d_vector &c,
                 bool synchronize = true);
@@ -25,7 +34,12 @@ void vector_sum(d_vector &a, d_vector &b, d_vector &c, bool synchronize = true);
 void matrix_sum(d_spmatrix &a, d_spmatrix &b, T &alpha, d_spmatrix &c);
 void matrix_sum(d_spmatrix &a, d_spmatrix &b, d_spmatrix &c);
 
+// CSR matrices on the device. at = a^T, and c = a b with the columns of each
+// row of c in increasing order. Both allocate temporaries, they are meant for
+// setups (e.g. amg_preconditioner) rather than for every iteration.
+void transpose(d_spmatrix &a, d_spmatrix &at);
+void matrix_product(d_spmatrix &a, d_spmatrix &b, d_spmatrix &c);
+
 void scalar_mult(d_spmatrix &a, T &alpha);
 void scalar_mult(d_vector &a, T &alpha);
 
-void print_dotprofiler();
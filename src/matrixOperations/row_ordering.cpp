@@ -4,16 +4,13 @@
 #include <cusparse.h>
 
 #include "dataStructures/sparse_matrix.hpp"
+#include "helper/cuda/cuda_context.hpp"
 #include "helper/cuda/cuda_error_check.h"
 #include "helper/cuda/cusparse_error_check.h"
 
-cusparseHandle_t rowOrdHandle = NULL;
-
 void RowOrdering(d_spmatrix &d_mat) {
     assert(d_mat.is_device);
-    if (rowOrdHandle == NULL) {
-        cusparseErrchk(cusparseCreate(&rowOrdHandle));
-    }
+    cusparseHandle_t rowOrdHandle = thread_context().cusparse();
     int *d_P = NULL;
     T *d_cooVals_sorted = NULL;
     size_t pBufferSizeInBytes = 0;
@@ -27,7 +24,7 @@ void RowOrdering(d_spmatrix &d_mat) {
     gpuErrchk(cudaMalloc(&d_P, sizeof(int) * d_mat.nnz));
     gpuErrchk(cudaMalloc(&d_cooVals_sorted, sizeof(double) * d_mat.nnz));
     gpuErrchk(cudaMalloc(&pBuffer, sizeof(char) * pBufferSizeInBytes));
-    gpuErrchk(cudaDeviceSynchronize());
+    gpuErrchk(cudaStreamSynchronize(cudaStreamPerThread));
 
     /* step 3: setup permutation vector P to identity */
     cusparseErrchk(
@@ -58,8 +55,5 @@ void RowOrdering(d_spmatrix &d_mat) {
         gpuErrchk(cudaFree(pBuffer));
     if (freeMe)
         gpuErrchk(cudaFree(freeMe));
-    if (rowOrdHandle)
-        cusparseDestroy(rowOrdHandle);
-    rowOrdHandle = NULL;
-    gpuErrchk(cudaDeviceSynchronize());
+    gpuErrchk(cudaStreamSynchronize(cudaStreamPerThread));
 }
\ No newline at end of file
@@ -1,4 +1,5 @@
 #include "pybind11_include.hpp"
+#include <algorithm>
 #include <assert.h>
 #include <math.h>
 #include <vector>
@@ -8,11 +9,18 @@
 #include "dataStructures/readWrite/read_write.h"
 #include "dataStructures/sparse_matrix.hpp"
 #include "geometry/mesh.hpp"
+#include "geometry/mesh_partition.hpp"
+#include "geometry/mesh_read_write.hpp"
+#include "geometry/p1_assembly.hpp"
 #include "geometry/zone.hpp"
 #include "geometry/zone_methods.hpp"
+#include "geometry/zone_statistics.hpp"
+#include "helper/cuda/cuda_reduction_operation.hpp"
 #include "matrixOperations/basic_operations.hpp"
+#include "reactionDiffusionSystem/ensemble_simulation.hpp"
 #include "reactionDiffusionSystem/parse_reaction.hpp"
 #include "reactionDiffusionSystem/simulation.hpp"
+#include "reactionDiffusionSystem/simulation_scheduler.hpp"
 
 PYBIND11_MODULE(ardisLib, m) {
     py::enum_<matrix_type>(m, "matrix_type")
@@ -21,6 +29,13 @@ PYBIND11_MODULE(ardisLib, m) {
         .value("CSC", CSC)
         .export_values();
 
+    py::enum_<reaction_integrator>(m, "reaction_integrator")
+        .value("explicit_euler", explicit_euler)
+        .value("linearly_implicit_euler", linearly_implicit_euler)
+        .value("backward_euler", backward_euler)
+        .value("adaptive_rk23", adaptive_rk23)
+        .export_values();
+
     py::class_<state>(m, "state")
         .def(py::init<int>())
         .def(
@@ -57,12 +72,72 @@ PYBIND11_MODULE(ardisLib, m) {
         .def("n_species", &state::n_species)
         .def("vector_size", &state::size)
         .def("copy",
-             [](const state &other) { return std::move(state(other)); });
+             [](const state &other) { return std::move(state(other)); })
+        .def(
+            "block", [](state &self) { return new state_block(self); },
+            py::return_value_policy::take_ownership);
+    py::class_<state_block>(m, "state_block", py::buffer_protocol())
+        .def(py::init<state &>())
+        .def_buffer([](state_block &self) {
+            return py::buffer_info(
+                self.data, sizeof(T), py::format_descriptor<T>::format(), 2,
+                {self.n_species, self.vector_size},
+                {sizeof(T) * self.vector_size, sizeof(T)});
+        })
+        .def("pull", &state_block::pull)
+        .def("push", &state_block::push)
+        .def(
+            "species",
+            [](py::object self, std::string name) {
+                state_block &block = self.cast<state_block &>();
+                return py::array_t<T>(block.vector_size,
+                                      block.species(block.species_index(name)),
+                                      self);
+            },
+            "Writable view of one species, valid while the block is alive")
+        .def("copy",
+             [](state_block &self) {
+                 py::array_t<T> array({self.n_species, self.vector_size});
+                 std::copy(self.data,
+                           self.data + (size_t)self.n_species * self.vector_size,
+                           array.mutable_data());
+                 return array;
+             })
+        .def_property_readonly("species_names",
+                               [](state_block &self) {
+                                   py::list names;
+                                   for (auto &name : self.species_names)
+                                       names.append(name);
+                                   return names;
+                               })
+        .def_readonly("n_species", &state_block::n_species)
+        .def_readonly("vector_size", &state_block::vector_size);
     py::class_<simulation>(m, "simulation")
         .def(py::init<int>())
         .def(py::init<state &>())
         .def("iterate_diffusion", &simulation::iterate_diffusion)
         .def("iterate_reaction", &simulation::iterate_reaction)
+        .def("iterate", &simulation::iterate)
+        // The GIL is released while computing and only re-acquired to call
+        // the callback, callback(simulation, steps_done), which can return
+        // False to stop the run
+        .def(
+            "run",
+            [](py::object self, T dt, int n_steps, int observe_every,
+               py::object callback) {
+                simulation &simu = self.cast<simulation &>();
+                simulation::observer observe = nullptr;
+                if (!callback.is_none())
+                    observe = [&self, &callback](simulation &, int step) {
+                        py::gil_scoped_acquire acquire;
+                        py::object result = callback(self, step);
+                        return result.is_none() || result.cast<bool>();
+                    };
+                py::gil_scoped_release release;
+                return simu.run(dt, n_steps, observe_every, observe);
+            },
+            py::arg("dt"), py::arg("n_steps"), py::arg("observe_every") = 0,
+            py::arg("callback") = py::none())
         .def("prune", &simulation::prune, py::arg("value") = 0)
         .def("prune_under", &simulation::prune_under, py::arg("value") = 1)
         .def(
@@ -100,6 +175,11 @@ PYBIND11_MODULE(ardisLib, m) {
         .def("add_mm_reaction",
              static_cast<void (simulation::*)(std::string, std::string, int, T,
                                               T)>(&simulation::add_mm_reaction))
+        .def("add_hill_reaction",
+             static_cast<void (simulation::*)(const std::string &, T, T, T)>(
+                 &simulation::add_hill_reaction),
+             py::arg("reaction"), py::arg("Vm"), py::arg("K"), py::arg("n"))
+        .def("load_crn", &simulation::load_crn, py::arg("text"))
         .def(
             "get_species",
             [](simulation &self, std::string name) {
@@ -110,21 +190,70 @@ PYBIND11_MODULE(ardisLib, m) {
             "get_diffusion_matrix",
             [](simulation &self) { return self.diffusion_matrix; },
             py::return_value_policy::reference)
-        .def(
-            "get_damping_matrix",
-            [](simulation &self) { return *self.damp_mat; },
-            py::return_value_policy::reference)
-        .def(
-            "get_stiffness_matrix",
-            [](simulation &self) { return *self.stiff_mat; },
-            py::return_value_policy::reference)
-        .def("load_dampness_matrix", &simulation::load_dampness_matrix)
-        .def("load_stiffness_matrix", &simulation::load_stiffness_matrix)
+        .def("get_damping_matrix",
+             [](simulation &self) { return self.damp_mat; })
+        .def("get_stiffness_matrix",
+             [](simulation &self) { return self.stiff_mat; })
+        // The simulation keeps a reference to the matrices
+        .def("load_dampness_matrix",
+             static_cast<void (simulation::*)(std::shared_ptr<d_spmatrix>)>(
+                 &simulation::load_dampness_matrix))
+        .def("load_stiffness_matrix",
+             static_cast<void (simulation::*)(std::shared_ptr<d_spmatrix>)>(
+                 &simulation::load_stiffness_matrix))
         .def("print", &simulation::print, py::arg("print_count") = 5)
 #ifndef NDEBUG_PROFILING
         .def("print_profiler", [](simulation &self) { self.profiler.print(); })
+        .def_property_readonly(
+            "profiler", [](simulation &self) { return &self.profiler; },
+            py::return_value_policy::reference_internal)
+        .def_property_readonly(
+            "solver_profiler",
+            [](simulation &self) { return &self.solver.profiler; },
+            py::return_value_policy::reference_internal)
 #endif
         .def_readwrite("state", &simulation::current_state)
+        .def_readwrite("integrator", &simulation::integrator)
+        .def_readwrite("newton_max_iter", &simulation::newton_max_iter)
+        .def_readwrite("newton_tolerance", &simulation::newton_tolerance)
+        .def_readwrite("relative_to_rhs", &simulation::relative_to_rhs)
+        .def_readwrite("predictor_order", &simulation::predictor_order)
+        .def_readwrite("predictor_probe_every",
+                       &simulation::predictor_probe_every)
+        .def_readonly("predictor_probes", &simulation::predictor_probes)
+        .def_readonly("predictor_saved_iterations",
+                      &simulation::predictor_saved_iterations)
+        .def_readwrite("deflation_vectors", &simulation::deflation_vectors)
+        .def_readwrite("deflation_harvest_solves",
+                       &simulation::deflation_harvest_solves)
+        .def_readwrite("use_amg", &simulation::use_amg)
+        .def_property_readonly(
+            "amg_levels",
+            [](simulation &self) {
+                return (self.amg) ? self.amg->level_rows() : std::vector<int>();
+            })
+        .def_readwrite("use_active_set", &simulation::use_active_set)
+        .def_readwrite("active_threshold", &simulation::active_threshold)
+        .def_readwrite("active_fallback", &simulation::active_fallback)
+        .def_readonly("last_active_nodes", &simulation::last_active_nodes)
+        .def_readwrite("adaptive_rtol", &simulation::adaptive_rtol)
+        .def_readwrite("adaptive_atol", &simulation::adaptive_atol)
+        .def_readwrite("adaptive_max_substeps",
+                       &simulation::adaptive_max_substeps)
+        .def_property_readonly(
+            "reaction_substeps",
+            [](simulation &self) {
+                auto &substeps = self.network.node_substeps;
+                py::array_t<int> array(substeps.n);
+                if (substeps.n > 0)
+                    gpuErrchk(cudaMemcpy(array.mutable_data(), substeps.data,
+                                         sizeof(int) * substeps.n,
+                                         cudaMemcpyDeviceToHost));
+                return array;
+            })
+        .def_property_readonly(
+            "telemetry", [](simulation &self) { return &self.telemetry; },
+            py::return_value_policy::reference_internal)
         .def_property(
             "epsilon",
             [](simulation &self) { // Getter
@@ -142,7 +271,181 @@ PYBIND11_MODULE(ardisLib, m) {
                 self.drain = value;
             });
 
-    py::class_<d_spmatrix>(m, "d_spmatrix")
+    m.def(
+        "run_simulations",
+        [](py::list simulations, T dt, int n_steps, int n_threads) {
+            std::vector<simulation *> simus;
+            for (auto simu : simulations)
+                simus.push_back(simu.cast<simulation *>());
+            std::vector<int> nDone;
+            {
+                py::gil_scoped_release release;
+                nDone = run_simulations(simus, dt, n_steps, n_threads);
+            }
+            py::array_t<int> steps(nDone.size());
+            std::copy(nDone.begin(), nDone.end(), steps.mutable_data());
+            return steps;
+        },
+        py::arg("simulations"), py::arg("dt"), py::arg("n_steps"),
+        py::arg("n_threads") = 0);
+
+    py::class_<ensemble_simulation>(m, "ensemble_simulation")
+        .def(py::init<int, int>(), py::arg("n_nodes"), py::arg("n_members"))
+        .def_readonly("n_nodes", &ensemble_simulation::n_nodes)
+        .def_readonly("n_members", &ensemble_simulation::n_members)
+        .def(
+            "add_species",
+            [](ensemble_simulation &self, std::string name, bool diffusion) {
+                self.add_species(name, species_options(diffusion));
+            },
+            py::arg("name"), py::arg("diffusion") = true)
+        .def("set_species",
+             [](ensemble_simulation &self, std::string name,
+                d_vector &sub_state) {
+                 assert(sub_state.size() == self.current_state.size());
+                 self.set_species(name, sub_state.data, true);
+             })
+        .def("set_species",
+             [](ensemble_simulation &self, std::string name,
+                py::array_t<T> &sub_state) {
+                 assert(sub_state.size() == self.current_state.size());
+                 self.set_species(name, sub_state.data(), false);
+             })
+        .def("set_member",
+             [](ensemble_simulation &self, std::string name, int member,
+                py::array_t<T> &sub_state) {
+                 assert(sub_state.size() == self.n_nodes);
+                 self.set_member(name, member, sub_state.data(), false);
+             })
+        .def("get_species", &ensemble_simulation::get_species,
+             py::return_value_policy::reference)
+        .def("get_member",
+             [](ensemble_simulation &self, std::string name, int member) {
+                 if (member < 0 || member >= self.n_members)
+                     throw std::out_of_range("Invalid ensemble member");
+                 py::array_t<T> values(self.n_nodes);
+                 gpuErrchk(cudaMemcpy(
+                     values.mutable_data(),
+                     self.get_species(name).data + member * self.n_nodes,
+                     sizeof(T) * self.n_nodes, cudaMemcpyDeviceToHost));
+                 return values;
+             })
+        .def("add_reaction",
+             [](ensemble_simulation &self, const std::string &reaction,
+                T rate) {
+                 self.add_reaction(reaction, std::vector<T>{rate});
+             })
+        .def("add_reaction",
+             [](ensemble_simulation &self, const std::string &reaction,
+                py::array_t<T> &rates) {
+                 self.add_reaction(reaction,
+                                   std::vector<T>(rates.data(),
+                                                  rates.data() + rates.size()));
+             })
+        .def("add_mm_reaction",
+             [](ensemble_simulation &self, const std::string &reaction,
+                py::array_t<T> &Vm, py::array_t<T> &Km) {
+                 self.add_mm_reaction(
+                     reaction, std::vector<T>(Vm.data(), Vm.data() + Vm.size()),
+                     std::vector<T>(Km.data(), Km.data() + Km.size()));
+             })
+        .def("load_dampness_matrix",
+             &ensemble_simulation::load_dampness_matrix)
+        .def("load_stiffness_matrix",
+             &ensemble_simulation::load_stiffness_matrix)
+        .def("iterate_diffusion", &ensemble_simulation::iterate_diffusion)
+        .def("iterate_reaction", &ensemble_simulation::iterate_reaction)
+        .def("prune", &ensemble_simulation::prune, py::arg("value") = 0)
+        .def_readwrite("epsilon", &ensemble_simulation::epsilon)
+        .def_readwrite("drain", &ensemble_simulation::drain)
+        .def_readonly("t", &ensemble_simulation::t)
+        .def_property_readonly(
+            "telemetry",
+            [](ensemble_simulation &self) { return &self.telemetry; },
+            py::return_value_policy::reference_internal);
+
+    py::class_<solver_telemetry>(m, "solver_telemetry")
+        .def("__len__", &solver_telemetry::size)
+        .def("clear", &solver_telemetry::clear)
+        .def_property("capacity", &solver_telemetry::capacity,
+                      &solver_telemetry::set_capacity)
+        .def_readonly("n_solves", &solver_telemetry::n_solves)
+        .def_readonly("n_failed", &solver_telemetry::n_failed)
+        .def("as_arrays", [](solver_telemetry &self) {
+            int n = self.size();
+            py::array_t<int> step(n), species(n), member(n), n_iter(n),
+                n_iter_unpredicted(n);
+            py::array_t<T> residual0(n), residual(n);
+            py::array_t<double> time(n);
+            py::array_t<bool> converged(n);
+            auto stepView = step.mutable_unchecked<1>();
+            auto speciesView = species.mutable_unchecked<1>();
+            auto memberView = member.mutable_unchecked<1>();
+            auto iterView = n_iter.mutable_unchecked<1>();
+            auto unpredictedView = n_iter_unpredicted.mutable_unchecked<1>();
+            auto residual0View = residual0.mutable_unchecked<1>();
+            auto residualView = residual.mutable_unchecked<1>();
+            auto timeView = time.mutable_unchecked<1>();
+            auto convergedView = converged.mutable_unchecked<1>();
+            for (int k = 0; k < n; k++) {
+                auto &record = self.at(k);
+                stepView(k) = record.step;
+                speciesView(k) = record.species;
+                memberView(k) = record.member;
+                iterView(k) = record.n_iter;
+                unpredictedView(k) = record.n_iter_unpredicted;
+                residual0View(k) = record.residual0;
+                residualView(k) = record.residual;
+                timeView(k) = record.time;
+                convergedView(k) = record.converged;
+            }
+            py::dict arrays;
+            arrays["step"] = step;
+            arrays["species"] = species;
+            arrays["member"] = member;
+            arrays["n_iter"] = n_iter;
+            arrays["n_iter_unpredicted"] = n_iter_unpredicted;
+            arrays["residual0"] = residual0;
+            arrays["residual"] = residual;
+            arrays["time"] = time;
+            arrays["converged"] = converged;
+            return arrays;
+        });
+
+#ifndef NDEBUG_PROFILING
+    py::class_<profiler_stats>(m, "profiler_stats")
+        .def_readonly("count", &profiler_stats::count)
+        .def_readonly("total", &profiler_stats::total)
+        .def_readonly("min", &profiler_stats::min)
+        .def_readonly("max", &profiler_stats::max)
+        .def_property_readonly("mean", &profiler_stats::mean);
+
+    py::class_<chrono_profiler>(m, "profiler")
+        .def(py::init<std::string>(), py::arg("name") = "")
+        .def("start", &chrono_profiler::start)
+        .def("end", &chrono_profiler::end)
+        .def("push", &chrono_profiler::push)
+        .def("pop", &chrono_profiler::pop)
+        .def("print", &chrono_profiler::print)
+        .def("reset", &chrono_profiler::reset)
+        .def("stats",
+             [](chrono_profiler &self) {
+                 py::dict stats;
+                 for (auto &section : self.stats())
+                     stats[py::str(section.first)] = section.second;
+                 return stats;
+             })
+        .def_readonly("name", &chrono_profiler::name);
+#endif
+
+    // No-ops when profiling is compiled out
+    m.def("set_profiler_tracing", &chrono_profiler::set_tracing,
+          py::arg("enabled") = true);
+    m.def("clear_profiler_trace", &chrono_profiler::clear_trace);
+    m.def("chrome_trace", &chrono_profiler::chrome_trace);
+    m.def("write_chrome_trace", &chrono_profiler::write_chrome_trace);
+
+    py::class_<d_spmatrix, std::shared_ptr<d_spmatrix>>(m, "d_spmatrix")
         .def(py::init<int, int, int, matrix_type>())
         .def(py::init<int, int, int>())
         .def(py::init<int, int>())
@@ -227,15 +530,40 @@ PYBIND11_MODULE(ardisLib, m) {
         .def_readonly("nnz", &d_spmatrix::nnz)
         .def_readonly("dtype", &d_spmatrix::type);
 
-    py::class_<d_vector>(m, "d_vector")
-        .def(py::init<int>())
+    // Host vectors expose their memory to numpy without copying (e.g.
+    // numpy.asarray(v)), device vectors have to be copied with toarray
+    py::class_<d_vector>(m, "d_vector", py::buffer_protocol())
+        .def(py::init<int, bool>(), py::arg("n"), py::arg("device") = true)
         .def(py::init<const d_vector &>())
-        .def(py::init([](py::array_t<T> &x) {
-            auto vector = d_vector(x.size());
-            gpuErrchk(cudaMemcpy(vector.data, x.data(), sizeof(T) * x.size(),
-                                 cudaMemcpyHostToDevice));
-            return std::move(vector);
-        }))
+        .def(py::init([](py::array_t<T, py::array::c_style |
+                                               py::array::forcecast> &x,
+                         bool device) {
+                 auto vector = d_vector(x.size(), device);
+                 gpuErrchk(cudaMemcpy(vector.data, x.data(),
+                                      sizeof(T) * x.size(), cudaMemcpyDefault));
+                 return std::move(vector);
+             }),
+             py::arg("array"), py::arg("device") = true)
+        .def_buffer([](d_vector &self) {
+            if (self.is_device)
+                throw std::invalid_argument(
+                    "A device d_vector has no host buffer, use toarray() or "
+                    "to_host()");
+            return py::buffer_info(self.data, sizeof(T),
+                                   py::format_descriptor<T>::format(), 1,
+                                   {self.n}, {sizeof(T)});
+        })
+        .def_readonly("is_device", &d_vector::is_device)
+        .def("to_host",
+             [](d_vector &self) {
+                 return (self.is_device) ? d_vector(self, true)
+                                         : d_vector(self);
+             })
+        .def("to_device",
+             [](d_vector &self) {
+                 return (self.is_device) ? d_vector(self)
+                                         : d_vector(self, true);
+             })
         .def("at", &d_vector::at)
         .def("print", &d_vector::print, py::arg("printCount") = 5)
         .def("norm",
@@ -255,17 +583,45 @@ PYBIND11_MODULE(ardisLib, m) {
                  res.update_host();
                  return res();
              })
-        .def("toarray",
-             [](d_vector &self) {
-                 T *data = new T[self.n];
-                 cudaMemcpy(data, self.data, sizeof(T) * self.n,
-                            cudaMemcpyDeviceToHost);
-                 return py::array_t(self.n, data);
-             })
+        .def("sum",
+             [](d_vector &self) { return ReductionOperation(self, sum); })
+        .def("min",
+             [](d_vector &self) { return ReductionOperation(self, minimum); })
+        .def("max",
+             [](d_vector &self) { return ReductionOperation(self, maximum); })
+        .def("argmax", &ReductionArgMax)
+        // A view of a host vector unless copy is set, a copy otherwise. The
+        // view holds its own reference to the buffer (operator= shares it),
+        // so it stays valid if the vector is resized or assigned later
+        .def(
+            "toarray",
+            [](d_vector &vector, bool copy) {
+                if (!vector.is_device && !copy) {
+                    d_vector *holder = new d_vector(0, false);
+                    *holder = vector;
+                    py::capsule base(holder, [](void *holder) {
+                        delete static_cast<d_vector *>(holder);
+                    });
+                    return py::array_t<T>(holder->n, holder->data, base);
+                }
+                py::array_t<T> array(vector.n);
+                if (vector.n > 0)
+                    gpuErrchk(cudaMemcpy(array.mutable_data(), vector.data,
+                                         sizeof(T) * vector.n,
+                                         cudaMemcpyDefault));
+                return array;
+            },
+            py::arg("copy") = false)
         .def("import_array",
-             [](d_vector &self, py::array_t<T> &x) {
-                 gpuErrchk(cudaMemcpy(self.data, x.data(), sizeof(T) * x.size(),
-                                      cudaMemcpyHostToDevice));
+             [](d_vector &self,
+                py::array_t<T, py::array::c_style | py::array::forcecast> &x) {
+                 if (x.size() != self.n)
+                     throw std::invalid_argument(
+                         "The array does not have the size of the vector");
+                 if (self.n > 0)
+                     gpuErrchk(cudaMemcpy(self.data, x.data(),
+                                          sizeof(T) * self.n,
+                                          cudaMemcpyDefault));
              })
         .def(
             "__add__",
@@ -319,6 +675,12 @@ PYBIND11_MODULE(ardisLib, m) {
     py::module geometry = m.def_submodule("geometry");
 
     py::class_<zone>(geometry, "zone");
+    py::class_<simple_zone, zone>(geometry, "simple_zone")
+        .def(py::init<bool>(), py::arg("inside"))
+        .def("is_inside",
+             static_cast<bool (simple_zone::*)(T, T)>(&simple_zone::is_inside))
+        .def("is_inside", static_cast<bool (simple_zone::*)(point2d)>(
+                              &simple_zone::is_inside));
     py::class_<rect_zone, zone>(geometry, "rect_zone")
         .def(py::init<>())
         .def(py::init<T, T, T, T>())
@@ -351,28 +713,227 @@ PYBIND11_MODULE(ardisLib, m) {
 
     py::module d_geometry = m.def_submodule("d_geometry");
 
-    d_geometry.def("fill_zone", &fill_zone);
-    d_geometry.def("fill_outside_zone", &fill_outside_zone);
-    d_geometry.def("min_zone", &min_zone);
-    d_geometry.def("max_zone", &max_zone);
-    d_geometry.def("mean_zone", &mean_zone);
+    d_geometry.def(
+        "assemble_p1",
+        [](d_mesh &mesh,
+           py::array_t<int, py::array::c_style | py::array::forcecast>
+               &triangles,
+           bool lumped) {
+            d_array<int> d_triangles(triangles.size());
+            gpuErrchk(cudaMemcpy(d_triangles.data, triangles.data(),
+                                 sizeof(int) * triangles.size(),
+                                 cudaMemcpyHostToDevice));
+            d_spmatrix *damping = new d_spmatrix();
+            d_spmatrix *stiffness = new d_spmatrix();
+            assemble_p1_matrices(mesh, d_triangles, *damping, *stiffness,
+                                 lumped);
+            return py::make_tuple(
+                py::cast(damping, py::return_value_policy::take_ownership),
+                py::cast(stiffness, py::return_value_policy::take_ownership));
+        },
+        py::arg("mesh"), py::arg("triangles"), py::arg("lumped") = false);
+    d_geometry.def(
+        "assemble_p1",
+        [](d_mesh &mesh, bool lumped) {
+            d_spmatrix *damping = new d_spmatrix();
+            d_spmatrix *stiffness = new d_spmatrix();
+            assemble_p1_matrices(mesh, *damping, *stiffness, lumped);
+            return py::make_tuple(
+                py::cast(damping, py::return_value_policy::take_ownership),
+                py::cast(stiffness, py::return_value_policy::take_ownership));
+        },
+        py::arg("mesh"), py::arg("lumped") = false);
+
+    py::class_<zone_mask, std::shared_ptr<zone_mask>>(d_geometry, "zone_mask")
+        .def_readonly("count", &zone_mask::count)
+        .def("__len__", [](zone_mask &self) { return self.n; })
+        .def("__or__", &zone_mask::operator|)
+        .def("__and__", &zone_mask::operator&)
+        .def("__invert__", &zone_mask::operator~);
+
+    auto bindZoneMethods = [&d_geometry](auto *zoneType) {
+        typedef typename std::remove_pointer<decltype(zoneType)>::type Zone;
+        d_geometry.def("get_zone_mask", &get_zone_mask<Zone>);
+        d_geometry.def("fill_zone", &fill_zone<Zone>);
+        d_geometry.def("fill_outside_zone", &fill_outside_zone<Zone>);
+        d_geometry.def("count_zone", &count_zone<Zone>);
+        d_geometry.def("min_zone", &min_zone<Zone>);
+        d_geometry.def("max_zone", &max_zone<Zone>);
+        d_geometry.def("mean_zone", &mean_zone<Zone>);
+    };
+    bindZoneMethods((simple_zone *)nullptr);
+    bindZoneMethods((rect_zone *)nullptr);
+    bindZoneMethods((tri_zone *)nullptr);
+    bindZoneMethods((circle_zone *)nullptr);
+    d_geometry.def("fill_zone",
+                   py::overload_cast<d_vector &, zone_mask &, T>(&fill_zone));
+    d_geometry.def("min_zone",
+                   py::overload_cast<d_vector &, zone_mask &>(&min_zone));
+    d_geometry.def("max_zone",
+                   py::overload_cast<d_vector &, zone_mask &>(&max_zone));
+    d_geometry.def("mean_zone",
+                   py::overload_cast<d_vector &, zone_mask &>(&mean_zone));
+    d_geometry.def(
+        "zone_statistics",
+        [](state &state, py::list &speciesNames, py::list &zoneMasks,
+           d_spmatrix *mass) {
+            std::vector<d_vector *> species;
+            for (auto name : speciesNames)
+                species.push_back(&state.get_species(name.cast<std::string>()));
+            std::vector<zone_mask *> masks;
+            for (auto mask : zoneMasks)
+                masks.push_back(&mask.cast<zone_mask &>());
+            d_vector weights((mass) ? state.vector_size : 0);
+            if (mass)
+                lumped_mass(*mass, weights);
+            auto stats = compute_zone_statistics(species, masks,
+                                                 (mass) ? &weights : nullptr);
+
+            std::vector<py::ssize_t> shape{stats.n_zones, stats.n_species};
+            auto toArray = [&shape](std::vector<T> &values) {
+                py::array_t<T> array(shape);
+                std::copy(values.begin(), values.end(),
+                          array.mutable_data());
+                return array;
+            };
+            py::array_t<int> count(stats.n_zones);
+            std::copy(stats.count.begin(), stats.count.end(),
+                      count.mutable_data());
+            py::dict result;
+            result["count"] = count;
+            result["sum"] = toArray(stats.sum);
+            result["min"] = toArray(stats.min);
+            result["max"] = toArray(stats.max);
+            result["mean"] = toArray(stats.mean);
+            if (mass)
+                result["integral"] = toArray(stats.integral);
+            return result;
+        },
+        py::arg("state"), py::arg("species"), py::arg("masks"),
+        py::arg("mass") = nullptr);
+
+    // Host meshes share their memory with the returned arrays, device meshes
+    // are copied
+    auto meshArray = [](py::object &self, d_array<T> d_mesh::*member) {
+        d_mesh &mesh = self.cast<d_mesh &>();
+        d_array<T> &array = mesh.*member;
+        if (array.is_device) {
+            py::array_t<T> copy(array.n);
+            gpuErrchk(cudaMemcpy(copy.mutable_data(), array.data,
+                                 sizeof(T) * array.n, cudaMemcpyDeviceToHost));
+            return copy;
+        }
+        return py::array_t<T>(array.n, array.data, self);
+    };
 
     py::class_<d_mesh>(d_geometry, "d_mesh")
         .def(py::init<d_vector &, d_vector &>())
-        .def(py::init([](py::array_t<T> &x, py::array_t<T> &y) {
+        .def(py::init([](py::array_t<T> &x, py::array_t<T> &y,
+                         py::object &triangles, bool device) {
                  assert(x.size() == y.size());
-                 auto mesh = d_mesh(x.size());
+                 typedef py::array_t<int, py::array::c_style |
+                                              py::array::forcecast>
+                     index_array;
+                 index_array triangleArray;
+                 if (!triangles.is_none())
+                     triangleArray = index_array::ensure(triangles);
+                 if (triangleArray.size() % 3 != 0)
+                     throw std::invalid_argument(
+                         "The number of triangle indices must be a multiple "
+                         "of 3\n");
+                 int nTriangles =
+                     (triangles.is_none()) ? 0 : triangleArray.size() / 3;
+                 auto mesh = d_mesh(x.size(), nTriangles, device);
+                 auto memCpy =
+                     (device) ? cudaMemcpyHostToDevice : cudaMemcpyHostToHost;
                  gpuErrchk(cudaMemcpy(mesh.X.data, x.data(),
-                                      sizeof(T) * x.size(),
-                                      cudaMemcpyHostToDevice));
+                                      sizeof(T) * x.size(), memCpy));
                  gpuErrchk(cudaMemcpy(mesh.Y.data, y.data(),
-                                      sizeof(T) * x.size(),
-                                      cudaMemcpyHostToDevice));
+                                      sizeof(T) * x.size(), memCpy));
+                 if (nTriangles > 0)
+                     gpuErrchk(cudaMemcpy(mesh.triangles.data,
+                                          triangleArray.data(),
+                                          sizeof(int) * 3 * nTriangles,
+                                          memCpy));
+                 check_triangles(mesh);
                  return std::move(mesh);
              }),
-             py::return_value_policy::move)
+             py::arg("x"), py::arg("y"), py::arg("triangles") = py::none(),
+             py::arg("device") = true, py::return_value_policy::move)
         .def("__len__", &d_mesh::size)
-        .def_readonly("X", &d_mesh::X)
-        .def_readonly("Y", &d_mesh::Y);
+        // The coordinates can be modified through X and Y, so handing them
+        // out drops the spatial index and the zone masks
+        .def_property_readonly(
+            "X",
+            [](d_mesh &self) -> d_vector & {
+                self.clear_index();
+                return self.X;
+            },
+            py::return_value_policy::reference_internal)
+        .def_property_readonly(
+            "Y",
+            [](d_mesh &self) -> d_vector & {
+                self.clear_index();
+                return self.Y;
+            },
+            py::return_value_policy::reference_internal)
+        .def_property_readonly("x",
+                               [meshArray](py::object &self) {
+                                   return meshArray(self, &d_mesh::X);
+                               })
+        .def_property_readonly("y",
+                               [meshArray](py::object &self) {
+                                   return meshArray(self, &d_mesh::Y);
+                               })
+        .def_property_readonly(
+            "triangles",
+            [](py::object &self) {
+                d_mesh &mesh = self.cast<d_mesh &>();
+                std::vector<py::ssize_t> shape{mesh.n_triangles(), 3};
+                if (mesh.is_device()) {
+                    py::array_t<int> copy(shape);
+                    gpuErrchk(cudaMemcpy(copy.mutable_data(),
+                                         mesh.triangles.data,
+                                         sizeof(int) * mesh.triangles.n,
+                                         cudaMemcpyDeviceToHost));
+                    return copy;
+                }
+                return py::array_t<int>(shape, mesh.triangles.data, self);
+            })
+        .def_property_readonly("n_triangles", &d_mesh::n_triangles)
+        .def("build_index", [](d_mesh &self) { self.index(); })
+        .def("clear_index", &d_mesh::clear_index)
+        .def("clear_zone_masks", &d_mesh::clear_zone_masks)
+        .def_property("zone_mask_capacity", &d_mesh::zone_mask_capacity,
+                      &d_mesh::set_zone_mask_capacity)
+        .def_property_readonly("is_device", &d_mesh::is_device)
+        .def("to_device",
+             [](d_mesh &self) {
+                 return (self.is_device()) ? d_mesh(self) : d_mesh(self, true);
+             })
+        .def("to_host", [](d_mesh &self) {
+            return (self.is_device()) ? d_mesh(self, true) : d_mesh(self);
+        });
+
+    d_geometry.def("read_mesh", &read_mesh, py::arg("path"),
+                   py::arg("device") = false);
+    d_geometry.def("write_mesh", &write_mesh, py::arg("mesh"), py::arg("path"),
+                   py::arg("binary") = false);
+    d_geometry.def(
+        "block_ordering",
+        [](d_mesh &mesh, int blockSize) {
+            auto order = block_ordering(mesh, blockSize);
+            return py::array_t<int>(order.size(), order.data());
+        },
+        py::arg("mesh"), py::arg("block_size") = 256);
+    d_geometry.def(
+        "reorder_mesh",
+        [](d_mesh &mesh,
+           py::array_t<int, py::array::c_style | py::array::forcecast> order) {
+            return reorder_mesh(
+                mesh, std::vector<int>(order.data(),
+                                       order.data() + order.size()));
+        },
+        py::arg("mesh"), py::arg("order"), py::return_value_policy::move);
 
 } // namespace PYBIND11_MODULE(dna,m)
\ No newline at end of file
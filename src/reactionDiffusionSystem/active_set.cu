@@ -0,0 +1,96 @@
+#include <cassert>
+
+#include "active_set.hpp"
+#include "helper/cuda/cuda_error_check.h"
+#include "helper/cuda/cuda_scan.hpp"
+#include "helper/cuda/cuda_thread_manager.hpp"
+
+__global__ void mark_activeK(d_vector **state, int nSpecies, int n,
+                             T threshold, int *flags) {
+    int i = threadIdx.x + blockIdx.x * blockDim.x;
+    if (i >= n)
+        return;
+    int active = 0;
+    for (int k = 0; k < nSpecies && !active; k++)
+        active = state[k]->data[i] > threshold;
+    flags[i] = active;
+}
+
+__global__ void dilate_activeK(int n, const int *rowPtr, const int *colPtr,
+                               const int *flags, int *dilated) {
+    int i = threadIdx.x + blockIdx.x * blockDim.x;
+    if (i >= n)
+        return;
+    int active = flags[i];
+    for (int k = rowPtr[i]; k < rowPtr[i + 1] && !active; k++)
+        active = flags[colPtr[k]];
+    dilated[i] = active;
+}
+
+// Flags the nodes that left the set, and remembers the current set
+__global__ void mark_leftK(int n, const int *active, int *wasActive,
+                           int *left) {
+    int i = threadIdx.x + blockIdx.x * blockDim.x;
+    if (i >= n)
+        return;
+    left[i] = wasActive[i] && !active[i];
+    wasActive[i] = active[i];
+}
+
+// positions is the inclusive scan of the flags
+__global__ void compact_activeK(int n, const int *positions, int *nodes) {
+    int i = threadIdx.x + blockIdx.x * blockDim.x;
+    if (i >= n)
+        return;
+    int previous = (i > 0) ? positions[i - 1] : 0;
+    if (positions[i] != previous)
+        nodes[previous] = i;
+}
+
+void active_set::update(state &state, d_spmatrix *pattern, T threshold) {
+    int n = state.size();
+    if (flags.n != n) {
+        flags.resize(n);
+        dilated.resize(n);
+        nodes.resize(n);
+        was_active.resize(n);
+        was_active.fill(0);
+        left_positions.resize(n);
+        left.resize(n);
+    }
+    n_active = 0;
+    n_left = 0;
+    if (n == 0 || state.n_species() == 0)
+        return;
+
+    auto tb = make1DThreadBlock(n);
+    mark_activeK<<<tb.block, tb.thread>>>(state.get_device_data().data,
+                                          state.n_species(), n, threshold,
+                                          flags.data);
+    gpuErrchk(cudaPeekAtLastError());
+    int *active = flags.data;
+    if (pattern) {
+        assert(pattern->type == CSR && pattern->rows == n &&
+               pattern->cols == n);
+        dilate_activeK<<<tb.block, tb.thread>>>(n, pattern->rowPtr,
+                                                pattern->colPtr, flags.data,
+                                                dilated.data);
+        gpuErrchk(cudaPeekAtLastError());
+        active = dilated.data;
+    }
+    mark_leftK<<<tb.block, tb.thread>>>(n, active, was_active.data,
+                                        left_positions.data);
+    gpuErrchk(cudaPeekAtLastError());
+    // The flags are not needed anymore, they receive the positions
+    inclusive_scan(active, flags.data, n);
+    compact_activeK<<<tb.block, tb.thread>>>(n, flags.data, nodes.data);
+    gpuErrchk(cudaPeekAtLastError());
+    inclusive_scan(left_positions.data, left_positions.data, n);
+    compact_activeK<<<tb.block, tb.thread>>>(n, left_positions.data,
+                                             left.data);
+    gpuErrchk(cudaPeekAtLastError());
+    gpuErrchk(cudaMemcpy(&n_active, flags.data + n - 1, sizeof(int),
+                         cudaMemcpyDeviceToHost));
+    gpuErrchk(cudaMemcpy(&n_left, left_positions.data + n - 1, sizeof(int),
+                         cudaMemcpyDeviceToHost));
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "constants.hpp"
+#include "dataStructures/array.hpp"
+#include "dataStructures/sparse_matrix.hpp"
+#include "state.hpp"
+
+// Nodes that go through the reaction step. A node is active if one of its
+// species exceeds the threshold, or if one of its neighbors in the pattern of
+// a square CSR matrix (e.g. the stiffness matrix) does, so that the set
+// follows a front that moves by at most one neighborhood per step.
+// The active nodes are listed in increasing order, as well as the nodes that
+// left the set at the last update.
+class active_set {
+  public:
+    int n_active = 0;
+    // The first n_active values are the active nodes
+    d_array<int> nodes;
+    int n_left = 0;
+    // The first n_left values are the nodes that were active at the previous
+    // update and are not anymore
+    d_array<int> left;
+
+    // pattern can be null (no dilation)
+    void update(state &state, d_spmatrix *pattern, T threshold);
+
+  private:
+    d_array<int> flags;
+    d_array<int> dilated;
+    d_array<int> was_active;
+    d_array<int> left_positions;
+};
@@ -0,0 +1,210 @@
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <tuple>
+
+#include "crn_loader.hpp"
+#include "parse_reaction.hpp"
+
+static void fail(int line, const std::string &message) {
+    throw std::invalid_argument("line " + std::to_string(line) + ": " +
+                                message);
+}
+
+static T parse_value(int line, std::string token) {
+    trim(token);
+    std::size_t end = 0;
+    T value = 0;
+    try {
+        value = std::stod(token, &end);
+    } catch (const std::exception &e) {
+        end = 0;
+    }
+    if (end == 0 || end != token.size())
+        fail(line, "\"" + token + "\" is not a number");
+    if (!std::isfinite(value) || value < 0)
+        fail(line, "\"" + token + "\" must be finite and non-negative");
+    return value;
+}
+
+static std::vector<T> parse_values(int line, const std::string &text) {
+    std::vector<T> values;
+    std::stringstream stream(text);
+    std::string token;
+    while (std::getline(stream, token, ','))
+        values.push_back(parse_value(line, token));
+    return values;
+}
+
+// Sums the coefficients of the repeated species, in the order of their first
+// appearance
+static std::vector<stochCoeff> merge_side(int line,
+                                          const std::vector<stochCoeff> &side) {
+    std::vector<stochCoeff> merged;
+    for (auto &coeff : side) {
+        if (coeff.first.empty() ||
+            coeff.first.find_first_of(" \t") != std::string::npos)
+            fail(line, "invalid species \"" + coeff.first + "\"");
+        if (coeff.second < 1)
+            fail(line, "the coefficient of " + coeff.first +
+                           " must be positive");
+        auto same = std::find_if(
+            merged.begin(), merged.end(),
+            [&](const stochCoeff &other) { return other.first == coeff.first; });
+        if (same != merged.end())
+            same->second += coeff.second;
+        else
+            merged.push_back(coeff);
+    }
+    return merged;
+}
+
+static reaction_holder parse_sides(int line, const std::string &lhs,
+                                   const std::string &rhs) {
+    reaction_holder holder({}, {});
+    try {
+        holder = parse_reaction(lhs + "->" + rhs);
+    } catch (const std::invalid_argument &e) {
+        fail(line, e.what());
+    }
+    return reaction_holder(merge_side(line, holder.Reagents),
+                           merge_side(line, holder.Products));
+}
+
+// Reactions are merged when their keys are equal
+typedef std::tuple<int, std::vector<stochCoeff>, std::vector<stochCoeff>, T,
+                   T>
+    reaction_key;
+
+static reaction_key key_of(const crn_reaction &reaction) {
+    auto reagents = reaction.holder.Reagents;
+    auto products = reaction.holder.Products;
+    std::sort(reagents.begin(), reagents.end());
+    std::sort(products.begin(), products.end());
+    return reaction_key(reaction.law, reagents, products, reaction.k1,
+                        reaction.k2);
+}
+
+crn_network parse_crn(const std::string &text) {
+    crn_network network;
+    std::map<reaction_key, int> known;
+    std::set<std::string> declared;
+
+    auto add = [&](crn_reaction reaction) {
+        auto key = key_of(reaction);
+        auto same = known.find(key);
+        if (same != known.end()) {
+            network.reactions[same->second].k0 += reaction.k0;
+            network.n_merged++;
+            return;
+        }
+        known[key] = network.reactions.size();
+        network.reactions.push_back(reaction);
+    };
+
+    std::stringstream stream(text);
+    std::string statement;
+    int line = 0;
+    while (std::getline(stream, statement)) {
+        line++;
+        statement = statement.substr(0, statement.find('#'));
+        trim(statement);
+        if (statement.empty())
+            continue;
+
+        std::stringstream words(statement);
+        std::string keyword;
+        words >> keyword;
+        if (keyword == "species" || keyword == "fixed") {
+            auto equal = statement.find('=');
+            bool hasValue = equal != std::string::npos;
+            T value = (hasValue)
+                          ? parse_value(line, statement.substr(equal + 1))
+                          : 0;
+            std::stringstream names(
+                statement.substr(keyword.size(), equal - keyword.size()));
+            std::string name;
+            int count = 0;
+            while (names >> name) {
+                if (!declared.insert(name).second)
+                    fail(line, "species " + name + " is already declared");
+                crn_species species;
+                species.name = name;
+                species.diffusion = keyword == "species";
+                species.has_value = hasValue;
+                species.value = value;
+                species.line = line;
+                network.species.push_back(species);
+                count++;
+            }
+            if (count == 0)
+                fail(line, "no species declared");
+            continue;
+        }
+
+        auto colon = statement.find(':');
+        if (colon == std::string::npos)
+            fail(line, "expected \"reaction : rates\"");
+        std::string equation = statement.substr(0, colon);
+        std::string rates = trim_copy(statement.substr(colon + 1));
+
+        crn_reaction reaction;
+        reaction.line = line;
+        if (rates.compare(0, 2, "mm") == 0) {
+            reaction.law = crn_michaelis_menten;
+            rates = rates.substr(2);
+        } else if (rates.compare(0, 4, "hill") == 0) {
+            reaction.law = crn_hill;
+            rates = rates.substr(4);
+        }
+        auto values = parse_values(line, rates);
+
+        auto reversible = equation.find("<->");
+        if (reversible != std::string::npos) {
+            if (reaction.law != crn_mass_action)
+                fail(line, "only mass action reactions are reversible");
+            if (values.size() != 2)
+                fail(line, "a reversible reaction takes two rates");
+            auto lhs = equation.substr(0, reversible);
+            auto rhs = equation.substr(reversible + 3);
+            reaction.holder = parse_sides(line, lhs, rhs);
+            reaction.k0 = values[0];
+            crn_reaction back = reaction;
+            back.holder = parse_sides(line, rhs, lhs);
+            back.k0 = values[1];
+            add(reaction);
+            add(back);
+            continue;
+        }
+
+        auto arrow = equation.find("->");
+        if (arrow == std::string::npos)
+            fail(line, "the reaction must contain an arrow -> or <->");
+        reaction.holder = parse_sides(line, equation.substr(0, arrow),
+                                      equation.substr(arrow + 2));
+        if (reaction.law != crn_mass_action &&
+            (reaction.holder.Reagents.size() != 1 ||
+             reaction.holder.Reagents[0].second != 1))
+            fail(line, "a Michaelis-Menten or Hill reaction takes only one "
+                       "species as reagent");
+        if (reaction.law == crn_michaelis_menten) {
+            if (values.size() != 2)
+                fail(line, "a Michaelis-Menten reaction takes Vm and Km");
+            reaction.k1 = values[1];
+        } else if (reaction.law == crn_hill) {
+            if (values.size() != 3)
+                fail(line, "a Hill reaction takes Vm, K and n");
+            if (!(values[1] > 0) || !(values[2] > 0))
+                fail(line, "K and n must be positive");
+            reaction.k1 = values[1];
+            reaction.k2 = values[2];
+        } else if (values.size() != 1)
+            fail(line, "a mass action reaction takes one rate");
+        reaction.k0 = values[0];
+        add(reaction);
+    }
+    return network;
+}
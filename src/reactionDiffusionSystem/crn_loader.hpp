@@ -0,0 +1,53 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "constants.hpp"
+#include "reaction.hpp"
+
+// Compact text description of a reaction network, one statement per line
+// ('#' starts a comment):
+//
+//   species A B C = 1e-10      diffusing species, optionally with a value
+//   fixed T1 T2                species that do not diffuse
+//   A + 2 B -> C : 0.5         mass action reaction and its rate
+//   A + B <-> C : 0.2, 0.1     reversible reaction, forward and back rates
+//   A -> B + C : mm 300, 440   Michaelis-Menten reaction, Vm and Km
+//   A -> B : hill 10, 2, 4     Hill reaction, Vm, K and n
+//
+// The reactions are merged: repeated species of a side are summed (A + A is
+// 2 A), and reactions with the same law, sides (and Km, or K and n) are
+// replaced by one reaction with the sum of their rates, at the place of the
+// first one.
+
+struct crn_species {
+    std::string name;
+    bool diffusion = true;
+    bool has_value = false;
+    T value = 0;
+    int line = 0;
+};
+
+enum crn_law { crn_mass_action, crn_michaelis_menten, crn_hill };
+
+struct crn_reaction {
+    crn_law law = crn_mass_action;
+    reaction_holder holder{{}, {}};
+    T k0 = 0; // Rate, or Vm
+    T k1 = 0; // Km, or K
+    T k2 = 0; // n
+    int line = 0;
+};
+
+struct crn_network {
+    std::vector<crn_species> species;
+    std::vector<crn_reaction> reactions;
+    // Reactions merged into an earlier one
+    int n_merged = 0;
+};
+
+// Throws std::invalid_argument with the line number on a malformed
+// statement, a species declared twice, a negative or non-finite rate, or a
+// Michaelis-Menten or Hill reaction without a single reagent
+crn_network parse_crn(const std::string &text);
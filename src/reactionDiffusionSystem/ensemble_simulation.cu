@@ -0,0 +1,188 @@
+#include <chrono>
+#include <stdexcept>
+
+#include "dataStructures/helper/apply_operation.h"
+#include "ensemble_simulation.hpp"
+#include "parse_reaction.hpp"
+
+ensemble_simulation::ensemble_simulation(int nNodes, int nMembers)
+    : n_nodes(nNodes), n_members(nMembers), current_state(nNodes * nMembers),
+      solver(nNodes, nMembers), b(nNodes * nMembers) {
+    assert(nNodes > 0 && nMembers > 0);
+}
+
+void ensemble_simulation::add_species(std::string name,
+                                      species_options options) {
+    current_state.add_species(name, options);
+}
+
+void ensemble_simulation::set_species(std::string name, const T *data,
+                                      bool is_device) {
+    current_state.set_species(name, data, is_device);
+}
+
+void ensemble_simulation::set_member(std::string name, int member,
+                                     const T *data, bool is_device) {
+    if (member < 0 || member >= n_members)
+        throw std::out_of_range("Invalid ensemble member");
+    gpuErrchk(cudaMemcpy(current_state.get_species(name).data +
+                             member * n_nodes,
+                         data, sizeof(T) * n_nodes,
+                         (is_device) ? cudaMemcpyDeviceToDevice
+                                     : cudaMemcpyHostToDevice));
+}
+
+d_vector &ensemble_simulation::get_species(std::string name) {
+    return current_state.get_species(name);
+}
+
+d_vector ensemble_simulation::member_values(std::vector<T> values) {
+    if (values.size() == 1)
+        values.assign(n_members, values[0]);
+    if ((int)values.size() != n_members)
+        throw std::invalid_argument(
+            "Expected one value per ensemble member, or a single value\n");
+    d_vector d_values(n_members);
+    gpuErrchk(cudaMemcpy(d_values.data, values.data(), sizeof(T) * n_members,
+                         cudaMemcpyHostToDevice));
+    return d_values;
+}
+
+void check_species(state &current_state, reaction_holder &reaction) {
+    // get_species throws on unknown species
+    for (auto &species : reaction.Reagents)
+        current_state.get_species(species.first);
+    for (auto &species : reaction.Products)
+        current_state.get_species(species.first);
+}
+
+void ensemble_simulation::add_reaction(const std::string &descriptor,
+                                       std::vector<T> rates) {
+    auto holder = parse_reaction(descriptor);
+    check_species(current_state, holder);
+    // Validates the number of rates, before rates[0] is read
+    auto d_rates = member_values(rates);
+    // The kernels only read the per member rates: the rate of the reaction
+    // itself is the one of member 0, for printing
+    reactions.emplace_back(current_state.names, holder, rates[0]);
+    this->rates.push_back(std::move(d_rates));
+}
+
+void ensemble_simulation::add_mm_reaction(const std::string &descriptor,
+                                          std::vector<T> Vm,
+                                          std::vector<T> Km) {
+    reaction_holder holder = parse_reaction(descriptor);
+    if (holder.Reagents.size() != 1 || holder.Reagents.at(0).second != 1) {
+        throw std::invalid_argument(
+            "A Michaelis-Menten reaction takes only one species as reagent\n");
+    }
+    check_species(current_state, holder);
+    // Same as add_reaction: the parameters of member 0 are only printed
+    auto d_vm = member_values(Vm);
+    auto d_km = member_values(Km);
+    mmreactions.emplace_back(current_state.names, holder, Vm[0], Km[0]);
+    mm_vm.push_back(std::move(d_vm));
+    mm_km.push_back(std::move(d_km));
+}
+
+void ensemble_simulation::load_dampness_matrix(
+    std::shared_ptr<d_spmatrix> damp_mat) {
+    assert(damp_mat->rows == n_nodes);
+    this->damp_mat = damp_mat;
+}
+void ensemble_simulation::load_stiffness_matrix(
+    std::shared_ptr<d_spmatrix> stiff_mat) {
+    assert(stiff_mat->rows == n_nodes);
+    this->stiff_mat = stiff_mat;
+}
+
+__global__ void ensemble_mass_actionK(d_array<d_vector *> &state, int nNodes,
+                                      T dt, reaction_mass_action &reaction,
+                                      const T *rates) {
+    int i = threadIdx.x + blockIdx.x * blockDim.x;
+    if (i >= state.at(0)->n)
+        return;
+    reaction.ApplyReaction(state, i, dt, rates[i / nNodes]);
+}
+
+__global__ void ensemble_michaelis_mentenK(d_array<d_vector *> &state,
+                                           int nNodes, T dt,
+                                           reaction_michaelis_menten &reaction,
+                                           const T *Vm, const T *Km) {
+    int i = threadIdx.x + blockIdx.x * blockDim.x;
+    if (i >= state.at(0)->n)
+        return;
+    reaction.ApplyReaction(state, i, dt, Vm[i / nNodes], Km[i / nNodes]);
+}
+
+void ensemble_simulation::iterate_reaction(T dt) {
+    T drainXdt = drain * dt;
+    auto drainLambda = [drainXdt] __device__(T & x) { x -= drainXdt; };
+    for (auto &species : current_state.vector_holder) {
+        apply_func(species, drainLambda);
+        species.prune();
+    }
+    auto &deviceState = *current_state.get_device_data()._device;
+    auto tb = make1DThreadBlock(current_state.size());
+    for (int k = 0; k < reactions.size(); k++)
+        ensemble_mass_actionK<<<tb.block, tb.thread>>>(
+            deviceState, n_nodes, dt, *reactions[k]._device, rates[k].data);
+    for (int k = 0; k < mmreactions.size(); k++)
+        ensemble_michaelis_mentenK<<<tb.block, tb.thread>>>(
+            deviceState, n_nodes, dt, *mmreactions[k]._device, mm_vm[k].data,
+            mm_km[k].data);
+}
+
+bool ensemble_simulation::iterate_diffusion(T dt) {
+    if (damp_mat == nullptr || stiff_mat == nullptr) {
+        printf("Error! Stiffness and Dampness matrices not loaded\n");
+        return false;
+    }
+    if (last_used_dt != dt) {
+        if (last_used_dt != 0)
+            printf(
+                "Warning! dt should be kept constant when iterating diffusion");
+        hd_data<T> m(-dt);
+        matrix_sum(*damp_mat, *stiff_mat, m(true), diffusion_matrix);
+        last_used_dt = dt;
+    }
+    bool converged = true;
+    for (int i = 0; i < current_state.n_species(); i++) {
+        auto &species = current_state.vector_holder.at(i);
+        if (!current_state.options_holder.at(i).diffusion)
+            continue;
+
+        dot_block(*damp_mat, species, b, n_members);
+        auto solveStart = std::chrono::steady_clock::now();
+        converged =
+            solver.cg_solve(diffusion_matrix, b, species, epsilon) && converged;
+        double time = std::chrono::duration<double>(
+                          std::chrono::steady_clock::now() - solveStart)
+                          .count();
+
+        for (int m = 0; m < n_members; m++) {
+            solve_record record;
+            record.step = n_diffusion_steps;
+            record.species = i;
+            record.member = m;
+            record.n_iter = solver.n_iter_columns[m];
+            record.residual0 = solver.residual0_last[m];
+            record.residual = solver.residual_last[m];
+            record.time = time;
+            record.converged = solver.converged_columns[m];
+            telemetry.record(record);
+        }
+    }
+    if (!converged) {
+        n_diffusion_steps++;
+        return false;
+    }
+    t += dt;
+    n_diffusion_steps++;
+    return true;
+}
+
+void ensemble_simulation::prune(T value) {
+    for (auto &vect : current_state.vector_holder)
+        vect.prune(value);
+}
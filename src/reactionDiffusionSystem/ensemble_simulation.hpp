@@ -0,0 +1,81 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "constants.hpp"
+#include "dataStructures/sparse_matrix.hpp"
+#include "reaction.hpp"
+#include "solvers/block_cg_solver.hpp"
+#include "solvers/solver_telemetry.hpp"
+#include "state.hpp"
+
+// K simulations of the same geometry (members), that only differ by their
+// reaction rates and initial conditions. The members share the damping,
+// stiffness and diffusion matrices, and each species is stored as one block
+// of K vectors: the value of node i for member m is at m * n_nodes + i.
+// Diffusion solves all the members at once (see block_cg_solver), and
+// reactions are applied to the whole block with per member rates.
+class ensemble_simulation {
+  public:
+    int n_nodes;
+    int n_members;
+
+    // Species blocks, of size n_nodes * n_members
+    state current_state;
+
+    block_cg_solver solver;
+    d_vector b;
+
+    // Reactions, with the rates of each member
+    std::vector<reaction_mass_action> reactions;
+    std::vector<d_vector> rates;
+    std::vector<reaction_michaelis_menten> mmreactions;
+    std::vector<d_vector> mm_vm;
+    std::vector<d_vector> mm_km;
+
+    // Shared diffusion matrices
+    std::shared_ptr<d_spmatrix> damp_mat;
+    std::shared_ptr<d_spmatrix> stiff_mat;
+    d_spmatrix diffusion_matrix;
+
+    // Parameters
+    T epsilon = 1e-3;
+    T last_used_dt = 0;
+    T drain = 1.e-13;
+
+    // Enlapsed time
+    T t = 0;
+    // Number of diffusion steps performed
+    int n_diffusion_steps = 0;
+
+    // One record per (species, member) solve
+    solver_telemetry telemetry;
+
+    ensemble_simulation(int nNodes, int nMembers);
+
+    void add_species(std::string name, species_options = species_options());
+    // data holds the n_nodes * n_members values of the block
+    void set_species(std::string name, const T *data, bool is_device);
+    // data holds the n_nodes values of one member
+    void set_member(std::string name, int member, const T *data,
+                    bool is_device);
+    d_vector &get_species(std::string name);
+
+    // One rate per member, or a single rate shared by all the members;
+    // throws std::invalid_argument for any other number of values
+    void add_reaction(const std::string &reaction, std::vector<T> rates);
+    void add_mm_reaction(const std::string &reaction, std::vector<T> Vm,
+                         std::vector<T> Km);
+
+    void load_dampness_matrix(std::shared_ptr<d_spmatrix> damp_mat);
+    void load_stiffness_matrix(std::shared_ptr<d_spmatrix> stiff_mat);
+
+    void iterate_reaction(T dt);
+    bool iterate_diffusion(T dt);
+    void prune(T value = 0);
+
+  private:
+    d_vector member_values(std::vector<T> values);
+};
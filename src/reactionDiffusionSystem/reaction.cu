@@ -1,3 +1,5 @@
+#include <assert.h>
+#include <cstring>
 #include <cuda_runtime.h>
 
 #include "reaction.hpp"
@@ -48,6 +50,22 @@ reaction::reaction(std::map<std::string, int> &names,
                    long unsigned size)
     : reaction(names, reaction_holder(reag, prod), size) {}
 
+reaction::reaction(reaction_holder holder, std::shared_ptr<d_array<int>> tables,
+                   int offset)
+    : Holder(holder),
+      Reagents(tables->data + offset, holder.Reagents.size()),
+      ReagentsCoeff(tables->data + offset + holder.Reagents.size(),
+                    holder.Reagents.size()),
+      Products(tables->data + offset + 2 * holder.Reagents.size(),
+               holder.Products.size()),
+      ProductsCoeff(tables->data + offset + 2 * holder.Reagents.size() +
+                        holder.Products.size(),
+                    holder.Products.size()),
+      Inhibitor(tables->data + offset + 2 * holder.Reagents.size() +
+                    2 * holder.Products.size(),
+                1),
+      Tables(tables) {}
+
 __device__ __host__ void reaction::print() const {
 #ifndef __CUDA_ARCH__
     for (auto coeff : Holder.Reagents)
@@ -66,7 +84,7 @@ reaction::reaction(reaction &&other)
       ReagentsCoeff(std::move(other.ReagentsCoeff)),
       Products(std::move(other.Products)),
       ProductsCoeff(std::move(other.ProductsCoeff)),
-      Inhibitor(std::move(other.Inhibitor)) {}
+      Inhibitor(std::move(other.Inhibitor)), Tables(other.Tables) {}
 
 /////// Mass Action
 
@@ -81,9 +99,13 @@ reaction_mass_action::reaction_mass_action(std::map<std::string, int> &names,
     gpuErrchk(cudaMalloc(&_device, sizeof(reaction_mass_action)));
     gpuErrchk(cudaMemcpy(_device, this, sizeof(reaction_mass_action),
                          cudaMemcpyHostToDevice));
-    gpuErrchk(cudaDeviceSynchronize());
 }
 
+reaction_mass_action::reaction_mass_action(
+    reaction_holder reac, T rate, std::shared_ptr<d_array<int>> tables,
+    int offset)
+    : reaction(reac, tables, offset), K(rate), _device(nullptr) {}
+
 __host__ __device__ void reaction_mass_action::print() const {
 #ifndef __CUDA_ARCH__
     reaction::print();
@@ -106,7 +128,6 @@ reaction_michaelis_menten::reaction_michaelis_menten(
     gpuErrchk(cudaMalloc(&_device, sizeof(reaction_michaelis_menten)));
     gpuErrchk(cudaMemcpy(_device, this, sizeof(reaction_michaelis_menten),
                          cudaMemcpyHostToDevice));
-    gpuErrchk(cudaDeviceSynchronize());
 }
 
 reaction_michaelis_menten::reaction_michaelis_menten(
@@ -117,6 +138,11 @@ reaction_michaelis_menten::reaction_michaelis_menten(
           reaction_holder(std::vector<stochCoeff>{stochCoeff(reag, 1)}, prod),
           Vm, Km) {}
 
+reaction_michaelis_menten::reaction_michaelis_menten(
+    reaction_holder reac, T Vm, T Km, std::shared_ptr<d_array<int>> tables,
+    int offset)
+    : reaction(reac, tables, offset), Vm(Vm), Km(Km), _device(nullptr) {}
+
 __host__ __device__ void reaction_michaelis_menten::print() const {
 #ifndef __CUDA_ARCH__
     reaction::print();
@@ -126,4 +152,77 @@ __host__ __device__ void reaction_michaelis_menten::print() const {
 #endif
 }
 
-reaction::~reaction() {}
\ No newline at end of file
+reaction::~reaction() {}
+
+// Tables of the holders, concatenated, with the offset of each holder
+static std::shared_ptr<d_array<int>>
+upload_tables(std::map<std::string, int> &names,
+              const std::vector<reaction_holder> &holders,
+              std::vector<int> &offsets) {
+    std::vector<int> tables;
+    for (auto &holder : holders) {
+        offsets.push_back(tables.size());
+        for (auto &coeff : holder.Reagents)
+            tables.push_back(names.at(coeff.first));
+        for (auto &coeff : holder.Reagents)
+            tables.push_back(coeff.second);
+        for (auto &coeff : holder.Products)
+            tables.push_back(names.at(coeff.first));
+        for (auto &coeff : holder.Products)
+            tables.push_back(coeff.second);
+        tables.push_back(-1);
+    }
+    auto d_tables = std::make_shared<d_array<int>>(tables.size());
+    gpuErrchk(cudaMemcpy(d_tables->data, tables.data(),
+                         sizeof(int) * tables.size(), cudaMemcpyHostToDevice));
+    return d_tables;
+}
+
+// Copies the reactions from first to the device, in one block that is never
+// freed (like the device copies of the reactions built one by one)
+template <typename Reaction>
+static void upload_reactions(std::vector<Reaction> &reactions, int first) {
+    int count = reactions.size() - first;
+    Reaction *block;
+    gpuErrchk(cudaMalloc(&block, sizeof(Reaction) * count));
+    for (int k = 0; k < count; k++)
+        reactions[first + k]._device = block + k;
+    std::vector<char> images(sizeof(Reaction) * count);
+    for (int k = 0; k < count; k++)
+        memcpy(images.data() + sizeof(Reaction) * k, &reactions[first + k],
+               sizeof(Reaction));
+    gpuErrchk(cudaMemcpy(block, images.data(), images.size(),
+                         cudaMemcpyHostToDevice));
+}
+
+void append_reactions(std::map<std::string, int> &names,
+                      const std::vector<reaction_holder> &holders,
+                      const std::vector<T> &rates,
+                      std::vector<reaction_mass_action> &reactions) {
+    assert(holders.size() == rates.size());
+    if (holders.empty())
+        return;
+    std::vector<int> offsets;
+    auto tables = upload_tables(names, holders, offsets);
+    int first = reactions.size();
+    reactions.reserve(first + holders.size());
+    for (int k = 0; k < holders.size(); k++)
+        reactions.emplace_back(holders[k], rates[k], tables, offsets[k]);
+    upload_reactions(reactions, first);
+}
+
+void append_reactions(std::map<std::string, int> &names,
+                      const std::vector<reaction_holder> &holders,
+                      const std::vector<T> &Vm, const std::vector<T> &Km,
+                      std::vector<reaction_michaelis_menten> &mmreactions) {
+    assert(holders.size() == Vm.size() && holders.size() == Km.size());
+    if (holders.empty())
+        return;
+    std::vector<int> offsets;
+    auto tables = upload_tables(names, holders, offsets);
+    int first = mmreactions.size();
+    mmreactions.reserve(first + holders.size());
+    for (int k = 0; k < holders.size(); k++)
+        mmreactions.emplace_back(holders[k], Vm[k], Km[k], tables, offsets[k]);
+    upload_reactions(mmreactions, first);
+}
\ No newline at end of file
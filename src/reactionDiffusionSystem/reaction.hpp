@@ -1,6 +1,8 @@
 #pragma once
 
 // #include <nvfunctional>
+#include <map>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -28,6 +30,9 @@ class reaction {
     d_array<int> Products;
     d_array<int> ProductsCoeff;
     d_array<int> Inhibitor;
+    // Tables shared by the reactions built together (see append_reactions),
+    // the arrays above are then views on them
+    std::shared_ptr<d_array<int>> Tables;
 
     // reaction *_device;
 
@@ -35,6 +40,10 @@ class reaction {
              std::vector<stochCoeff>, long unsigned size);
     reaction(std::map<std::string, int> &names, reaction_holder,
              long unsigned size);
+    // Views on the tables from offset: reagents, their coefficients,
+    // products, their coefficients and inhibitor
+    reaction(reaction_holder, std::shared_ptr<d_array<int>> tables,
+             int offset);
     reaction(reaction &&);
 
     void add_inhibitor(int);
@@ -53,10 +62,19 @@ class reaction_mass_action : public reaction {
     reaction_mass_action(std::map<std::string, int> &names, reaction_holder, T);
     reaction_mass_action(std::map<std::string, int> &names,
                          std::vector<stochCoeff>, std::vector<stochCoeff>, T);
+    // Without device copy, see append_reactions
+    reaction_mass_action(reaction_holder, T, std::shared_ptr<d_array<int>>,
+                         int offset);
 
     inline __device__ void ApplyReaction(d_array<d_vector *> &state, int i,
                                          float dt) {
-        T progress = K * dt;
+        ApplyReaction(state, i, dt, K);
+    }
+
+    // Same with another rate, e.g. the rate of one member of an ensemble
+    inline __device__ void ApplyReaction(d_array<d_vector *> &state, int i,
+                                         float dt, T rate) {
+        T progress = rate * dt;
         if (Inhibitor.at(0) != -1)
             progress *= 1 / (1 + state.at(Inhibitor.at(0))->at(i));
 
@@ -83,8 +101,15 @@ class reaction_michaelis_menten : public reaction {
                               reaction_holder, T, T);
     reaction_michaelis_menten(std::map<std::string, int> &names, std::string,
                               std::vector<stochCoeff>, T, T);
+    reaction_michaelis_menten(reaction_holder, T, T,
+                              std::shared_ptr<d_array<int>>, int offset);
     __device__ void inline ApplyReaction(d_array<d_vector *> &state, int i,
                                          float dt) {
+        ApplyReaction(state, i, dt, Vm, Km);
+    }
+
+    __device__ void inline ApplyReaction(d_array<d_vector *> &state, int i,
+                                         float dt, T Vm, T Km) {
         auto &val = state.at(Reagents.at(0))->at(i);
         T progress = Vm * dt / (Km + val);
         if (Inhibitor.at(0) != -1)
@@ -98,3 +123,15 @@ class reaction_michaelis_menten : public reaction {
 
     __host__ __device__ void print() const;
 };
+
+// Appends reactions with one allocation and one transfer for all their
+// tables, and one for their device copies, rather than a few synchronous
+// transfers per reaction. The species of the holders must be in names.
+void append_reactions(std::map<std::string, int> &names,
+                      const std::vector<reaction_holder> &holders,
+                      const std::vector<T> &rates,
+                      std::vector<reaction_mass_action> &reactions);
+void append_reactions(std::map<std::string, int> &names,
+                      const std::vector<reaction_holder> &holders,
+                      const std::vector<T> &Vm, const std::vector<T> &Km,
+                      std::vector<reaction_michaelis_menten> &mmreactions);
@@ -0,0 +1,475 @@
+#include <algorithm>
+
+#include "helper/cuda/cuda_context.hpp"
+#include "helper/cuda/cuda_error_check.h"
+#include "helper/cuda/cuda_scan.hpp"
+#include "helper/cuda/cuda_thread_manager.hpp"
+#include "reaction_network.hpp"
+
+// Bound on the scratch used by the per node values, the nodes are integrated
+// by chunks that fit in it
+#define NETWORK_SCRATCH_BYTES (1 << 25)
+// Buckets of the adaptive integration: bucket b holds the nodes that took
+// [2^b, 2^(b + 1)) sub-steps
+#define NETWORK_COST_BUCKETS 16
+
+template <typename C>
+void upload(d_array<C> &array, const std::vector<C> &values) {
+    if (array.n != values.size())
+        array.resize(values.size());
+    if (!values.empty())
+        gpuErrchk(cudaMemcpy(array.data, values.data(),
+                             sizeof(C) * values.size(),
+                             cudaMemcpyHostToDevice));
+}
+
+bool kinetic_reaction::vanishes_at_zero() const {
+    for (auto &factor : factors)
+        if (factor.op != inhibition_op &&
+            (factor.op != power_op || factor.p0 > 0))
+            return true;
+    return false;
+}
+
+void reaction_network::compile(
+    state &state, std::vector<reaction_mass_action> &reactions,
+    std::vector<reaction_michaelis_menten> &mmreactions,
+    std::vector<kinetic_reaction> &kinetics) {
+    n_species = state.n_species();
+    n_reactions = reactions.size() + mmreactions.size() + kinetics.size();
+
+    // The reaction objects in the general form
+    std::vector<kinetic_reaction> all;
+    all.reserve(n_reactions);
+    auto describe = [&](reaction &reac, T rateConstant) {
+        kinetic_reaction kinetic;
+        kinetic.rate_constant = rateConstant;
+        for (auto &coeff : reac.Holder.Reagents) {
+            kinetic.species.push_back(state.names.at(coeff.first));
+            kinetic.coefficients.push_back(-coeff.second);
+        }
+        for (auto &coeff : reac.Holder.Products) {
+            kinetic.species.push_back(state.names.at(coeff.first));
+            kinetic.coefficients.push_back(coeff.second);
+        }
+        return kinetic;
+    };
+    auto inhibitorOf = [](reaction &reac) {
+        int inhib;
+        gpuErrchk(cudaMemcpy(&inhib, reac.Inhibitor.data, sizeof(int),
+                             cudaMemcpyDeviceToHost));
+        return inhib;
+    };
+    for (auto &reac : reactions) {
+        auto kinetic = describe(reac, reac.K);
+        int inhib = inhibitorOf(reac);
+        if (inhib >= 0)
+            kinetic.factors.push_back(rate_factor{inhibition_op, inhib, -1, 1});
+        for (auto &coeff : reac.Holder.Reagents)
+            kinetic.factors.push_back(rate_factor{
+                power_op, state.names.at(coeff.first), -1, T(coeff.second)});
+        all.push_back(kinetic);
+    }
+    for (auto &reac : mmreactions) {
+        auto kinetic = describe(reac, reac.Vm);
+        int v = state.names.at(reac.Holder.Reagents.at(0).first);
+        kinetic.factors.push_back(rate_factor{saturation_op, v, -1, reac.Km});
+        int inhib = inhibitorOf(reac);
+        if (inhib >= 0)
+            kinetic.factors.push_back(rate_factor{competition_op, v, inhib});
+        all.push_back(kinetic);
+    }
+    all.insert(all.end(), kinetics.begin(), kinetics.end());
+
+    // Local numbering, in order of first appearance
+    std::vector<int> localIndex(n_species, -1);
+    local_species.clear();
+    auto local = [&](int s) {
+        if (localIndex[s] < 0) {
+            localIndex[s] = local_species.size();
+            local_species.push_back(s);
+        }
+        return localIndex[s];
+    };
+
+    std::vector<T> h_rate, h_p0, h_p1;
+    std::vector<int> programOffsets{0}, h_op, h_species, h_species2;
+    std::vector<int> stoichOffsets{0}, stoichSpecies, stoichCoeff;
+    for (auto &kinetic : all) {
+        h_rate.push_back(kinetic.rate_constant);
+        for (auto &factor : kinetic.factors) {
+            h_op.push_back(factor.op);
+            h_species.push_back(local(factor.species));
+            h_species2.push_back(
+                (factor.species2 >= 0) ? local(factor.species2) : -1);
+            h_p0.push_back(factor.p0);
+            h_p1.push_back(factor.p1);
+        }
+        programOffsets.push_back(h_op.size());
+
+        // Net coefficients, in order of first appearance
+        int first = stoichSpecies.size();
+        for (int k = 0; k < kinetic.species.size(); k++) {
+            int a = local(kinetic.species[k]);
+            auto same = std::find(stoichSpecies.begin() + first,
+                                  stoichSpecies.end(), a);
+            if (same != stoichSpecies.end())
+                stoichCoeff[same - stoichSpecies.begin()] +=
+                    kinetic.coefficients[k];
+            else {
+                stoichSpecies.push_back(a);
+                stoichCoeff.push_back(kinetic.coefficients[k]);
+            }
+        }
+        for (int k = stoichSpecies.size() - 1; k >= first; k--)
+            if (stoichCoeff[k] == 0) {
+                stoichSpecies.erase(stoichSpecies.begin() + k);
+                stoichCoeff.erase(stoichCoeff.begin() + k);
+            }
+        stoichOffsets.push_back(stoichSpecies.size());
+    }
+    n_local = local_species.size();
+
+    upload(rate_constant, h_rate);
+    upload(program_offsets, programOffsets);
+    upload(op, h_op);
+    upload(op_species, h_species);
+    upload(op_species2, h_species2);
+    upload(op_p0, h_p0);
+    upload(op_p1, h_p1);
+    upload(stoich_offsets, stoichOffsets);
+    upload(stoich_species, stoichSpecies);
+    upload(stoich_coeff, stoichCoeff);
+}
+
+network_view reaction_network::view() {
+    network_view net;
+    net.n_reactions = n_reactions;
+    net.n_local = n_local;
+    net.rate_constant = rate_constant.data;
+    net.program_offsets = program_offsets.data;
+    net.op = op.data;
+    net.op_species = op_species.data;
+    net.op_species2 = op_species2.data;
+    net.op_p0 = op_p0.data;
+    net.op_p1 = op_p1.data;
+    net.stoich_offsets = stoich_offsets.data;
+    net.stoich_species = stoich_species.data;
+    net.stoich_coeff = stoich_coeff.data;
+    return net;
+}
+
+// Solves M x = g in place (g becomes x) by Gaussian elimination with partial
+// pivoting. Returns false if M is singular.
+__device__ bool dense_solve(strided_values M, strided_values g, int m) {
+    for (int c = 0; c < m; c++) {
+        int pivot = c;
+        for (int r = c + 1; r < m; r++)
+            if (fabs(M[r * m + c]) > fabs(M[pivot * m + c]))
+                pivot = r;
+        if (M[pivot * m + c] == 0)
+            return false;
+        if (pivot != c) {
+            for (int k = c; k < m; k++) {
+                T tmp = M[c * m + k];
+                M[c * m + k] = M[pivot * m + k];
+                M[pivot * m + k] = tmp;
+            }
+            T tmp = g[c];
+            g[c] = g[pivot];
+            g[pivot] = tmp;
+        }
+        for (int r = c + 1; r < m; r++) {
+            T factor = M[r * m + c] / M[c * m + c];
+            if (factor == 0)
+                continue;
+            for (int k = c + 1; k < m; k++)
+                M[r * m + k] -= factor * M[c * m + k];
+            g[r] -= factor * g[c];
+        }
+    }
+    for (int c = m - 1; c >= 0; c--) {
+        T x = g[c];
+        for (int k = c + 1; k < m; k++)
+            x -= M[c * m + k] * g[k];
+        g[c] = x / M[c * m + c];
+    }
+    return true;
+}
+
+// Backward Euler on the nodes [first, first + stride) of the list nodes (of
+// all the nodes if it is null), one thread per node: Newton iterations (I -
+// dt J(u)) delta = u0 - u + dt f(u), from u = u0. The iterates are kept
+// non-negative.
+__global__ void implicit_reactionK(network_view net, T *const *species,
+                                   const int *nodes, int nNodes, int first,
+                                   int stride, T dt, int maxNewton,
+                                   T tolerance, T *scratch) {
+    int i = threadIdx.x + blockIdx.x * blockDim.x;
+    if (i >= stride || first + i >= nNodes)
+        return;
+    int node = (nodes) ? nodes[first + i] : first + i;
+    int m = net.n_local;
+    strided_values u0{scratch + i, stride};
+    strided_values u{scratch + m * stride + i, stride};
+    strided_values g{scratch + 2 * m * stride + i, stride};
+    strided_values M{scratch + 3 * m * stride + i, stride};
+
+    for (int a = 0; a < m; a++) {
+        u0[a] = species[a][node];
+        u[a] = u0[a];
+    }
+    for (int iter = 0; iter < maxNewton; iter++) {
+        for (int a = 0; a < m; a++) {
+            g[a] = u0[a] - u[a];
+            for (int b = 0; b < m; b++)
+                M[a * m + b] = (a == b) ? 1 : 0;
+        }
+        for (int r = 0; r < net.n_reactions; r++) {
+            T rate = net.rate(r, u);
+            net.stoichiometry(r, [&](int a, int c) { g[a] += dt * c * rate; });
+            net.rate_gradient(r, u, [&](int b, T d) {
+                net.stoichiometry(
+                    r, [&](int a, int c) { M[a * m + b] -= dt * c * d; });
+            });
+        }
+        if (!dense_solve(M, g, m))
+            break;
+
+        T scale = 0;
+        T change = 0;
+        for (int a = 0; a < m; a++) {
+            T next = max(u[a] + g[a], T(0));
+            change = max(change, fabs(next - u[a]));
+            u[a] = next;
+            scale = max(scale, next);
+        }
+        if (change <= tolerance * scale)
+            break;
+    }
+    for (int a = 0; a < m; a++)
+        species[a][node] = u[a];
+}
+
+// The reactions one after the other on the nodes [first, first + stride) of
+// the list nodes (of all the nodes if it is null), one thread per node
+__global__ void explicit_reactionK(network_view net, T *const *species,
+                                   const int *nodes, int nNodes, int first,
+                                   int stride, T dt, T *scratch) {
+    int i = threadIdx.x + blockIdx.x * blockDim.x;
+    if (i >= stride || first + i >= nNodes)
+        return;
+    int node = (nodes) ? nodes[first + i] : first + i;
+    int m = net.n_local;
+    strided_values u{scratch + i, stride};
+    for (int a = 0; a < m; a++)
+        u[a] = species[a][node];
+    for (int r = 0; r < net.n_reactions; r++) {
+        T progress = dt * net.rate(r, u);
+        net.stoichiometry(r, [&](int a, int c) { u[a] += c * progress; });
+    }
+    for (int a = 0; a < m; a++)
+        species[a][node] = u[a];
+}
+
+void reaction_network::integrate_explicit(state &state, T dt,
+                                          const int *nodes, int nNodes) {
+    int n = (nodes) ? nNodes : state.size();
+    int m = n_local;
+    if (n_reactions == 0 || m == 0 || n == 0)
+        return;
+
+    bind(state);
+
+    // Per node: u
+    size_t perNode = sizeof(T) * (size_t)m;
+    int chunk = std::max<size_t>(1, NETWORK_SCRATCH_BYTES / perNode);
+    chunk = std::min(chunk, n);
+    T *scratch = (T *)thread_context().scratch(perNode * chunk);
+    network_view net = view();
+    for (int first = 0; first < n; first += chunk) {
+        auto tb = make1DThreadBlock(std::min(chunk, n - first));
+        explicit_reactionK<<<tb.block, tb.thread>>>(
+            net, local_data.data, nodes, n, first, chunk, dt, scratch);
+        gpuErrchk(cudaPeekAtLastError());
+    }
+}
+
+void reaction_network::bind(state &state) {
+    std::vector<T *> h_data(n_local);
+    for (int a = 0; a < n_local; a++)
+        h_data[a] = state.vector_holder.at(local_species[a]).data;
+    upload(local_data, h_data);
+}
+
+void reaction_network::integrate(state &state, T dt, int maxNewton,
+                                 T tolerance, const int *nodes, int nNodes) {
+    int n = (nodes) ? nNodes : state.size();
+    int m = n_local;
+    if (n_reactions == 0 || m == 0 || n == 0 || maxNewton <= 0)
+        return;
+
+    bind(state);
+
+    // Per node: u0, u, g and the m x m matrix
+    size_t perNode = sizeof(T) * (size_t)m * (m + 3);
+    int chunk = std::max<size_t>(1, NETWORK_SCRATCH_BYTES / perNode);
+    chunk = std::min(chunk, n);
+    T *scratch = (T *)thread_context().scratch(perNode * chunk);
+    network_view net = view();
+    for (int first = 0; first < n; first += chunk) {
+        auto tb = make1DThreadBlock(std::min(chunk, n - first));
+        implicit_reactionK<<<tb.block, tb.thread>>>(
+            net, local_data.data, nodes, n, first, chunk, dt, maxNewton,
+            tolerance, scratch);
+        gpuErrchk(cudaPeekAtLastError());
+    }
+}
+
+__device__ int cost_bucket(int substeps) {
+    int bucket = 31 - __clz(max(substeps, 1));
+    // Most expensive first
+    return NETWORK_COST_BUCKETS - 1 - min(bucket, NETWORK_COST_BUCKETS - 1);
+}
+
+__global__ void count_bucketsK(int n, const int *substeps, int *counts) {
+    int i = threadIdx.x + blockIdx.x * blockDim.x;
+    if (i >= n)
+        return;
+    atomicAdd(&counts[cost_bucket(substeps[i])], 1);
+}
+
+// The order of the nodes inside a bucket is arbitrary, the result of a node
+// does not depend on it
+__global__ void sort_bucketsK(int n, const int *substeps, int *offsets,
+                              int *order) {
+    int i = threadIdx.x + blockIdx.x * blockDim.x;
+    if (i >= n)
+        return;
+    order[atomicAdd(&offsets[cost_bucket(substeps[i])], 1)] = i;
+}
+
+// Bogacki-Shampine on the nodes order[first, first + stride), one thread per
+// node. The last derivative of an accepted sub-step is the first one of the
+// next (FSAL).
+__global__ void adaptive_reactionK(network_view net, T *const *species,
+                                   const int *order, int nNodes, int first,
+                                   int stride, T dt, T rtol, T atol,
+                                   int maxSubsteps, T *nodeStep,
+                                   int *nodeSubsteps, T *scratch) {
+    int i = threadIdx.x + blockIdx.x * blockDim.x;
+    if (i >= stride || first + i >= nNodes)
+        return;
+    int node = order[first + i];
+    int m = net.n_local;
+    strided_values u{scratch + i, stride};
+    strided_values y{scratch + m * stride + i, stride};
+    strided_values k1{scratch + 2 * m * stride + i, stride};
+    strided_values k2{scratch + 3 * m * stride + i, stride};
+    strided_values k3{scratch + 4 * m * stride + i, stride};
+    strided_values k4{scratch + 5 * m * stride + i, stride};
+
+    for (int a = 0; a < m; a++)
+        u[a] = species[a][node];
+    T h = (nodeStep[node] > 0) ? min(nodeStep[node], dt) : dt;
+    T t = 0;
+    int substeps = 0;
+    bool done = false;
+    net.derivative(u, k1);
+    while (!done) {
+        // The last sub-step ends exactly at dt, and is accepted whatever its
+        // error once maxSubsteps is reached
+        T proposal = h;
+        bool forced = substeps + 1 >= maxSubsteps;
+        bool lastStep = forced || t + h >= dt;
+        if (lastStep)
+            h = dt - t;
+        for (int a = 0; a < m; a++)
+            y[a] = u[a] + h / 2 * k1[a];
+        net.derivative(y, k2);
+        for (int a = 0; a < m; a++)
+            y[a] = u[a] + 3 * h / 4 * k2[a];
+        net.derivative(y, k3);
+        for (int a = 0; a < m; a++)
+            y[a] = u[a] + h * (2 * k1[a] + 3 * k2[a] + 4 * k3[a]) / 9;
+        net.derivative(y, k4);
+
+        T error = 0;
+        for (int a = 0; a < m; a++) {
+            T e = h * (-5 * k1[a] / 72 + k2[a] / 12 + k3[a] / 9 - k4[a] / 8);
+            T scale = atol + rtol * max(fabs(u[a]), fabs(y[a]));
+            error = max(error, fabs(e) / scale);
+        }
+        T factor = (error > 0) ? 0.9 * pow(error, -1. / 3) : 5;
+        factor = min(T(5), max(T(0.2), factor));
+        substeps++;
+        if (error <= 1 || forced) {
+            t += h;
+            done = lastStep;
+            bool clamped = false;
+            for (int a = 0; a < m; a++) {
+                clamped |= y[a] < 0;
+                u[a] = max(y[a], T(0));
+                k1[a] = k4[a];
+            }
+            if (clamped && !done)
+                net.derivative(u, k1);
+            // A step shortened to end at dt says nothing about the next one
+            if (lastStep && error <= 1)
+                h = max(h * factor, proposal);
+            else
+                h *= factor;
+        } else {
+            h *= factor;
+        }
+    }
+    nodeStep[node] = h;
+    for (int a = 0; a < m; a++)
+        species[a][node] = u[a];
+    nodeSubsteps[node] = substeps;
+}
+
+void reaction_network::integrate_adaptive(state &state, T dt, T rtol, T atol,
+                                          int maxSubsteps) {
+    int n = state.size();
+    int m = n_local;
+    if (n_reactions == 0 || m == 0 || n == 0)
+        return;
+    bind(state);
+    if (node_substeps.n != n) {
+        node_substeps.resize(n);
+        node_substeps.fill(1);
+        node_step.resize(n);
+        node_step.fill(0);
+        node_order.resize(n);
+    }
+
+    // Cost buckets of the previous call
+    if (bucket_offsets.n != NETWORK_COST_BUCKETS)
+        bucket_offsets.resize(NETWORK_COST_BUCKETS);
+    bucket_offsets.fill(0);
+    auto tb = make1DThreadBlock(n);
+    count_bucketsK<<<tb.block, tb.thread>>>(n, node_substeps.data,
+                                            bucket_offsets.data);
+    gpuErrchk(cudaPeekAtLastError());
+    exclusive_scan(bucket_offsets);
+    sort_bucketsK<<<tb.block, tb.thread>>>(n, node_substeps.data,
+                                           bucket_offsets.data,
+                                           node_order.data);
+    gpuErrchk(cudaPeekAtLastError());
+
+    // Per node: u, y and the four derivatives
+    size_t perNode = sizeof(T) * (size_t)m * 6;
+    int chunk = std::max<size_t>(1, NETWORK_SCRATCH_BYTES / perNode);
+    chunk = std::min(chunk, n);
+    T *scratch = (T *)thread_context().scratch(perNode * chunk);
+    network_view net = view();
+    for (int first = 0; first < n; first += chunk) {
+        auto chunkTb = make1DThreadBlock(std::min(chunk, n - first));
+        adaptive_reactionK<<<chunkTb.block, chunkTb.thread>>>(
+            net, local_data.data, node_order.data, n, first, chunk, dt, rtol,
+            atol, std::max(maxSubsteps, 1), node_step.data,
+            node_substeps.data, scratch);
+        gpuErrchk(cudaPeekAtLastError());
+    }
+}
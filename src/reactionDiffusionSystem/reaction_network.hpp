@@ -0,0 +1,264 @@
+#pragma once
+
+#include <vector>
+
+#include "constants.hpp"
+#include "dataStructures/array.hpp"
+#include "reaction.hpp"
+#include "state.hpp"
+
+// How the reactions are integrated over one time step
+enum reaction_integrator {
+    // Reactions applied one after the other, in place (the historical
+    // scheme): cheap, but dt is limited by the fastest reaction
+    explicit_euler,
+    // One Newton iteration of backward Euler from the current state (a
+    // one-stage Rosenbrock method): one linear solve per node and step
+    linearly_implicit_euler,
+    // Backward Euler, Newton iterations until convergence
+    backward_euler,
+    // Explicit Bogacki-Shampine 3(2) pair, each node adapts its own
+    // sub-steps within dt to an error tolerance
+    adaptive_rk23
+};
+
+// Operations of the rate programs. The rate of a reaction is its rate
+// constant times the factors of its operations, each a function of one or two
+// species s and s2 with parameters p0 and p1.
+enum rate_op {
+    // u[s]^p0 (mass action)
+    power_op,
+    // u[s] / (p0 + u[s]) (Michaelis-Menten)
+    saturation_op,
+    // u[s]^p1 / (p0 + u[s]^p1) (Hill, p0 is K^p1)
+    hill_op,
+    // 1 / (1 + u[s] / p0) (non-competitive inhibition)
+    inhibition_op,
+    // u[s] / (u[s] + u[s2]), 0 if both are 0 (inhibitor of a Michaelis-Menten
+    // reaction)
+    competition_op
+};
+
+struct rate_factor {
+    rate_op op;
+    int species; // In the numbering of the state
+    int species2 = -1;
+    T p0 = 0;
+    T p1 = 0;
+};
+
+// Reaction of any kinetics: species[k] changes by coefficients[k] times the
+// rate, rate_constant times the factors
+struct kinetic_reaction {
+    std::vector<int> species; // In the numbering of the state
+    std::vector<int> coefficients;
+    T rate_constant = 0;
+    std::vector<rate_factor> factors;
+
+    // True if the rate is 0 when all the species of the state are 0
+    bool vanishes_at_zero() const;
+};
+
+// Values of the species of one node in a scratch buffer shared by the nodes:
+// value k of node i is at data[k * stride + i], so that consecutive threads
+// access consecutive addresses
+struct strided_values {
+    T *data;
+    int stride;
+    __device__ T &operator[](int k) const { return data[k * stride]; }
+};
+
+// Device tables of a reaction network, passed by value to the kernels.
+// Species are numbered locally: only the species of the reactions are
+// integrated.
+// The rates are computed by a small interpreter: the operations of reaction r
+// are [program_offsets[r], program_offsets[r + 1]). Every node runs the same
+// program, so the threads of a warp (one node each) execute the same
+// operation at the same time, in lockstep, and read the same operands. New
+// kinetics only need a new rate_op.
+// The stoichiometry is a sparse matrix, one row of net coefficients per
+// reaction (a catalyst has none).
+struct network_view {
+    int n_reactions;
+    int n_local;
+    const T *rate_constant;
+    const int *program_offsets;
+    const int *op;
+    const int *op_species;
+    const int *op_species2;
+    const T *op_p0;
+    const T *op_p1;
+    const int *stoich_offsets;
+    const int *stoich_species;
+    const int *stoich_coeff;
+
+    __device__ T factor(int k, strided_values u) const {
+        T v = u[op_species[k]];
+        switch (op[k]) {
+        case power_op:
+            return pow(v, op_p0[k]);
+        case saturation_op:
+            return v / (op_p0[k] + v);
+        case hill_op: {
+            T vn = pow(v, op_p1[k]);
+            return vn / (op_p0[k] + vn);
+        }
+        case inhibition_op:
+            return 1 / (1 + v / op_p0[k]);
+        case competition_op: {
+            T sum = v + u[op_species2[k]];
+            return (sum > 0) ? v / sum : 0;
+        }
+        }
+        return 1;
+    }
+
+    // Calls visit(s, d) with scale times the derivative d of the factor of
+    // operation k with respect to each species s it depends on
+    template <typename Visit>
+    __device__ void factor_gradient(int k, strided_values u, T scale,
+                                    Visit visit) const {
+        T v = u[op_species[k]];
+        T p0 = op_p0[k];
+        switch (op[k]) {
+        case power_op:
+            visit(op_species[k], scale * p0 * pow(v, p0 - 1));
+            return;
+        case saturation_op:
+            visit(op_species[k], scale * p0 / ((p0 + v) * (p0 + v)));
+            return;
+        case hill_op: {
+            T p1 = op_p1[k];
+            T vn = pow(v, p1);
+            visit(op_species[k],
+                  scale * p1 * pow(v, p1 - 1) * p0 / ((p0 + vn) * (p0 + vn)));
+            return;
+        }
+        case inhibition_op:
+            visit(op_species[k], -scale / (p0 * (1 + v / p0) * (1 + v / p0)));
+            return;
+        case competition_op: {
+            T w = u[op_species2[k]];
+            T sum = v + w;
+            if (sum <= 0)
+                return;
+            visit(op_species[k], scale * w / (sum * sum));
+            visit(op_species2[k], -scale * v / (sum * sum));
+            return;
+        }
+        }
+    }
+
+    __device__ T rate(int r, strided_values u) const {
+        T value = rate_constant[r];
+        for (int k = program_offsets[r]; k < program_offsets[r + 1]; k++)
+            value *= factor(k, u);
+        return value;
+    }
+
+    // Calls visit(s, d) with the derivative d of the rate of r with respect
+    // to each species s it depends on (a species of several factors is
+    // visited once per factor)
+    template <typename Visit>
+    __device__ void rate_gradient(int r, strided_values u, Visit visit) const {
+        int first = program_offsets[r];
+        int last = program_offsets[r + 1];
+        for (int k = first; k < last; k++) {
+            T others = rate_constant[r];
+            for (int j = first; j < last; j++)
+                if (j != k)
+                    others *= factor(j, u);
+            factor_gradient(k, u, others, visit);
+        }
+    }
+
+    // f = sum over the reactions of the stoichiometry times the rate
+    __device__ void derivative(strided_values u, strided_values f) const {
+        for (int a = 0; a < n_local; a++)
+            f[a] = 0;
+        for (int r = 0; r < n_reactions; r++) {
+            T value = rate(r, u);
+            stoichiometry(r, [&](int a, int c) { f[a] += c * value; });
+        }
+    }
+
+    // Calls visit(s, c) with the net stoichiometric coefficient c of each
+    // species s of r
+    template <typename Visit>
+    __device__ void stoichiometry(int r, Visit visit) const {
+        for (int k = stoich_offsets[r]; k < stoich_offsets[r + 1]; k++)
+            visit(stoich_species[k], stoich_coeff[k]);
+    }
+};
+
+// The reactions of a simulation compiled to flat device tables (a rate
+// program and a stoichiometry matrix), integrated node by node, all the
+// reactions of a node in one kernel. With the implicit integrators each node
+// solves its own small dense system over the local species, so stiff networks
+// (e.g. the fast Michaelis-Menten reactions of imported CRNs) can use a time
+// step chosen for the diffusion. With adaptive_rk23 each node chooses its own
+// sub-steps.
+class reaction_network {
+  public:
+    int n_reactions = 0;
+    int n_species = 0; // Species of the state when compiled
+    int n_local = 0;
+
+    d_vector rate_constant;
+    d_array<int> program_offsets;
+    d_array<int> op;
+    d_array<int> op_species;
+    d_array<int> op_species2;
+    d_vector op_p0;
+    d_vector op_p1;
+    d_array<int> stoich_offsets;
+    d_array<int> stoich_species;
+    d_array<int> stoich_coeff;
+    // Index in the state of each local species
+    std::vector<int> local_species;
+
+    // The mass action reactions, then the Michaelis-Menten ones, then the
+    // kinetic ones
+    void compile(state &state,
+                 std::vector<reaction_mass_action> &reactions,
+                 std::vector<reaction_michaelis_menten> &mmreactions,
+                 std::vector<kinetic_reaction> &kinetics);
+    network_view view();
+
+    // Integrates the reactions over dt on every node, with at most maxNewton
+    // Newton iterations (linearly_implicit_euler makes one). A node stops
+    // iterating when no species changes by more than tolerance times the
+    // largest species of the node. The species are kept non-negative.
+    // Only the nNodes nodes of the device list nodes are integrated if it is
+    // given.
+    void integrate(state &state, T dt, int maxNewton, T tolerance,
+                   const int *nodes = nullptr, int nNodes = 0);
+
+    // Applies the reactions one after the other over dt, each from the
+    // values left by the previous ones (explicit_euler), on every node or on
+    // the nNodes nodes of the device list nodes
+    void integrate_explicit(state &state, T dt, const int *nodes = nullptr,
+                            int nNodes = 0);
+
+    // Integrates the reactions over dt with adaptive_rk23: a sub-step is
+    // accepted if the error estimate of every species is under atol + rtol *
+    // |value|. A node takes at most maxSubsteps sub-steps, the last one
+    // covering what is left of dt.
+    // To keep the threads of a warp busy for the same time, the nodes are
+    // sorted by their number of sub-steps in the previous call (in
+    // logarithmic buckets, the most expensive first), and each node starts
+    // from its last accepted sub-step.
+    void integrate_adaptive(state &state, T dt, T rtol, T atol,
+                            int maxSubsteps);
+    // Number of sub-steps of each node in the last adaptive call
+    d_array<int> node_substeps;
+
+  private:
+    d_array<T *> local_data;
+    d_vector node_step;
+    d_array<int> node_order;
+    d_array<int> bucket_offsets;
+
+    // Copies the pointers to the local species of the state to the device
+    void bind(state &state);
+};
@@ -1,8 +1,12 @@
+#include "crn_loader.hpp"
 #include "dataStructures/helper/apply_operation.h"
 #include "parse_reaction.hpp"
-#include "reaction_computer.h"
 #include "simulation.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <fstream>
+#include <set>
 
 simulation::simulation(int size) : current_state(size), solver(size), b(size){};
 simulation::simulation(state &imp_state) : simulation(std::move(imp_state)){};
@@ -10,7 +14,7 @@ simulation::simulation(state &&imp_state)
     : current_state(std::move(imp_state)), solver(imp_state.vector_size),
       b(imp_state.vector_size){};
 
-void check_reaction(simulation &sys, reaction_holder &reaction) {
+void check_reaction(simulation &sys, const reaction_holder &reaction) {
     for (auto species : reaction.Reagents) {
         if (sys.current_state.names.find(species.first) ==
             sys.current_state.names.end()) {
@@ -82,11 +86,102 @@ void simulation::add_mm_reaction(const std::string &descriptor, T Vm, T Km) {
                              reaction.Products, Vm, Km);
 }
 
+void simulation::add_hill_reaction(const std::string &descriptor, T Vm, T K,
+                                   T n) {
+    add_hill_reaction(parse_reaction(descriptor), Vm, K, n);
+}
+void simulation::add_hill_reaction(const reaction_holder &reaction, T Vm, T K,
+                                   T n) {
+    if (reaction.Reagents.size() != 1 || reaction.Reagents.at(0).second != 1) {
+        throw std::invalid_argument(
+            "A Hill reaction takes only one species as reagent\n");
+    }
+    if (!(K > 0) || !(n > 0))
+        throw std::invalid_argument("K and n must be positive\n");
+    check_reaction(*this, reaction);
+    kinetic_reaction kinetic;
+    kinetic.rate_constant = Vm;
+    int reagent = current_state.names.at(reaction.Reagents.at(0).first);
+    kinetic.species.push_back(reagent);
+    kinetic.coefficients.push_back(-1);
+    for (auto &coeff : reaction.Products) {
+        kinetic.species.push_back(current_state.names.at(coeff.first));
+        kinetic.coefficients.push_back(coeff.second);
+    }
+    kinetic.factors.push_back(
+        rate_factor{hill_op, reagent, -1, std::pow(K, n), n});
+    kinetic_reactions.push_back(kinetic);
+}
+
+int simulation::load_crn(const std::string &text) {
+    auto network = parse_crn(text);
+    auto &names = current_state.names;
+
+    // Everything is checked before the simulation is modified
+    std::set<std::string> declared;
+    for (auto &species : network.species) {
+        auto existing = names.find(species.name);
+        if (existing != names.end() &&
+            current_state.options_holder.at(existing->second).diffusion !=
+                species.diffusion)
+            throw std::invalid_argument(
+                "line " + std::to_string(species.line) + ": species " +
+                species.name + " exists with another diffusion option");
+        declared.insert(species.name);
+    }
+    for (auto &reaction : network.reactions)
+        for (auto *side : {&reaction.holder.Reagents, &reaction.holder.Products})
+            for (auto &coeff : *side)
+                if (!names.count(coeff.first) && !declared.count(coeff.first))
+                    throw std::invalid_argument(
+                        "line " + std::to_string(reaction.line) +
+                        ": unknown species " + coeff.first);
+
+    for (auto &species : network.species) {
+        bool added = !names.count(species.name);
+        if (added)
+            current_state.add_species(species.name,
+                                      species_options(species.diffusion));
+        if (added || species.has_value)
+            current_state.get_species(species.name).fill(species.value);
+    }
+
+    std::vector<reaction_holder> holders, mmHolders;
+    std::vector<T> rates, Vm, Km;
+    for (auto &reaction : network.reactions) {
+        if (reaction.law == crn_michaelis_menten) {
+            mmHolders.push_back(reaction.holder);
+            Vm.push_back(reaction.k0);
+            Km.push_back(reaction.k1);
+        } else if (reaction.law == crn_mass_action) {
+            holders.push_back(reaction.holder);
+            rates.push_back(reaction.k0);
+        }
+    }
+    append_reactions(names, holders, rates, reactions);
+    append_reactions(names, mmHolders, Vm, Km, mmreactions);
+    // Checked already
+    for (auto &reaction : network.reactions)
+        if (reaction.law == crn_hill)
+            add_hill_reaction(reaction.holder, reaction.k0, reaction.k1,
+                              reaction.k2);
+    return network.reactions.size();
+}
+
+// Non-owning pointers
 void simulation::load_dampness_matrix(d_spmatrix &damp_mat) {
-    this->damp_mat = &damp_mat;
+    this->damp_mat =
+        std::shared_ptr<d_spmatrix>(&damp_mat, [](d_spmatrix *) {});
 }
 void simulation::load_stiffness_matrix(d_spmatrix &stiff_mat) {
-    this->stiff_mat = &stiff_mat;
+    this->stiff_mat =
+        std::shared_ptr<d_spmatrix>(&stiff_mat, [](d_spmatrix *) {});
+}
+void simulation::load_dampness_matrix(std::shared_ptr<d_spmatrix> damp_mat) {
+    this->damp_mat = damp_mat;
+}
+void simulation::load_stiffness_matrix(std::shared_ptr<d_spmatrix> stiff_mat) {
+    this->stiff_mat = stiff_mat;
 }
 
 __global__ void PruneK(d_vector **state, int size) {
@@ -109,25 +204,91 @@ void simulation::prune_under(T value) {
         vect.prune_under(value);
 }
 
+__global__ void drain_activeK(d_vector **state, int nSpecies, T drainXdt,
+                              const int *nodes, int nNodes) {
+    int k = threadIdx.x + blockIdx.x * blockDim.x;
+    if (k >= nNodes)
+        return;
+    int i = nodes[k];
+    for (int s = 0; s < nSpecies; s++) {
+        T value = state[s]->data[i] - drainXdt;
+        state[s]->data[i] = (value < 0) ? 0 : value;
+    }
+}
+
+void simulation::drain_nodes(T drainXdt, const int *nodes, int nNodes) {
+    if (nNodes == 0)
+        return;
+    auto tb = make1DThreadBlock(nNodes);
+    drain_activeK<<<tb.block, tb.thread>>>(current_state.get_device_data().data,
+                                           current_state.n_species(), drainXdt,
+                                           nodes, nNodes);
+    gpuErrchk(cudaPeekAtLastError());
+}
+
+// Active nodes of the reaction step, null for all of them. A reaction without
+// reagents is active everywhere.
+const int *simulation::active_nodes(int &nNodes) {
+    nNodes = current_state.size();
+    if (!use_active_set || integrator == adaptive_rk23)
+        return nullptr;
+    for (auto &reaction : reactions)
+        if (reaction.Holder.Reagents.empty())
+            return nullptr;
+    for (auto &reaction : kinetic_reactions)
+        if (!reaction.vanishes_at_zero())
+            return nullptr;
+    bool dilate = stiff_mat && stiff_mat->type == CSR &&
+                  stiff_mat->rows == current_state.size();
+    active.update(current_state, (dilate) ? stiff_mat.get() : nullptr,
+                  active_threshold);
+    if (active.n_active > active_fallback * current_state.size())
+        return nullptr;
+    nNodes = active.n_active;
+    return active.nodes.data;
+}
+
 void simulation::iterate_reaction(T dt) {
 #ifndef NDEBUG_PROFILING
     profiler.start("Reaction");
 #endif
+    int nNodes;
+    const int *nodes = active_nodes(nNodes);
+    last_active_nodes = nNodes;
+
+    // With the active set, the drain goes over the active nodes and the
+    // nodes that just left the set, which it brings to their final values
     T drainXdt = drain * dt;
-    auto drainLambda = [drainXdt] __device__(T & x) { x -= drainXdt; };
-    for (auto &species : current_state.vector_holder) {
-        apply_func(species, drainLambda);
-        species.prune();
-    }
-    auto tb = make1DThreadBlock(current_state.size());
-    for (auto &reaction : reactions) {
-        compute_reactionK<<<tb.block, tb.thread>>>(
-            *current_state.get_device_data()._device, dt, *reaction._device);
+    if (nodes) {
+        drain_nodes(drainXdt, nodes, nNodes);
+        drain_nodes(drainXdt, active.left.data, active.n_left);
+    } else {
+        auto drainLambda = [drainXdt] __device__(T & x) { x -= drainXdt; };
+        for (auto &species : current_state.vector_holder) {
+            apply_func(species, drainLambda);
+            species.prune();
+        }
     }
-    for (auto &reaction : this->mmreactions) {
-        compute_reactionK<<<tb.block, tb.thread>>>(
-            *current_state.get_device_data()._device, dt, *reaction._device);
+    if (nNodes == 0) {
+#ifndef NDEBUG_PROFILING
+        profiler.end();
+#endif
+        return;
     }
+    if (network.n_reactions != reactions.size() + mmreactions.size() +
+                                   kinetic_reactions.size() ||
+        network.n_species != current_state.n_species())
+        network.compile(current_state, reactions, mmreactions,
+                        kinetic_reactions);
+    if (integrator == explicit_euler)
+        network.integrate_explicit(current_state, dt, nodes, nNodes);
+    else if (integrator == adaptive_rk23)
+        network.integrate_adaptive(current_state, dt, adaptive_rtol,
+                                   adaptive_atol, adaptive_max_substeps);
+    else
+        network.integrate(current_state, dt,
+                          (integrator == backward_euler) ? newton_max_iter : 1,
+                          newton_tolerance, nodes, nNodes);
 #ifndef NDEBUG_PROFILING
     profiler.end();
 #endif
@@ -148,7 +309,24 @@ bool simulation::iterate_diffusion(T dt) {
         hd_data<T> m(-dt);
         matrix_sum(*damp_mat, *stiff_mat, m(true), diffusion_matrix);
         last_used_dt = dt;
+        // The deflation vectors and the multigrid hierarchy belong to the
+        // previous matrix, and the increments of the predictors to the
+        // previous time step
+        deflation.n_max = 0;
+        amg.reset();
+        predictors.clear();
     }
+    if (use_amg && !amg)
+        amg = std::make_unique<amg_preconditioner>(diffusion_matrix);
+    solver.preconditioner = (use_amg) ? amg.get() : nullptr;
+    int nDeflation = (use_amg) ? 0
+                               : std::min(std::max(deflation_vectors, 0),
+                                          DEFLATION_MAX_VECTORS);
+    if (deflation.n_max != nDeflation || deflation.n != current_state.size())
+        deflation.reset(current_state.size(), nDeflation,
+                        deflation_harvest_solves);
+    solver.deflation = (nDeflation > 0) ? &deflation : nullptr;
+    solver.relative_to_rhs = relative_to_rhs || predictor_order > 0;
     for (int i = 0; i < current_state.n_species(); i++) {
         auto &species = current_state.vector_holder.at(i);
         auto &option = current_state.options_holder.at(i);
@@ -162,9 +340,41 @@ bool simulation::iterate_diffusion(T dt) {
 #ifndef NDEBUG_PROFILING
         profiler.start("Diffusion");
 #endif
-        if (!solver.cg_solve(diffusion_matrix, b, species, epsilon)) {
-            printf("Warning: It did not converge at time %f\n", t);
-            species.print(20);
+        int unpredictedIter = -1;
+        if (predictor_order > 0) {
+            auto &speciesPredictor = predictor(i);
+            speciesPredictor.predict(species);
+            if (predictor_probe_every > 0 && speciesPredictor.n_stored > 0 &&
+                n_diffusion_steps % predictor_probe_every == 0)
+                unpredictedIter = probe_solve(speciesPredictor.start);
+        }
+        auto solveStart = std::chrono::steady_clock::now();
+        bool converged = solver.cg_solve(diffusion_matrix, b, species, epsilon);
+        if (converged && predictor_order > 0)
+            predictor(i).record(species);
+        if (unpredictedIter >= 0) {
+            predictor_probes++;
+            predictor_saved_iterations += unpredictedIter - solver.n_iter_last;
+        }
+
+        solve_record record;
+        record.step = n_diffusion_steps;
+        record.species = i;
+        record.n_iter = solver.n_iter_last;
+        record.residual0 = solver.residual0_last;
+        record.residual = solver.residual_last;
+        record.time = std::chrono::duration<double>(
+                          std::chrono::steady_clock::now() - solveStart)
+                          .count();
+        record.converged = converged;
+        record.n_iter_unpredicted = unpredictedIter;
+        telemetry.record(record);
+
+        if (!converged) {
+            n_diffusion_steps++;
+#ifndef NDEBUG_PROFILING
+            profiler.end();
+#endif
             return false;
         }
     }
@@ -173,9 +383,50 @@ bool simulation::iterate_diffusion(T dt) {
 #endif
 
     t += dt;
+    n_diffusion_steps++;
     return true;
 }
 
+solution_predictor &simulation::predictor(int species) {
+    if (predictors.size() < current_state.n_species())
+        predictors.resize(current_state.n_species());
+    int order = std::min(predictor_order, 3);
+    auto &speciesPredictor = predictors.at(species);
+    if (!speciesPredictor || speciesPredictor->order != order)
+        speciesPredictor = std::make_unique<solution_predictor>(
+            current_state.size(), order);
+    return *speciesPredictor;
+}
+
+int simulation::probe_solve(d_vector &guess) {
+    if (probe.n != guess.n)
+        probe.resize(guess.n);
+    gpuErrchk(cudaMemcpy(probe.data, guess.data, sizeof(T) * guess.n,
+                         cudaMemcpyDeviceToDevice));
+    // The probe is deflated like the solve, but does not harvest
+    solver.cg_solve(diffusion_matrix, b, probe, epsilon, "", false);
+    return solver.n_iter_last;
+}
+
+bool simulation::iterate(T dt) {
+    if (!iterate_diffusion(dt))
+        return false;
+    iterate_reaction(dt);
+    return true;
+}
+
+int simulation::run(T dt, int nSteps, int observeEvery, observer observe) {
+    for (int step = 1; step <= nSteps; step++) {
+        if (!iterate(dt))
+            return step - 1;
+        bool observed = step == nSteps ||
+                        (observeEvery > 0 && step % observeEvery == 0);
+        if (observe && observed && !observe(*this, step))
+            return step;
+    }
+    return std::max(nSteps, 0);
+}
+
 void simulation::print(int printCount) {
     current_state.print(printCount);
     for (auto &reaction : reactions) {
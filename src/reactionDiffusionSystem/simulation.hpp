@@ -1,5 +1,7 @@
 #pragma once
 
+#include <functional>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -7,8 +9,14 @@
 #include "dataStructures/hd_data.hpp"
 #include "dataStructures/sparse_matrix.hpp"
 #include "matrixOperations/basic_operations.hpp"
+#include "active_set.hpp"
 #include "reaction.hpp"
+#include "reaction_network.hpp"
+#include "solvers/amg_preconditioner.hpp"
 #include "solvers/conjugate_gradient_solver.hpp"
+#include "solvers/deflation_space.hpp"
+#include "solvers/solution_predictor.hpp"
+#include "solvers/solver_telemetry.hpp"
 #include "state.hpp"
 
 // A top-level class that handles the operations for the reaction-diffusion
@@ -28,11 +36,43 @@ class simulation {
     // The set of Michaelis-Menten Reactions
     std::vector<reaction_michaelis_menten> mmreactions;
 
-    // Diffusion matrices
-    d_spmatrix *damp_mat = nullptr;
-    d_spmatrix *stiff_mat = nullptr;
+    // Reactions of other kinetics (e.g. Hill), as rate programs
+    std::vector<kinetic_reaction> kinetic_reactions;
+
+    // Diffusion matrices. The damping and stiffness matrices are only read,
+    // so they can be shared by several simulations.
+    std::shared_ptr<d_spmatrix> damp_mat;
+    std::shared_ptr<d_spmatrix> stiff_mat;
     d_spmatrix diffusion_matrix;
 
+    // Integration of the reactions. The reactions are compiled to a network,
+    // which is rebuilt when reactions or species are added.
+    reaction_integrator integrator = explicit_euler;
+    int newton_max_iter = 8;
+    T newton_tolerance = 1e-8;
+    T adaptive_rtol = 1e-4;
+    T adaptive_atol = 1e-12;
+    int adaptive_max_substeps = 1000;
+    reaction_network network;
+
+    // Only the active nodes go through the reaction step (see active_set):
+    // the nodes where a species exceeds active_threshold, and their
+    // neighbors in the stiffness matrix. All the nodes do when more than the
+    // fraction active_fallback of them are active. The drain is applied to
+    // the active nodes and to the nodes that left the set during the step,
+    // so the cost of the step follows the set (the update of the set still
+    // reads every node once). With the default threshold (0) the skipped
+    // nodes have no positive species and the result is the one of a full
+    // sweep, except that their negative values are only pruned when they
+    // leave the set; a positive threshold ignores the reactions and the drain
+    // of the nodes below it, an approximation. Not used by adaptive_rk23.
+    bool use_active_set = false;
+    T active_threshold = 0;
+    T active_fallback = 0.5;
+    active_set active;
+    // Number of nodes of the last reaction step
+    int last_active_nodes = 0;
+
     // Parameters
     T epsilon = 1e-3;
     T last_used_dt = 0;
@@ -40,10 +80,49 @@ class simulation {
 
     // Enlapsed time
     T t = 0;
+    // Number of diffusion steps performed
+    int n_diffusion_steps = 0;
+
+    // Outcome of the most recent conjugate gradient solves
+    solver_telemetry telemetry;
+
+    // Tolerance of the diffusion solves relative to the norm of the
+    // right-hand side rather than of the initial residual (see
+    // cg_solver::relative_to_rhs). Meant for warm starts: a good guess makes
+    // the initial residual, and so the relative tolerance, tiny. Always on
+    // with a predictor.
+    bool relative_to_rhs = false;
+    // Warm start of the diffusion solves from the increments of the last
+    // predictor_order solves of each species (see solution_predictor), 0 to
+    // disable. Predictions are dropped when dt changes. The tolerance is then
+    // relative to the right-hand side, otherwise a better guess would only
+    // tighten it and save no iterations.
+    int predictor_order = 0;
+    // Every predictor_probe_every diffusion steps, the predicted solves are
+    // also made from the unpredicted guess to measure the iterations saved
+    // (0: never)
+    int predictor_probe_every = 0;
+    long predictor_probes = 0;
+    long predictor_saved_iterations = 0;
+
+    // Deflated diffusion solves (see deflation_space), 0 to disable,
+    // at most DEFLATION_MAX_VECTORS. The deflation vectors are harvested
+    // from the first deflation_harvest_solves solves after the diffusion
+    // matrix is built, and shared by the species.
+    int deflation_vectors = 0;
+    int deflation_harvest_solves = 8;
+    deflation_space deflation;
+
+    // Diffusion solves preconditioned by algebraic multigrid (see
+    // amg_preconditioner). The hierarchy is built from the diffusion matrix
+    // when it is built, and shared by the species. Deflation is not used
+    // with it.
+    bool use_amg = false;
+    std::unique_ptr<amg_preconditioner> amg;
 
 #ifndef NDEBUG_PROFILING
     // Profiler
-    chrono_profiler profiler;
+    chrono_profiler profiler{"simulation"};
 #endif
 
     // Give as input the size of the concentration vectors
@@ -60,16 +139,42 @@ class simulation {
     void add_mm_reaction(std::string reag, std::string prod, int kp, T Vm,
                          T Km);
     void add_mm_reaction(const std::string &reaction, T Vm, T Km);
-
-    // Get the memory location of the dampness and stiffness matrices
+    // Hill kinetics: the reagent, alone, reacts at the rate Vm u^n / (K^n +
+    // u^n)
+    void add_hill_reaction(const std::string &reaction, T Vm, T K, T n);
+    void add_hill_reaction(const reaction_holder &reaction, T Vm, T K, T n);
+
+    // Adds the species and reactions of a network in the text format of
+    // crn_loader.hpp, at once. Declared species that already exist are
+    // kept (their diffusion must match), the new ones start at their value
+    // or 0. Nothing is added if the text or a species is invalid. Returns
+    // the number of reactions added.
+    int load_crn(const std::string &text);
+
+    // Get the memory location of the dampness and stiffness matrices. The
+    // references must outlive the simulation, the shared pointers are kept.
     void load_dampness_matrix(d_spmatrix &damp_mat);
     void load_stiffness_matrix(d_spmatrix &stiff_mat);
+    void load_dampness_matrix(std::shared_ptr<d_spmatrix> damp_mat);
+    void load_stiffness_matrix(std::shared_ptr<d_spmatrix> stiff_mat);
 
     // Make one iteration of either rection or diffusion, for the given timestep
     // Note: For optimal speed, you need to do the diffusion iterations with the
     // same time-step
     void iterate_reaction(T dt);
     bool iterate_diffusion(T dt);
+    // One diffusion step followed by one reaction step. Returns false if the
+    // diffusion did not converge; the failed solve is the last record of
+    // telemetry.
+    bool iterate(T dt);
+
+    // Called with the number of steps done, the run stops if it returns false
+    typedef std::function<bool(simulation &, int)> observer;
+    // Makes nSteps iterations, calls observe every observeEvery steps and
+    // after the last one (only after the last one if observeEvery <= 0).
+    // Returns the number of steps done, fewer if the diffusion did not
+    // converge or the observer stopped the run.
+    int run(T dt, int nSteps, int observeEvery = 0, observer observe = nullptr);
     void prune(T value = 0);
     void prune_under(T value = 1);
 
@@ -78,4 +183,14 @@ class simulation {
     void SetDrain(T drain);
 
     void print(int = 5);
+
+  private:
+    std::vector<std::unique_ptr<solution_predictor>> predictors;
+    d_vector probe;
+
+    const int *active_nodes(int &nNodes);
+    void drain_nodes(T drainXdt, const int *nodes, int nNodes);
+    solution_predictor &predictor(int species);
+    // Iterations of the solve from guess
+    int probe_solve(d_vector &guess);
 };
\ No newline at end of file
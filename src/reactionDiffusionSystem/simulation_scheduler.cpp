@@ -0,0 +1,27 @@
+#include <cuda_runtime.h>
+
+#include "simulation_scheduler.hpp"
+#include "helper/cuda/cuda_error_check.h"
+#include "helper/cuda/numa_host_memory.hpp"
+#include "helper/thread_pool.hpp"
+
+std::vector<int> run_simulations(std::vector<simulation *> &simulations, T dt,
+                                 int nSteps, int nThreads) {
+    std::vector<int> nDone(simulations.size(), 0);
+    // The workers drive the device from the CPUs of its NUMA node
+    int device = 0;
+    gpuErrchk(cudaGetDevice(&device));
+    auto cpus = device_local_cpus(device);
+    thread_pool pool(nThreads);
+    for (int k = 0; k < simulations.size(); k++) {
+        simulation *simu = simulations[k];
+        int *done = &nDone[k];
+        pool.submit([simu, done, dt, nSteps, device, &cpus]() {
+            gpuErrchk(cudaSetDevice(device));
+            cpu_binding binding(cpus);
+            *done = simu->run(dt, nSteps);
+        });
+    }
+    pool.wait();
+    return nDone;
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <vector>
+
+#include "constants.hpp"
+#include "simulation.hpp"
+
+// Runs nSteps iterations (see simulation::iterate) of each simulation. The
+// simulations are jobs of a work-stealing thread pool of nThreads threads (0:
+// one per hardware thread), and each thread uses its own library context
+// and stream (see cuda_context). The simulations must be independent, but
+// they may share their damping and stiffness matrices.
+// A simulation stops at its first diffusion step that does not converge.
+// Returns, for each simulation, the number of steps performed.
+std::vector<int> run_simulations(std::vector<simulation *> &simulations, T dt,
+                                 int nSteps, int nThreads = 0);
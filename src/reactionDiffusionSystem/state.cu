@@ -1,6 +1,7 @@
 #include <stdio.h>
 
 #include "helper/cuda/cuda_error_check.h"
+#include "helper/cuda/numa_host_memory.hpp"
 #include "state.hpp"
 
 state::state(int size) : vector_size(size) {}
@@ -69,4 +70,53 @@ void state::print(int i) {
 
 state::~state() {}
 
-species_options::species_options(bool diffusion) : diffusion(diffusion) {}
\ No newline at end of file
+species_options::species_options(bool diffusion) : diffusion(diffusion) {}
+state_block::state_block(state &source)
+    : n_species(source.n_species()), vector_size(source.size()),
+      species_names(source.n_species()) {
+    for (auto &name : source.names)
+        species_names.at(name.second) = name.first;
+    if (n_species * vector_size > 0)
+        data = (T *)numa_host_alloc(sizeof(T) * n_species * vector_size);
+    pull(source);
+}
+
+state_block::~state_block() {
+    numa_host_free(data);
+}
+
+int state_block::species_index(std::string name) const {
+    for (int s = 0; s < n_species; s++)
+        if (species_names[s] == name)
+            return s;
+    std::cout << "\"" << name << "\"\n";
+    throw std::invalid_argument("^ This species is invalid\n");
+}
+
+T *state_block::species(int s) { return data + (size_t)s * vector_size; }
+
+void state_block::check_layout(state &other) const {
+    if (other.n_species() != n_species || other.size() != vector_size)
+        throw std::invalid_argument(
+            "The state does not have the layout of the block\n");
+}
+
+// The block is page-locked: the copies of all the species are queued on the
+// stream of the thread and waited for once
+void state_block::pull(state &source) {
+    check_layout(source);
+    for (int s = 0; s < n_species; s++)
+        gpuErrchk(cudaMemcpyAsync(species(s), source.vector_holder[s].data,
+                                  sizeof(T) * vector_size, cudaMemcpyDefault,
+                                  cudaStreamPerThread));
+    gpuErrchk(cudaStreamSynchronize(cudaStreamPerThread));
+}
+
+void state_block::push(state &target) {
+    check_layout(target);
+    for (int s = 0; s < n_species; s++)
+        gpuErrchk(cudaMemcpyAsync(target.vector_holder[s].data, species(s),
+                                  sizeof(T) * vector_size, cudaMemcpyDefault,
+                                  cudaStreamPerThread));
+    gpuErrchk(cudaStreamSynchronize(cudaStreamPerThread));
+}
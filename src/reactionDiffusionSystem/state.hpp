@@ -1,6 +1,7 @@
 #pragma once
 
 #include <map>
+#include <string>
 #include <vector>
 
 #include "constants.hpp"
@@ -49,3 +50,34 @@ class state {
     d_array<d_vector *> device_data;
     void update_device_data();
 };
+
+// Host copy of all the species of a state in one contiguous page-locked
+// block, species after species in the order of their index: species s is
+// data[s * vector_size, (s + 1) * vector_size). Python sees the block as a
+// (n_species, vector_size) array without copying.
+class state_block {
+  public:
+    int n_species;
+    int vector_size;
+    // Name of each species, by index
+    std::vector<std::string> species_names;
+    T *data = nullptr;
+
+    // Allocates a block with the layout of the state and pulls it
+    state_block(state &);
+    state_block(const state_block &) = delete;
+    void operator=(const state_block &) = delete;
+    ~state_block();
+
+    // Index of the species in the block, throws if it is not found
+    int species_index(std::string name) const;
+    T *species(int s);
+
+    // Copies the species of the state into the block
+    void pull(state &);
+    // Copies the block into the species of the state
+    void push(state &);
+
+  private:
+    void check_layout(state &) const;
+};
@@ -0,0 +1,145 @@
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+
+#include "helper/cuda/cuda_error_check.h"
+#include "state_read_write.hpp"
+
+namespace {
+
+const char state_magic[4] = {'A', 'R', 'D', 'S'};
+const int32_t state_version = 1;
+
+struct state_header {
+    char magic[4];
+    int32_t version;
+    int32_t scalar_size;
+    int32_t n_species;
+    int64_t n_nodes;
+    int64_t n_global_nodes;
+};
+static_assert(sizeof(state_header) == 32, "Unexpected state header layout");
+
+[[noreturn]] void state_error(const std::string &path,
+                              const std::string &message) {
+    throw std::runtime_error("State file " + path + ": " + message);
+}
+
+struct file_closer {
+    void operator()(FILE *file) { fclose(file); }
+};
+typedef std::unique_ptr<FILE, file_closer> file_ptr;
+
+file_ptr open_file(const std::string &path, const char *mode) {
+    file_ptr file(fopen(path.c_str(), mode));
+    if (!file)
+        state_error(path, std::string("cannot open the file (") +
+                              strerror(errno) + ")");
+    return file;
+}
+
+void read_values(const std::string &path, FILE *file, void *data,
+                 size_t size, size_t n) {
+    if (fread(data, size, n, file) != n)
+        state_error(path, "unexpected end of file");
+}
+
+} // namespace
+
+void write_state_snapshot(state &state, const std::string &path,
+                          const std::vector<int> &globalIndex,
+                          int nGlobalNodes) {
+    int n = state.size();
+    state_snapshot snapshot;
+    snapshot.names.resize(state.n_species());
+    for (auto &name : state.names)
+        snapshot.names.at(name.second) = name.first;
+    for (auto &option : state.options_holder)
+        snapshot.diffusion.push_back(option.diffusion);
+    snapshot.global_index = globalIndex;
+    if (globalIndex.empty())
+        for (int i = 0; i < n; i++)
+            snapshot.global_index.push_back(i);
+    snapshot.n_global_nodes = (nGlobalNodes < 0) ? n : nGlobalNodes;
+    snapshot.values.resize((size_t)state.n_species() * n);
+    for (int s = 0; s < state.n_species(); s++)
+        gpuErrchk(cudaMemcpy(snapshot.values.data() + (size_t)s * n,
+                             state.vector_holder[s].data, sizeof(T) * n,
+                             cudaMemcpyDefault));
+    write_state_snapshot(snapshot, path);
+}
+
+void write_state_snapshot(const state_snapshot &snapshot,
+                          const std::string &path) {
+    size_t n = snapshot.global_index.size();
+    if (snapshot.diffusion.size() != snapshot.names.size() ||
+        snapshot.values.size() != snapshot.names.size() * n)
+        throw std::invalid_argument("The snapshot is not consistent\n");
+    auto file = open_file(path, "wb");
+    state_header header;
+    memcpy(header.magic, state_magic, sizeof(state_magic));
+    header.version = state_version;
+    header.scalar_size = sizeof(T);
+    header.n_species = snapshot.names.size();
+    header.n_nodes = n;
+    header.n_global_nodes = snapshot.n_global_nodes;
+    fwrite(&header, sizeof(header), 1, file.get());
+    for (size_t s = 0; s < snapshot.names.size(); s++) {
+        int32_t length = snapshot.names[s].size();
+        int32_t diffusion = snapshot.diffusion[s];
+        fwrite(&length, sizeof(length), 1, file.get());
+        fwrite(snapshot.names[s].data(), 1, length, file.get());
+        fwrite(&diffusion, sizeof(diffusion), 1, file.get());
+    }
+    fwrite(snapshot.global_index.data(), sizeof(int), n, file.get());
+    fwrite(snapshot.values.data(), sizeof(T), snapshot.values.size(),
+           file.get());
+    if (ferror(file.get()))
+        state_error(path, "write error");
+}
+
+state_snapshot read_state_snapshot(const std::string &path) {
+    auto file = open_file(path, "rb");
+    state_header header;
+    if (fread(&header, sizeof(header), 1, file.get()) != 1)
+        state_error(path, "truncated header");
+    if (memcmp(header.magic, state_magic, sizeof(state_magic)) != 0)
+        state_error(path, "not a state snapshot");
+    if (header.version != state_version)
+        state_error(path, "unsupported version " +
+                              std::to_string(header.version));
+    if (header.scalar_size != sizeof(T))
+        state_error(path, "invalid scalar size");
+    if (header.n_species < 0 || header.n_nodes < 0 ||
+        header.n_nodes > header.n_global_nodes ||
+        header.n_global_nodes > std::numeric_limits<int>::max())
+        state_error(path, "invalid number of species or nodes");
+
+    state_snapshot snapshot;
+    snapshot.n_global_nodes = header.n_global_nodes;
+    for (int s = 0; s < header.n_species; s++) {
+        int32_t length, diffusion;
+        read_values(path, file.get(), &length, sizeof(length), 1);
+        if (length < 0 || length > 4096)
+            state_error(path, "invalid species name");
+        std::string name(length, '\0');
+        read_values(path, file.get(), &name[0], 1, length);
+        read_values(path, file.get(), &diffusion, sizeof(diffusion), 1);
+        snapshot.names.push_back(name);
+        snapshot.diffusion.push_back(diffusion != 0);
+    }
+    snapshot.global_index.resize(header.n_nodes);
+    read_values(path, file.get(), snapshot.global_index.data(), sizeof(int),
+                header.n_nodes);
+    for (int i : snapshot.global_index)
+        if (i < 0 || i >= header.n_global_nodes)
+            state_error(path, "node index out of range");
+    snapshot.values.resize((size_t)header.n_species * header.n_nodes);
+    read_values(path, file.get(), snapshot.values.data(), sizeof(T),
+                snapshot.values.size());
+    return snapshot;
+}
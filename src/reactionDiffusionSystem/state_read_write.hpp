@@ -0,0 +1,37 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "constants.hpp"
+#include "state.hpp"
+
+// Binary snapshot of the species of a state (little endian): the magic
+// "ARDS", int32 version, int32 size of a scalar (4 or 8), int32 number of
+// species, int64 number of nodes, int64 number of nodes of the whole domain,
+// then for each species in the order of their index its int32 name length,
+// name and int32 diffusion flag, then the int32 index in the whole domain of
+// each node, and the values, species after species.
+//
+// A state that holds a part of a domain (e.g. the nodes of one rank of a
+// distributed simulation) is written with the global index of its nodes, so
+// that the snapshots of the parts can be merged. Otherwise the nodes are the
+// whole domain, in order.
+// Errors are reported by throwing std::runtime_error.
+
+struct state_snapshot {
+    int n_global_nodes = 0;
+    std::vector<std::string> names;
+    std::vector<bool> diffusion;
+    std::vector<int> global_index;
+    // Species after species, global_index.size() values each
+    std::vector<T> values;
+};
+
+void write_state_snapshot(state &state, const std::string &path,
+                          const std::vector<int> &globalIndex = {},
+                          int nGlobalNodes = -1);
+void write_state_snapshot(const state_snapshot &snapshot,
+                          const std::string &path);
+
+state_snapshot read_state_snapshot(const std::string &path);
@@ -0,0 +1,252 @@
+#include <algorithm>
+#include <assert.h>
+#include <cmath>
+#include <cstdio>
+#include <stdexcept>
+
+#include "amg_preconditioner.hpp"
+#include "helper/cuda/cuda_error_check.h"
+#include "helper/cuda/cuda_thread_manager.hpp"
+#include "helper/dense_linear_algebra.hpp"
+#include "matrixOperations/basic_operations.hpp"
+
+// x = w b, the first sweep from x = 0
+__global__ void jacobi_startK(int n, const T *weights, const T *b, T *x) {
+    int i = threadIdx.x + blockIdx.x * blockDim.x;
+    if (i >= n)
+        return;
+    x[i] = weights[i] * b[i];
+}
+
+// x += w (b - Ax)
+__global__ void jacobi_stepK(int n, const T *weights, const T *b, const T *Ax,
+                             T *x) {
+    int i = threadIdx.x + blockIdx.x * blockDim.x;
+    if (i >= n)
+        return;
+    x[i] += weights[i] * (b[i] - Ax[i]);
+}
+
+// Groups the nodes in aggregates of strongly connected nodes (a_ij^2 >
+// strength^2 a_ii a_jj), in the three passes of Vanek, Mandel and Brezina:
+// the nodes whose strong neighbors are all free form an aggregate with them,
+// the nodes left join the aggregate of their strongest neighbor, and the
+// nodes still left form aggregates with their free strong neighbors.
+// Returns the number of aggregates.
+static int aggregate(const d_spmatrix &A, const std::vector<T> &diag,
+                     T strength, std::vector<int> &agg) {
+    int n = A.rows;
+    auto strong = [&](int i, int k) {
+        int j = A.colPtr[k];
+        return j != i && A.data[k] * A.data[k] >
+                             strength * strength * std::abs(diag[i] * diag[j]);
+    };
+    agg.assign(n, -1);
+    int nAgg = 0;
+    for (int i = 0; i < n; i++) {
+        if (agg[i] != -1)
+            continue;
+        bool free = true;
+        for (int k = A.rowPtr[i]; k < A.rowPtr[i + 1] && free; k++)
+            free = !strong(i, k) || agg[A.colPtr[k]] == -1;
+        if (!free)
+            continue;
+        agg[i] = nAgg;
+        for (int k = A.rowPtr[i]; k < A.rowPtr[i + 1]; k++)
+            if (strong(i, k))
+                agg[A.colPtr[k]] = nAgg;
+        nAgg++;
+    }
+    std::vector<int> first = agg;
+    for (int i = 0; i < n; i++) {
+        if (agg[i] != -1)
+            continue;
+        T strongest = 0;
+        for (int k = A.rowPtr[i]; k < A.rowPtr[i + 1]; k++)
+            if (strong(i, k) && first[A.colPtr[k]] != -1 &&
+                std::abs(A.data[k]) > strongest) {
+                strongest = std::abs(A.data[k]);
+                agg[i] = first[A.colPtr[k]];
+            }
+    }
+    for (int i = 0; i < n; i++) {
+        if (agg[i] != -1)
+            continue;
+        agg[i] = nAgg;
+        for (int k = A.rowPtr[i]; k < A.rowPtr[i + 1]; k++)
+            if (strong(i, k) && agg[A.colPtr[k]] == -1)
+                agg[A.colPtr[k]] = nAgg;
+        nAgg++;
+    }
+    return nAgg;
+}
+
+amg_preconditioner::amg_preconditioner(d_spmatrix &mat, T strength)
+    : one(1.0), minus_one(-1.0) {
+    if (!mat.is_device)
+        throw std::invalid_argument(
+            "The AMG preconditioner needs a device matrix\n");
+    if (mat.type != CSR)
+        throw std::invalid_argument(
+            "The AMG preconditioner needs a CSR matrix\n");
+    if (mat.rows != mat.cols)
+        throw std::invalid_argument(
+            "The AMG preconditioner needs a square matrix\n");
+    levels.push_back(std::make_unique<level>(mat.rows));
+    levels.back()->A = &mat;
+    for (int l = 0;; l++) {
+        level &lvl = *levels.back();
+        d_spmatrix *A = lvl.A;
+        int n = A->rows;
+
+        d_spmatrix host(*A, true);
+        std::vector<T> diag(n, 0);
+        for (int i = 0; i < n; i++)
+            for (int k = host.rowPtr[i]; k < host.rowPtr[i + 1]; k++)
+                if (host.colPtr[k] == i)
+                    diag[i] += host.data[k];
+        // Gershgorin bound of the spectral radius of D^-1 A
+        T rho = 0;
+        for (int i = 0; i < n; i++) {
+            if (!(diag[i] > 0))
+                throw std::invalid_argument(
+                    "The matrix must have a positive diagonal\n");
+            T sum = 0;
+            for (int k = host.rowPtr[i]; k < host.rowPtr[i + 1]; k++)
+                sum += std::abs(host.data[k]);
+            rho = std::max(rho, sum / diag[i]);
+        }
+        T omega = 4.0 / (3.0 * rho);
+        std::vector<T> weights(n);
+        for (int i = 0; i < n; i++)
+            weights[i] = omega / diag[i];
+        gpuErrchk(cudaMemcpy(lvl.weights.data, weights.data(), sizeof(T) * n,
+                             cudaMemcpyHostToDevice));
+
+        std::vector<int> agg;
+        int nAgg = (n > AMG_COARSE_SIZE && l + 1 < AMG_MAX_LEVELS)
+                       ? aggregate(host, diag, strength, agg)
+                       : n;
+        if (5 * (long long)nAgg > 4 * (long long)n) {
+            // Coarsest level. It is only smoothed when it is still large: the
+            // aggregation stalls when few nodes are strongly coupled (e.g. a
+            // tiny time step), and the matrix is then well conditioned.
+            if (n > AMG_COARSE_SIZE)
+                break;
+            coarse_factor.assign(n * n, 0);
+            for (int i = 0; i < n; i++)
+                for (int k = host.rowPtr[i]; k < host.rowPtr[i + 1]; k++)
+                    coarse_factor[i * n + host.colPtr[k]] += host.data[k];
+            if (!cholesky(coarse_factor, n))
+                throw std::invalid_argument(
+                    "The matrix is not positive definite\n");
+            coarse_values.resize(n);
+            break;
+        }
+
+        // Jacobi smoothing of the prolongator, S = I - w D^-1 A, on the
+        // pattern of A
+        d_spmatrix S(n, n, host.nnz, CSR, false);
+        for (int i = 0; i <= n; i++)
+            S.rowPtr[i] = host.rowPtr[i];
+        for (int k = 0; k < host.nnz; k++)
+            S.colPtr[k] = host.colPtr[k];
+        for (int i = 0; i < n; i++)
+            for (int k = host.rowPtr[i]; k < host.rowPtr[i + 1]; k++)
+                S.data[k] = ((host.colPtr[k] == i) ? 1 : 0) -
+                            omega * host.data[k] / diag[i];
+        // Tentative prolongator, the normalized constant on each aggregate
+        std::vector<int> aggSize(nAgg, 0);
+        for (int i = 0; i < n; i++)
+            aggSize[agg[i]]++;
+        d_spmatrix P0(n, nAgg, n, CSR, false);
+        for (int i = 0; i < n; i++) {
+            P0.rowPtr[i] = i;
+            P0.colPtr[i] = agg[i];
+            P0.data[i] = 1 / sqrt((T)aggSize[agg[i]]);
+        }
+        P0.rowPtr[n] = n;
+
+        d_spmatrix deviceS(S, true), deviceP0(P0, true), AP;
+        matrix_product(deviceS, deviceP0, lvl.P);
+        transpose(lvl.P, lvl.R);
+        matrix_product(*A, lvl.P, AP);
+        auto next = std::make_unique<level>(nAgg);
+        matrix_product(lvl.R, AP, next->coarse_matrix);
+        next->A = &next->coarse_matrix;
+        levels.push_back(std::move(next));
+    }
+}
+
+std::vector<int> amg_preconditioner::level_rows() const {
+    std::vector<int> rows;
+    for (auto &lvl : levels)
+        rows.push_back(lvl->A->rows);
+    return rows;
+}
+
+std::vector<int> amg_preconditioner::level_nnz() const {
+    std::vector<int> nnz;
+    for (auto &lvl : levels)
+        nnz.push_back(lvl->A->nnz);
+    return nnz;
+}
+
+T amg_preconditioner::operator_complexity() const {
+    T total = 0;
+    for (auto &lvl : levels)
+        total += lvl->A->nnz;
+    return total / levels.front()->A->nnz;
+}
+
+void amg_preconditioner::smooth(level &lvl, int nSteps, bool fromZero) {
+    int n = lvl.b.n;
+    auto tb = make1DThreadBlock(n);
+    for (int s = 0; s < nSteps; s++) {
+        if (s == 0 && fromZero) {
+            jacobi_startK<<<tb.block, tb.thread>>>(n, lvl.weights.data,
+                                                   lvl.b.data, lvl.x.data);
+        } else {
+            dot(*lvl.A, lvl.x, lvl.r, false);
+            jacobi_stepK<<<tb.block, tb.thread>>>(
+                n, lvl.weights.data, lvl.b.data, lvl.r.data, lvl.x.data);
+        }
+        gpuErrchk(cudaPeekAtLastError());
+    }
+}
+
+void amg_preconditioner::cycle(int l) {
+    level &lvl = *levels[l];
+    if (l + 1 == n_levels() && coarse_factor.empty()) {
+        smooth(lvl, 2 * smoothing_steps, true);
+        return;
+    }
+    if (l + 1 == n_levels()) {
+        int n = lvl.b.n;
+        gpuErrchk(cudaMemcpy(coarse_values.data(), lvl.b.data, sizeof(T) * n,
+                             cudaMemcpyDeviceToHost));
+        cholesky_solve(coarse_factor, n, coarse_values.data());
+        gpuErrchk(cudaMemcpy(lvl.x.data, coarse_values.data(), sizeof(T) * n,
+                             cudaMemcpyHostToDevice));
+        return;
+    }
+    level &next = *levels[l + 1];
+    smooth(lvl, smoothing_steps, true);
+    dot(*lvl.A, lvl.x, lvl.r, false);
+    vector_sum(lvl.b, lvl.r, minus_one(true), lvl.r, false);
+    dot(lvl.R, lvl.r, next.b, false);
+    cycle(l + 1);
+    dot(lvl.P, next.x, lvl.r, false);
+    vector_sum(lvl.x, lvl.r, one(true), lvl.x, false);
+    smooth(lvl, smoothing_steps, false);
+}
+
+void amg_preconditioner::apply(d_vector &r, d_vector &z) {
+    level &finest = *levels.front();
+    assert(r.n == finest.b.n && z.n == finest.b.n);
+    gpuErrchk(cudaMemcpy(finest.b.data, r.data, sizeof(T) * r.n,
+                         cudaMemcpyDeviceToDevice));
+    cycle(0);
+    gpuErrchk(cudaMemcpy(z.data, finest.x.data, sizeof(T) * z.n,
+                         cudaMemcpyDeviceToDevice));
+}
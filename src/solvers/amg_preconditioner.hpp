@@ -0,0 +1,71 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "constants.hpp"
+#include "dataStructures/array.hpp"
+#include "dataStructures/hd_data.hpp"
+#include "dataStructures/sparse_matrix.hpp"
+
+// Levels of the hierarchy, at most
+#define AMG_MAX_LEVELS 10
+// The coarsest level is factorized once it has at most this many rows
+#define AMG_COARSE_SIZE 256
+
+// Smoothed aggregation algebraic multigrid, as a preconditioner of the
+// conjugate gradient (see cg_solver::preconditioner) for a symmetric positive
+// definite matrix such as the diffusion matrix.
+// Each level groups the strongly connected nodes of the finer one into
+// aggregates, the tentative prolongator P0 maps each aggregate to its nodes
+// (the constant vector, normalized), and the prolongator P = (I - w D^-1 A)
+// P0 smooths it with a damped Jacobi step. The coarse matrix is R A P with
+// R = P^T. The aggregation is done on the host, once; the products and
+// transposes run on the device (see matrix_product and transpose).
+// apply is one V-cycle, with damped Jacobi pre- and post-smoothing, and a
+// Cholesky solve on the host at the coarsest level. It is symmetric, so the
+// preconditioned conjugate gradient converges in a number of iterations that
+// barely grows with the size of the mesh.
+class amg_preconditioner {
+  public:
+    // Smoothing sweeps before and after the coarse correction
+    int smoothing_steps = 2;
+
+    // Builds the hierarchy of mat, which is kept by reference: it must
+    // outlive the preconditioner and not change. Throws
+    // std::invalid_argument if mat is not a square device CSR matrix
+    amg_preconditioner(d_spmatrix &mat, T strength = 0.08);
+    amg_preconditioner(const amg_preconditioner &) = delete;
+
+    // z = M^-1 r, r and z of the size of mat
+    void apply(d_vector &r, d_vector &z);
+
+    int n_levels() const { return (int)levels.size(); }
+    // Rows and non-zeros of the matrix of each level, the finest first
+    std::vector<int> level_rows() const;
+    std::vector<int> level_nnz() const;
+    // Sum of the non-zeros of all the levels over those of mat
+    T operator_complexity() const;
+
+  private:
+    struct level {
+        d_spmatrix *A; // mat at the finest level, coarse_matrix below
+        d_spmatrix coarse_matrix;
+        d_spmatrix P; // From the next level to this one, empty at the coarsest
+        d_spmatrix R;
+        d_vector weights; // Jacobi weights w / a_ii
+        d_vector b;
+        d_vector x;
+        d_vector r;
+        level(int n) : weights(n), b(n), x(n), r(n) {}
+    };
+    std::vector<std::unique_ptr<level>> levels;
+    // Cholesky factor of the coarsest matrix, empty if it is only smoothed
+    std::vector<T> coarse_factor;
+    std::vector<T> coarse_values;
+    hd_data<T> one;
+    hd_data<T> minus_one;
+
+    void smooth(level &lvl, int nSteps, bool fromZero);
+    void cycle(int l);
+};
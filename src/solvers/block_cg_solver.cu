@@ -0,0 +1,169 @@
+#include <algorithm>
+#include <assert.h>
+#include <cmath>
+#include <cstdio>
+
+#include "block_cg_solver.hpp"
+#include "helper/cuda/cuda_error_check.h"
+#include "helper/cuda/cuda_thread_manager.hpp"
+
+block_cg_solver::block_cg_solver(int n, int nColumns)
+    : n(n), n_columns(nColumns), q(n * nColumns), r(n * nColumns),
+      p(n * nColumns), alpha(nColumns), beta(nColumns), rr(nColumns),
+      rr0(nColumns), rr_next(nColumns), pq(nColumns), active(nColumns),
+      iterations(nColumns), n_active(1) {}
+
+// y[i] += sign * alpha[k] * x[i] on column k (alpha = 1 if null)
+__global__ void block_axpyK(T *y, const T *x, const T *alpha, T sign, int n,
+                            int nColumns) {
+    int i = threadIdx.x + blockIdx.x * blockDim.x;
+    if (i >= n * nColumns)
+        return;
+    y[i] += sign * ((alpha) ? alpha[i / n] : 1) * x[i];
+}
+
+// p[i] = r[i] + beta[k] * p[i] on column k
+__global__ void block_xpayK(T *p, const T *r, const T *beta, int n,
+                            int nColumns) {
+    int i = threadIdx.x + blockIdx.x * blockDim.x;
+    if (i >= n * nColumns)
+        return;
+    p[i] = r[i] + beta[i / n] * p[i];
+}
+
+// The scalars of the recurrences, one column after the other: there are only
+// a few columns, and they stay on the device between the vector kernels
+
+__global__ void block_startK(int nColumns, const T *rr, T *rr0, int *active,
+                             int *iterations, int *nActive, T epsilon) {
+    *nActive = 0;
+    for (int k = 0; k < nColumns; k++) {
+        rr0[k] = rr[k];
+        active[k] = rr[k] > epsilon * epsilon * rr0[k];
+        iterations[k] = 0;
+        *nActive += active[k];
+    }
+}
+
+// Converged columns are frozen with a zero step
+__global__ void block_alphaK(int nColumns, int iteration, const T *rr,
+                             const T *pq, int *active, int *iterations,
+                             T *alpha) {
+    for (int k = 0; k < nColumns; k++) {
+        alpha[k] = 0;
+        if (!active[k])
+            continue;
+        iterations[k] = iteration;
+        if (pq[k] != 0)
+            alpha[k] = rr[k] / pq[k];
+        else
+            active[k] = 0;
+    }
+}
+
+__global__ void block_betaK(int nColumns, const T *rrNext, const T *rr0,
+                            T *rr, int *active, int *nActive, T *beta,
+                            T epsilon) {
+    *nActive = 0;
+    for (int k = 0; k < nColumns; k++) {
+        beta[k] = 0;
+        if (active[k]) {
+            if (!(rrNext[k] > epsilon * epsilon * rr0[k]))
+                active[k] = 0;
+            else
+                beta[k] = rrNext[k] / rr[k];
+        }
+        rr[k] = rrNext[k];
+        *nActive += active[k];
+    }
+}
+
+bool block_cg_solver::cg_solve(d_spmatrix &d_mat, d_vector &b, d_vector &x,
+                               T epsilon) {
+    assert(b.n == n * n_columns && x.n == n * n_columns);
+#ifndef NDEBUG_PROFILING
+    profiler.start("Preparing Data");
+#endif
+    int nValues = n * n_columns;
+    auto tb = make1DThreadBlock(nValues);
+    int nActive = 0;
+
+    // r = b - A x, p = r
+    dot_block(d_mat, x, q, n_columns, false);
+    gpuErrchk(cudaMemcpyAsync(r.data, b.data, sizeof(T) * nValues,
+                              cudaMemcpyDeviceToDevice, cudaStreamPerThread));
+    block_axpyK<<<tb.block, tb.thread>>>(r.data, q.data, nullptr, -1, n,
+                                         n_columns);
+    gpuErrchk(cudaMemcpyAsync(p.data, r.data, sizeof(T) * nValues,
+                              cudaMemcpyDeviceToDevice, cudaStreamPerThread));
+    dot_columns(r, r, n_columns, rr.data, false);
+    block_startK<<<1, 1>>>(n_columns, rr.data, rr0.data, active.data,
+                           iterations.data, n_active.data, epsilon);
+    gpuErrchk(cudaPeekAtLastError());
+    gpuErrchk(cudaMemcpy(&nActive, n_active.data, sizeof(int),
+                         cudaMemcpyDeviceToHost));
+
+    // The only copy to the host of an iteration is the number of columns
+    // still active
+    int n_iter = 0;
+    while (nActive > 0 && n_iter < 1000) {
+        n_iter++;
+#ifndef NDEBUG_PROFILING
+        profiler.start("MatMult");
+#endif
+        dot_block(d_mat, p, q, n_columns, false);
+#ifndef NDEBUG_PROFILING
+        profiler.start("VectorDot");
+#endif
+        dot_columns(q, p, n_columns, pq.data, false);
+        block_alphaK<<<1, 1>>>(n_columns, n_iter, rr.data, pq.data,
+                               active.data, iterations.data, alpha.data);
+#ifndef NDEBUG_PROFILING
+        profiler.start("vector_sum");
+#endif
+        block_axpyK<<<tb.block, tb.thread>>>(x.data, p.data, alpha.data, 1, n,
+                                             n_columns);
+        block_axpyK<<<tb.block, tb.thread>>>(r.data, q.data, alpha.data, -1,
+                                             n, n_columns);
+#ifndef NDEBUG_PROFILING
+        profiler.start("VectorDot");
+#endif
+        dot_columns(r, r, n_columns, rr_next.data, false);
+        block_betaK<<<1, 1>>>(n_columns, rr_next.data, rr0.data, rr.data,
+                              active.data, n_active.data, beta.data, epsilon);
+#ifndef NDEBUG_PROFILING
+        profiler.start("vector_sum");
+#endif
+        block_xpayK<<<tb.block, tb.thread>>>(p.data, r.data, beta.data, n,
+                                             n_columns);
+        gpuErrchk(cudaPeekAtLastError());
+        gpuErrchk(cudaMemcpy(&nActive, n_active.data, sizeof(int),
+                             cudaMemcpyDeviceToHost));
+    }
+#ifndef NDEBUG_PROFILING
+    profiler.end();
+#endif
+
+    std::vector<T> h_rr(n_columns), h_rr0(n_columns);
+    std::vector<int> h_active(n_columns);
+    n_iter_columns.resize(n_columns);
+    gpuErrchk(cudaMemcpy(h_rr.data(), rr.data, sizeof(T) * n_columns,
+                         cudaMemcpyDeviceToHost));
+    gpuErrchk(cudaMemcpy(h_rr0.data(), rr0.data, sizeof(T) * n_columns,
+                         cudaMemcpyDeviceToHost));
+    gpuErrchk(cudaMemcpy(h_active.data(), active.data, sizeof(int) * n_columns,
+                         cudaMemcpyDeviceToHost));
+    gpuErrchk(cudaMemcpy(n_iter_columns.data(), iterations.data,
+                         sizeof(int) * n_columns, cudaMemcpyDeviceToHost));
+    n_iter_last = n_iter;
+    residual0_last.resize(n_columns);
+    residual_last.resize(n_columns);
+    converged_columns.resize(n_columns);
+    for (int k = 0; k < n_columns; k++) {
+        residual0_last[k] = sqrt(h_rr0[k]);
+        residual_last[k] = sqrt(h_rr[k]);
+        converged_columns[k] = !h_active[k];
+    }
+    converged_last = nActive == 0;
+    return converged_last;
+}
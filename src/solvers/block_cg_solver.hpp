@@ -0,0 +1,51 @@
+#pragma once
+
+#include <vector>
+
+#include "constants.hpp"
+#include "dataStructures/array.hpp"
+#include "dataStructures/sparse_matrix.hpp"
+#include "matrixOperations/basic_operations.hpp"
+
+// Conjugate gradient on several right-hand sides at once. The vectors are
+// blocks of n_columns columns of n values (column k at k * n). Each column
+// follows its own conjugate gradient recurrence, but the matrix products of
+// all the columns are done in one sparse matrix - dense matrix product, so
+// that the matrix is read once per iteration for the whole block.
+class block_cg_solver {
+  public:
+    int n;
+    int n_columns;
+    d_vector q;
+    d_vector r;
+    d_vector p;
+    d_vector alpha; // Per column step, on the device
+    d_vector beta;
+
+#ifndef NDEBUG_PROFILING
+    chrono_profiler profiler{"block_cg_solver"};
+#endif
+
+    block_cg_solver(int n, int nColumns);
+    // A column stops once the norm of its residual is under epsilon times its
+    // initial norm. Returns true when all the columns converged.
+    bool cg_solve(d_spmatrix &d_mat, d_vector &b, d_vector &x, T epsilon);
+
+    // Outcome of the last call to cg_solve
+    int n_iter_last = 0;
+    std::vector<int> n_iter_columns; // Iterations of each column
+    std::vector<T> residual0_last;
+    std::vector<T> residual_last;
+    std::vector<bool> converged_columns;
+    bool converged_last = true;
+
+  private:
+    // Per column state of the recurrences, on the device
+    d_vector rr;      // r^T r
+    d_vector rr0;     // r^T r of the initial residual
+    d_vector rr_next; // r^T r after the step
+    d_vector pq;      // p^T A p
+    d_array<int> active;
+    d_array<int> iterations;
+    d_array<int> n_active;
+};
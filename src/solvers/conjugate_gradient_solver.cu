@@ -1,25 +1,38 @@
+#include <assert.h>
+#include <cmath>
 #include <cstdio>
 #include <fstream>
+#include <stdexcept>
 
 #include "conjugate_gradient_solver.hpp"
 #include "constants.hpp"
 #include "helper/chrono_profiler.hpp"
+#include "helper/cuda/cuda_error_check.h"
 
-cg_solver::cg_solver(int n) : q(n), r(n), p(n) {}
+cg_solver::cg_solver(int n) : n(n), q(n), r(n), p(n) {}
 
 bool cg_solver::cg_solve(d_spmatrix &d_mat, d_vector &b, d_vector &x, T epsilon,
-                         std::string outputPath) {
+                         std::string outputPath, bool harvest) {
 #ifndef NDEBUG_PROFILING
     profiler.start("Preparing Data");
 #endif
+    assert(b.n == n && x.n == n);
+    if (preconditioner) {
+        if (deflation)
+            throw std::invalid_argument(
+                "Deflation and preconditioning cannot be combined\n");
+        return pcg_solve(d_mat, b, x, epsilon);
+    }
     dot(d_mat, x, q, true);
 
-    r = d_vector(b); // Copy b into r
+    // Copies into the existing buffers, as a new allocation would synchronize
+    // the whole device
+    gpuErrchk(cudaMemcpy(r.data, b.data, sizeof(T) * n,
+                         cudaMemcpyDeviceToDevice));
     alpha() = -1.0;
     alpha.update_dev();
     vector_sum(r, q, alpha(true), r);
 
-    p = d_vector(r); // copy r into p
     beta() = 0.0;
     beta.update_dev();
     value() = 0.0;
@@ -28,6 +41,35 @@ bool cg_solver::cg_solve(d_spmatrix &d_mat, d_vector &b, d_vector &x, T epsilon,
     diff.update_host();
 
     T diff0 = diff();
+    residual0_last = sqrt(diff0);
+    gpuErrchk(cudaMemcpy(p.data, r.data, sizeof(T) * n,
+                         cudaMemcpyDeviceToDevice));
+    if (deflation && deflation->n_vectors > 0) {
+        // The reference stays the residual of the given guess
+        deflation->deflate_guess(x, r);
+        gpuErrchk(cudaMemcpy(p.data, r.data, sizeof(T) * n,
+                             cudaMemcpyDeviceToDevice));
+        deflation->project(r, p);
+        dot(r, r, diff(true), true);
+        diff.update_host();
+    }
+    if (relative_to_rhs) {
+        dot(b, b, value(true), true);
+        value.update_host();
+        diff0 = value();
+        value() = 0.0;
+        value.update_dev();
+        // The initial guess may already be good enough
+        if (!(diff() > epsilon * epsilon * diff0)) {
+#ifndef NDEBUG_PROFILING
+            profiler.end();
+#endif
+            n_iter_last = 0;
+            residual_last = sqrt(diff());
+            converged_last = true;
+            return true;
+        }
+    }
 
     int n_iter = 0;
     do {
@@ -42,10 +84,19 @@ bool cg_solver::cg_solve(d_spmatrix &d_mat, d_vector &b, d_vector &x, T epsilon,
         dot(q, p, value(true), true);
 
         value.update_host();
+        if (deflation && harvest)
+            deflation->record(p, value());
         if (value() != 0)
             alpha() = diff() / value();
         else {
+#ifndef NDEBUG_PROFILING
+            profiler.end();
+#endif
+            if (deflation)
+                deflation->update(d_mat);
             n_iter_last = n_iter;
+            residual_last = sqrt(diff());
+            converged_last = true;
             return true;
         }
         alpha.update_dev();
@@ -73,7 +124,14 @@ bool cg_solver::cg_solve(d_spmatrix &d_mat, d_vector &b, d_vector &x, T epsilon,
         if (diff() != 0)
             beta() = diff() / value();
         else {
+#ifndef NDEBUG_PROFILING
+            profiler.end();
+#endif
+            if (deflation)
+                deflation->update(d_mat);
             n_iter_last = n_iter;
+            residual_last = sqrt(diff());
+            converged_last = true;
             return true;
         }
         beta.update_dev();
@@ -82,17 +140,107 @@ bool cg_solver::cg_solve(d_spmatrix &d_mat, d_vector &b, d_vector &x, T epsilon,
         profiler.start("vector_sum");
 #endif
         vector_sum(r, p, beta(true), p, true);
+        if (deflation)
+            deflation->project(r, p);
     } while (diff() > epsilon * epsilon * diff0 && n_iter < 1000);
 #ifndef NDEBUG_PROFILING
     profiler.end();
 #endif
+    if (deflation)
+        deflation->update(d_mat);
 
     n_iter_last = n_iter;
+    residual_last = sqrt(diff());
+    converged_last = !(diff() > epsilon * epsilon * diff0);
+    return converged_last;
+}
 
-    if (diff() > epsilon * epsilon * diff0)
-        printf("Warning: It did not converge\n");
+// Same steps as cg_solve, with the search directions built from the
+// preconditioned residual z = M^-1 r. The convergence is still measured on
+// the norm of r.
+bool cg_solver::pcg_solve(d_spmatrix &d_mat, d_vector &b, d_vector &x,
+                          T epsilon) {
+#ifndef NDEBUG_PROFILING
+    profiler.start("Preparing Data");
+#endif
+    if (z.n != n)
+        z.resize(n);
+    dot(d_mat, x, q, true);
+    gpuErrchk(cudaMemcpy(r.data, b.data, sizeof(T) * n,
+                         cudaMemcpyDeviceToDevice));
+    alpha() = -1.0;
+    alpha.update_dev();
+    vector_sum(r, q, alpha(true), r);
+    dot(r, r, diff(true), true);
+    diff.update_host();
+    T diff0 = diff();
+    residual0_last = sqrt(diff0);
+    if (relative_to_rhs) {
+        dot(b, b, value(true), true);
+        value.update_host();
+        diff0 = value();
+    }
 
-    return !(diff() > epsilon * epsilon * diff0);
+    int n_iter = 0;
+    T rz = 0;
+    while (diff() > epsilon * epsilon * diff0 && n_iter < 1000) {
+#ifndef NDEBUG_PROFILING
+        profiler.start("Preconditioner");
+#endif
+        preconditioner->apply(r, z);
+#ifndef NDEBUG_PROFILING
+        profiler.start("VectorDot");
+#endif
+        dot(r, z, value(true), true);
+        value.update_host();
+        if (n_iter == 0) {
+            gpuErrchk(cudaMemcpy(p.data, z.data, sizeof(T) * n,
+                                 cudaMemcpyDeviceToDevice));
+        } else {
+            beta() = value() / rz;
+            beta.update_dev();
+#ifndef NDEBUG_PROFILING
+            profiler.start("vector_sum");
+#endif
+            vector_sum(z, p, beta(true), p, true);
+        }
+        rz = value();
+        n_iter++;
+
+#ifndef NDEBUG_PROFILING
+        profiler.start("MatMult");
+#endif
+        dot(d_mat, p, q, true);
+#ifndef NDEBUG_PROFILING
+        profiler.start("VectorDot");
+#endif
+        dot(q, p, value(true), true);
+        value.update_host();
+        if (value() == 0 || rz == 0)
+            break;
+        alpha() = rz / value();
+        alpha.update_dev();
+#ifndef NDEBUG_PROFILING
+        profiler.start("vector_sum");
+#endif
+        vector_sum(x, p, alpha(true), x, true);
+        value() = -alpha();
+        value.update_dev();
+        vector_sum(r, q, value(true), r, true);
+#ifndef NDEBUG_PROFILING
+        profiler.start("VectorDot");
+#endif
+        dot(r, r, diff(true), true);
+        diff.update_host();
+    }
+#ifndef NDEBUG_PROFILING
+    profiler.end();
+#endif
+
+    n_iter_last = n_iter;
+    residual_last = sqrt(diff());
+    converged_last = !(diff() > epsilon * epsilon * diff0);
+    return converged_last;
 }
 
 bool cg_solver::st_cg_solve(d_spmatrix &d_mat, d_vector &b, d_vector &x,
@@ -145,8 +293,5 @@ bool cg_solver::st_cg_solve(d_spmatrix &d_mat, d_vector &b, d_vector &x,
         vector_sum(r, p, beta(true), p, true);
     } while (diff() > epsilon * epsilon * diff0 && n_iter < 1000);
 
-    if (diff() > epsilon * epsilon * diff0)
-        printf("Warning: It did not converge\n");
-
     return !(diff() > epsilon * epsilon * diff0);
 }
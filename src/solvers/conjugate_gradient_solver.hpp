@@ -7,6 +7,8 @@
 #include "dataStructures/hd_data.hpp"
 #include "dataStructures/sparse_matrix.hpp"
 #include "matrixOperations/basic_operations.hpp"
+#include "amg_preconditioner.hpp"
+#include "deflation_space.hpp"
 
 class cg_solver {
   public:
@@ -21,13 +23,41 @@ class cg_solver {
     hd_data<T> diff;
 
 #ifndef NDEBUG_PROFILING
-    chrono_profiler profiler;
+    chrono_profiler profiler{"cg_solver"};
 #endif
 
+    // The solve stops once the norm of the residual is under epsilon times
+    // the norm of the initial residual, or of b if relative_to_rhs is set. The
+    // latter does not depend on the initial guess, so a better guess makes
+    // the solve shorter rather than more accurate.
+    bool relative_to_rhs = false;
+
+    // Deflated conjugate gradient if set: the solve is deflated by the
+    // vectors of the space, and a harvesting solve updates them from its
+    // search directions (unless cg_solve is called with harvest = false).
+    // The space must belong to the matrix of the solves.
+    deflation_space *deflation = nullptr;
+
+    // Preconditioned conjugate gradient if set, with one V-cycle of the
+    // preconditioner per iteration. It must be built from the matrix of the
+    // solves, and cannot be combined with deflation.
+    amg_preconditioner *preconditioner = nullptr;
+
     cg_solver(int n);
     bool cg_solve(d_spmatrix &d_mat, d_vector &b, d_vector &y, T epsilon,
-                  std::string str = "");
+                  std::string str = "", bool harvest = true);
+
+    // Outcome of the last call to cg_solve
     int n_iter_last = 0;
+    T residual0_last = 0;
+    T residual_last = 0;
+    bool converged_last = true;
+
     static bool st_cg_solve(d_spmatrix &d_mat, d_vector &b, d_vector &y,
                             T epsilon); // TODO FactorizeCode
+
+  private:
+    d_vector z; // Preconditioned residual, allocated on first use
+
+    bool pcg_solve(d_spmatrix &d_mat, d_vector &b, d_vector &x, T epsilon);
 };
\ No newline at end of file
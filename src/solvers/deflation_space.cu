@@ -0,0 +1,258 @@
+#include <algorithm>
+#include <assert.h>
+#include <cmath>
+#include <limits>
+
+#include "dataStructures/helper/reduce_operation.h"
+#include "deflation_space.hpp"
+#include "helper/cuda/cuda_error_check.h"
+#include "helper/cuda/cuda_thread_manager.hpp"
+#include "helper/dense_linear_algebra.hpp"
+#include "matrixOperations/basic_operations.hpp"
+
+// Segment s is the dot product of column s of basis with v
+struct basis_dot_op {
+    const T *basis;
+    const T *v;
+    int n;
+    __device__ T operator()(int s, int i) const {
+        return basis[s * n + i] * v[i];
+    }
+};
+
+// Segment s is the dot product of the columns pairs[2s] and pairs[2s + 1]
+// of the table
+struct column_pairs_op {
+    T *const *columns;
+    const int *pairs;
+    __device__ T operator()(int s, int i) const {
+        return columns[pairs[2 * s]][i] * columns[pairs[2 * s + 1]][i];
+    }
+};
+
+// y += sum over s of c[s] * column s of basis
+__global__ void add_columnsK(int n, int nColumns, T *y, const T *basis,
+                             const T *c) {
+    int i = threadIdx.x + blockIdx.x * blockDim.x;
+    if (i >= n)
+        return;
+    T value = y[i];
+    for (int s = 0; s < nColumns; s++)
+        value += c[s] * basis[s * n + i];
+    y[i] = value;
+}
+
+// Column j of out is sum over c of y[c * nOut + j] * columns[c]
+__global__ void combine_columnsK(int n, int nColumns, T *const *columns,
+                                 const T *y, int nOut, T *out) {
+    int k = threadIdx.x + blockIdx.x * blockDim.x;
+    if (k >= n * nOut)
+        return;
+    int i = k % n;
+    int j = k / n;
+    T value = 0;
+    for (int c = 0; c < nColumns; c++)
+        value += y[c * nOut + j] * columns[c][i];
+    out[k] = value;
+}
+
+__global__ void scaled_copyK(int n, const T *x, T factor, T *y) {
+    int i = threadIdx.x + blockIdx.x * blockDim.x;
+    if (i >= n)
+        return;
+    y[i] = factor * x[i];
+}
+
+void deflation_space::reset(int n, int nMax, int harvestSolves) {
+    assert(nMax >= 0 && nMax <= DEFLATION_MAX_VECTORS);
+    this->n = n;
+    n_max = nMax;
+    harvest_solves = harvestSolves;
+    clear();
+}
+
+void deflation_space::clear() {
+    n_vectors = 0;
+    n_recorded = 0;
+    E_factor.clear();
+}
+
+void deflation_space::coordinates(d_vector &basis, d_vector &v,
+                                  std::vector<T> &c) {
+    c.resize(n_vectors);
+    segmented_transform_reduce(n, n_vectors,
+                               basis_dot_op{basis.data, v.data, n}, T(0),
+                               reduce_sum_op<T>(), c.data());
+    cholesky_solve(E_factor, n_vectors, c.data());
+}
+
+void deflation_space::deflate_guess(d_vector &x, d_vector &r) {
+    if (n_vectors == 0)
+        return;
+    assert(x.n == n && r.n == n);
+    std::vector<T> c;
+    coordinates(W, r, c);
+    c.resize(2 * n_vectors);
+    for (int s = 0; s < n_vectors; s++)
+        c[n_vectors + s] = -c[s];
+    gpuErrchk(cudaMemcpy(coefficients.data, c.data(),
+                         sizeof(T) * 2 * n_vectors, cudaMemcpyHostToDevice));
+    auto tb = make1DThreadBlock(n);
+    add_columnsK<<<tb.block, tb.thread>>>(n, n_vectors, x.data, W.data,
+                                          coefficients.data);
+    add_columnsK<<<tb.block, tb.thread>>>(n, n_vectors, r.data, AW.data,
+                                          coefficients.data + n_vectors);
+    gpuErrchk(cudaPeekAtLastError());
+}
+
+void deflation_space::project(d_vector &r, d_vector &p) {
+    if (n_vectors == 0)
+        return;
+    std::vector<T> c;
+    coordinates(AW, r, c);
+    for (auto &value : c)
+        value = -value;
+    gpuErrchk(cudaMemcpy(coefficients.data, c.data(), sizeof(T) * n_vectors,
+                         cudaMemcpyHostToDevice));
+    auto tb = make1DThreadBlock(n);
+    add_columnsK<<<tb.block, tb.thread>>>(n, n_vectors, p.data, W.data,
+                                          coefficients.data);
+    gpuErrchk(cudaPeekAtLastError());
+}
+
+void deflation_space::record(d_vector &p, T pAp) {
+    int nHarvest = DEFLATION_HARVEST_FACTOR * n_max;
+    if (harvest_solves <= 0 || n_recorded >= nHarvest || !(pAp > 0))
+        return;
+    // Allocated once, on the first harvest
+    if (P.n != n * nHarvest)
+        P.resize(n * nHarvest);
+    auto tb = make1DThreadBlock(n);
+    scaled_copyK<<<tb.block, tb.thread>>>(n, p.data, 1 / sqrt(pAp),
+                                          P.data + n_recorded * n);
+    gpuErrchk(cudaPeekAtLastError());
+    n_recorded++;
+}
+
+std::vector<T> deflation_space::gram(const std::vector<T *> &x,
+                                     const std::vector<T *> &y) {
+    assert(x.size() == y.size());
+    int m = x.size();
+    std::vector<T *> table(x);
+    table.insert(table.end(), y.begin(), y.end());
+    std::vector<int> h_pairs;
+    for (int i = 0; i < m; i++)
+        for (int j = i; j < m; j++) {
+            h_pairs.push_back(i);
+            h_pairs.push_back(m + j);
+        }
+    if (columns.n < (int)table.size())
+        columns.resize(table.size());
+    if (pairs.n < (int)h_pairs.size())
+        pairs.resize(h_pairs.size());
+    gpuErrchk(cudaMemcpy(columns.data, table.data(),
+                         sizeof(T *) * table.size(), cudaMemcpyHostToDevice));
+    gpuErrchk(cudaMemcpy(pairs.data, h_pairs.data(),
+                         sizeof(int) * h_pairs.size(),
+                         cudaMemcpyHostToDevice));
+
+    int nPairs = h_pairs.size() / 2;
+    std::vector<T> values(nPairs);
+    segmented_transform_reduce(n, nPairs,
+                               column_pairs_op{columns.data, pairs.data},
+                               T(0), reduce_sum_op<T>(), values.data());
+    std::vector<T> result(m * m);
+    int s = 0;
+    for (int i = 0; i < m; i++)
+        for (int j = i; j < m; j++, s++) {
+            result[i * m + j] = values[s];
+            result[j * m + i] = values[s];
+        }
+    return result;
+}
+
+void deflation_space::update(d_spmatrix &mat) {
+    if (n_recorded == 0)
+        return;
+    harvest_solves--;
+    int k = n_vectors;
+    int m = k + n_recorded;
+
+    // Columns of Z = [W, P]
+    std::vector<T *> z;
+    for (int s = 0; s < k; s++)
+        z.push_back(W.data + s * n);
+    for (int s = 0; s < n_recorded; s++)
+        z.push_back(P.data + s * n);
+    n_recorded = 0;
+
+    // Z^T A Z is block diagonal, diag(E, I), with the Cholesky factor G
+    std::vector<T> G(m * m, 0);
+    for (int i = 0; i < m; i++)
+        for (int j = 0; j <= i; j++)
+            G[i * m + j] = (i < k) ? ((j < k) ? E_factor[i * k + j] : 0)
+                                   : (i == j);
+    // Ritz pairs of A over the span of Z: Z^T Z y = mu G G^T y, with mu the
+    // inverse of the Ritz value. In the basis of G^T y the matrix is
+    // G^-1 Z^T Z G^-T, symmetric.
+    std::vector<T> C = gram(z, z);
+    lower_solve(G, m, C.data(), m);
+    for (int i = 0; i < m; i++)
+        for (int j = 0; j < i; j++)
+            std::swap(C[i * m + j], C[j * m + i]);
+    lower_solve(G, m, C.data(), m);
+    std::vector<T> values, vectors;
+    symmetric_eigen(C, m, values, vectors);
+
+    // The largest mu, the directions that are (numerically) in the span of
+    // the others are dropped
+    int kNew = 0;
+    while (kNew < std::min(n_max, m) &&
+           values[kNew] > values[0] * std::numeric_limits<T>::epsilon() * m)
+        kNew++;
+    std::vector<T> Y(m * kNew);
+    for (int c = 0; c < m; c++)
+        for (int j = 0; j < kNew; j++)
+            Y[c * kNew + j] = vectors[c * m + j];
+    lower_transpose_solve(G, m, Y.data(), kNew);
+
+    if (coefficients.n < m * kNew)
+        coefficients.resize(std::max(m * kNew, 2 * DEFLATION_MAX_VECTORS));
+    if (columns.n < m)
+        columns.resize(2 * m);
+    gpuErrchk(cudaMemcpy(coefficients.data, Y.data(), sizeof(T) * m * kNew,
+                         cudaMemcpyHostToDevice));
+    gpuErrchk(cudaMemcpy(columns.data, z.data(), sizeof(T *) * m,
+                         cudaMemcpyHostToDevice));
+    if (next.n != n * kNew)
+        next.resize(n * kNew);
+    if (kNew > 0) {
+        auto tb = make1DThreadBlock(n * kNew);
+        combine_columnsK<<<tb.block, tb.thread>>>(n, m, columns.data,
+                                                  coefficients.data, kNew,
+                                                  next.data);
+        gpuErrchk(cudaPeekAtLastError());
+    }
+
+    // W and A W are resized rarely: the size only grows until n_max
+    n_vectors = kNew;
+    if (W.n != n * kNew) {
+        W.resize(n * kNew);
+        AW.resize(n * kNew);
+    }
+    if (kNew == 0) {
+        clear();
+        return;
+    }
+    gpuErrchk(cudaMemcpy(W.data, next.data, sizeof(T) * n * kNew,
+                         cudaMemcpyDeviceToDevice));
+    dot_block(mat, W, AW, kNew);
+    std::vector<T *> w, aw;
+    for (int s = 0; s < kNew; s++) {
+        w.push_back(W.data + s * n);
+        aw.push_back(AW.data + s * n);
+    }
+    E_factor = gram(w, aw);
+    if (!cholesky(E_factor, kNew))
+        clear();
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <vector>
+
+#include "constants.hpp"
+#include "dataStructures/array.hpp"
+#include "dataStructures/sparse_matrix.hpp"
+
+#define DEFLATION_MAX_VECTORS 32
+// Search directions kept from a harvesting solve, per deflation vector
+#define DEFLATION_HARVEST_FACTOR 3
+
+// Deflation space of a sequence of conjugate gradient solves with the same
+// matrix A. The columns of W approximate the eigenvectors of the smallest
+// eigenvalues of A; the deflated solve (see cg_solver::deflation) removes
+// them from the initial residual and keeps its search directions
+// A-orthogonal to them, so that it converges as if these eigenvalues were
+// not there.
+// W is harvested from the solves themselves: a harvesting solve keeps its
+// first search directions, and W is replaced by the Ritz vectors of the
+// smallest Ritz values of A over the span of W and of these directions. The
+// directions are A-orthogonal to each other and to W, so that only their
+// Euclidean Gram matrix has to be computed.
+class deflation_space {
+  public:
+    int n = 0;
+    // Maximum number of vectors, at most DEFLATION_MAX_VECTORS
+    int n_max = 0;
+    int n_vectors = 0;
+    // Number of the next solves that harvest their search directions
+    int harvest_solves = 0;
+
+    d_vector W;  // n_vectors columns of n values
+    d_vector AW; // A W
+
+    deflation_space() {}
+    // Empties the space for a new matrix of size n
+    void reset(int n, int nMax, int harvestSolves);
+    void clear();
+
+    // x += W E^-1 W^T r and r -= A W E^-1 W^T r, with E = W^T A W, so that
+    // the residual r of x is orthogonal to W
+    void deflate_guess(d_vector &x, d_vector &r);
+    // p -= W E^-1 (A W)^T r
+    void project(d_vector &r, d_vector &p);
+    // Keeps the search direction p of a harvesting solve, pAp = p^T A p
+    void record(d_vector &p, T pAp);
+    // At the end of a solve: updates W from the kept directions, if any
+    void update(d_spmatrix &mat);
+
+  private:
+    int n_recorded = 0;
+    d_vector P;    // Kept directions, normalized to p^T A p = 1
+    d_vector next; // New W
+    std::vector<T> E_factor; // Cholesky factor of W^T A W
+    d_vector coefficients;
+    d_array<T *> columns;
+    d_array<int> pairs;
+
+    // Solves E c = W^T v (or (A W)^T v)
+    void coordinates(d_vector &basis, d_vector &v, std::vector<T> &c);
+    // Row-major matrix of the dot products x[i]^T y[j] of two lists of
+    // columns, assumed symmetric: only i <= j is computed
+    std::vector<T> gram(const std::vector<T *> &x, const std::vector<T *> &y);
+};
@@ -0,0 +1,73 @@
+#include <assert.h>
+
+#include "helper/cuda/cuda_error_check.h"
+#include "helper/cuda/cuda_thread_manager.hpp"
+#include "solution_predictor.hpp"
+
+// x += c0 * d0 + c1 * d1 + c2 * d2, the null increments are skipped
+__global__ void extrapolateK(int n, T *x, const T *d0, const T *d1,
+                             const T *d2, T c0, T c1, T c2) {
+    int i = threadIdx.x + blockIdx.x * blockDim.x;
+    if (i >= n)
+        return;
+    T increment = c0 * d0[i];
+    if (d1)
+        increment += c1 * d1[i];
+    if (d2)
+        increment += c2 * d2[i];
+    x[i] += increment;
+}
+
+__global__ void incrementK(int n, const T *x, const T *start, T *increment) {
+    int i = threadIdx.x + blockIdx.x * blockDim.x;
+    if (i >= n)
+        return;
+    increment[i] = x[i] - start[i];
+}
+
+solution_predictor::solution_predictor(int n, int order)
+    : n(n), order(order), start(n) {
+    assert(order >= 1 && order <= 3);
+    increments.reserve(order);
+    for (int k = 0; k < order; k++)
+        increments.emplace_back(n);
+}
+
+void solution_predictor::predict(d_vector &x) {
+    assert(x.n == n);
+    gpuErrchk(cudaMemcpy(start.data, x.data, sizeof(T) * n,
+                         cudaMemcpyDeviceToDevice));
+    if (n_stored == 0 || n == 0)
+        return;
+
+    // Increment k steps back
+    auto back = [this](int k) -> const T * {
+        if (k >= n_stored)
+            return nullptr;
+        return increments[(head - 1 - k + 2 * order) % order].data;
+    };
+    static const T coefficients[3][3] = {{1, 0, 0}, {2, -1, 0}, {3, -3, 1}};
+    const T *c = coefficients[n_stored - 1];
+    auto tb = make1DThreadBlock(n);
+    extrapolateK<<<tb.block, tb.thread>>>(n, x.data, back(0), back(1),
+                                          back(2), c[0], c[1], c[2]);
+    gpuErrchk(cudaPeekAtLastError());
+}
+
+void solution_predictor::record(d_vector &x) {
+    assert(x.n == n);
+    if (n == 0)
+        return;
+    auto tb = make1DThreadBlock(n);
+    incrementK<<<tb.block, tb.thread>>>(n, x.data, start.data,
+                                        increments[head].data);
+    gpuErrchk(cudaPeekAtLastError());
+    head = (head + 1) % order;
+    if (n_stored < order)
+        n_stored++;
+}
+
+void solution_predictor::clear() {
+    n_stored = 0;
+    head = 0;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <vector>
+
+#include "constants.hpp"
+#include "dataStructures/array.hpp"
+
+// Initial guess of a sequence of solves with a constant time step. The
+// increments of the solutions over their initial guesses are kept, and the
+// next increment is extrapolated from the last ones (polynomially in time):
+// with one increment d0, d0; with two, 2 d0 - d1; with three, 3 d0 - 3 d1 +
+// d2 (d0 being the most recent). Extrapolating the increments rather than
+// the solutions keeps what happened between two solves (e.g. a reaction
+// step).
+class solution_predictor {
+  public:
+    int n;
+    // Number of increments used, 1 to 3
+    int order;
+    // Number of increments held, at most order
+    int n_stored = 0;
+    // Unpredicted guess of the current solve
+    d_vector start;
+
+    solution_predictor(int n, int order = 2);
+
+    // Saves x as the unpredicted guess, and adds the extrapolated increment
+    // to it
+    void predict(d_vector &x);
+    // Stores the increment of the solution x over the unpredicted guess
+    void record(d_vector &x);
+    void clear();
+
+  private:
+    std::vector<d_vector> increments;
+    int head = 0; // Slot of the next increment
+};
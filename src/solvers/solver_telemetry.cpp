@@ -0,0 +1,48 @@
+#include <stdexcept>
+
+#include "solver_telemetry.hpp"
+
+solver_telemetry::solver_telemetry(int capacity) : records(capacity) {
+    if (capacity <= 0)
+        throw std::invalid_argument("The telemetry capacity must be positive");
+}
+
+void solver_telemetry::record(const solve_record &rec) {
+    records[head] = rec;
+    head = (head + 1) % capacity();
+    if (count < capacity())
+        count++;
+    n_solves++;
+    if (!rec.converged)
+        n_failed++;
+}
+
+void solver_telemetry::clear() {
+    head = 0;
+    count = 0;
+    n_solves = 0;
+    n_failed = 0;
+}
+
+void solver_telemetry::set_capacity(int capacity) {
+    if (capacity <= 0)
+        throw std::invalid_argument("The telemetry capacity must be positive");
+    std::vector<solve_record> kept;
+    for (int k = (count > capacity) ? count - capacity : 0; k < count; k++)
+        kept.push_back(at(k));
+    records = std::vector<solve_record>(capacity);
+    count = kept.size();
+    for (int k = 0; k < count; k++)
+        records[k] = kept[k];
+    head = count % capacity;
+}
+
+int solver_telemetry::capacity() const { return records.size(); }
+
+int solver_telemetry::size() const { return count; }
+
+const solve_record &solver_telemetry::at(int k) const {
+    if (k < 0 || k >= count)
+        throw std::out_of_range("Telemetry record index out of range");
+    return records[(head - count + k + capacity()) % capacity()];
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <vector>
+
+#include "constants.hpp"
+
+// Outcome of one conjugate gradient solve
+struct solve_record {
+    int step = 0;    // Index of the diffusion step
+    int species = 0; // Index of the species in the state
+    int member = 0;  // Member of an ensemble_simulation, 0 otherwise
+    int n_iter = 0;
+    T residual0 = 0; // Norm of the initial residual
+    T residual = 0;  // Norm of the final residual
+    double time = 0; // Wall-clock duration, in seconds (of the whole block for
+                     // an ensemble)
+    bool converged = true;
+    // Iterations of the same solve from the unpredicted guess, -1 if it was
+    // not probed (see simulation::predictor_probe_every)
+    int n_iter_unpredicted = -1;
+};
+
+// Keeps the most recent solves in a fixed-size ring buffer, so that it can
+// stay enabled during long runs
+class solver_telemetry {
+  public:
+    solver_telemetry(int capacity = 4096);
+
+    void record(const solve_record &);
+    void clear();
+
+    // Drops the oldest records if the new capacity is smaller
+    void set_capacity(int capacity);
+    int capacity() const;
+
+    // Number of records currently held
+    int size() const;
+    // Record k, from the oldest (0) to the most recent (size() - 1)
+    const solve_record &at(int k) const;
+
+    // Totals since the last clear, including overwritten records
+    long n_solves = 0;
+    long n_failed = 0;
+
+  private:
+    std::vector<solve_record> records;
+    int head = 0;
+    int count = 0;
+};
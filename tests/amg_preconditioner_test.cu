@@ -0,0 +1,53 @@
+// The AMG preconditioner rejects the matrices it cannot handle, and speeds up
+// the conjugate gradient on a P1 diffusion matrix.
+
+#include <memory>
+#include <stdexcept>
+
+#include "dataStructures/array.hpp"
+#include "dataStructures/hd_data.hpp"
+#include "dataStructures/sparse_matrix.hpp"
+#include "geometry/mesh.hpp"
+#include "geometry/p1_assembly.hpp"
+#include "helper/cuda/cuda_error_check.h"
+#include "matrixOperations/basic_operations.hpp"
+#include "solvers/amg_preconditioner.hpp"
+#include "solvers/conjugate_gradient_solver.hpp"
+#include "test_helper.hpp"
+
+int main() {
+    d_spmatrix hostMatrix(4, 4, 4, CSR, false);
+    CHECK_THROWS(std::invalid_argument, amg_preconditioner amg(hostMatrix));
+    d_spmatrix cooMatrix(4, 4, 4, COO, true);
+    CHECK_THROWS(std::invalid_argument, amg_preconditioner amg(cooMatrix));
+    d_spmatrix rectangular(4, 5, 4, CSR, true);
+    CHECK_THROWS(std::invalid_argument, amg_preconditioner amg(rectangular));
+
+    test_mesh hostMesh = make_test_mesh(64);
+    int n = hostMesh.n_nodes();
+    d_mesh mesh(n, hostMesh.x.data(), hostMesh.y.data());
+    d_array<int> triangles(hostMesh.triangles.size());
+    gpuErrchk(cudaMemcpy(triangles.data, hostMesh.triangles.data(),
+                         sizeof(int) * hostMesh.triangles.size(),
+                         cudaMemcpyHostToDevice));
+    d_spmatrix mass, stiffness, diffusion;
+    assemble_p1_matrices(mesh, triangles, mass, stiffness);
+    hd_data<T> minusDt(-0.1);
+    matrix_sum(mass, stiffness, minusDt(true), diffusion);
+
+    d_vector x(n), b(n), y(n);
+    x.fill(1.0);
+    dot(mass, x, b);
+    cg_solver solver(n);
+    y.fill(0.0);
+    CHECK(solver.cg_solve(diffusion, b, y, 1e-8));
+    int plainIterations = solver.n_iter_last;
+
+    amg_preconditioner amg(diffusion);
+    solver.preconditioner = &amg;
+    y.fill(0.0);
+    CHECK(solver.cg_solve(diffusion, b, y, 1e-8));
+    CHECK(solver.n_iter_last < plainIterations);
+
+    return test_result("amg_preconditioner_test");
+}
@@ -0,0 +1,149 @@
+// Parsing of the text format of reaction networks (see parse_crn): species,
+// laws, splitting of the reversible reactions, merging of the repeated
+// reactions, and line numbers of the errors.
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "reactionDiffusionSystem/crn_loader.hpp"
+#include "test_helper.hpp"
+
+// parse_crn must throw, with the line number at the start of the message
+void check_error(const std::string &text, int line) {
+    std::string prefix = "line " + std::to_string(line) + ": ";
+    try {
+        parse_crn(text);
+    } catch (const std::invalid_argument &e) {
+        std::string message = e.what();
+        if (message.compare(0, prefix.size(), prefix) != 0) {
+            std::cerr << "expected an error at line " << line << ", got \""
+                      << message << "\"\n";
+            test_failures()++;
+        }
+        return;
+    }
+    std::cerr << "no error for:\n" << text << "\n";
+    test_failures()++;
+}
+
+bool same_side(const std::vector<stochCoeff> &side,
+               const std::vector<stochCoeff> &expected) {
+    return side == expected;
+}
+
+void test_species() {
+    crn_network network = parse_crn("# comment\n"
+                                    "species A B = 0.5\n"
+                                    "\n"
+                                    "fixed T   # not diffusing\n"
+                                    "species C\n");
+    CHECK(network.species.size() == 4);
+    CHECK(network.reactions.empty());
+    if (network.species.size() != 4)
+        return;
+    CHECK(network.species[0].name == "A" && network.species[1].name == "B");
+    CHECK(network.species[0].has_value && network.species[0].value == 0.5);
+    CHECK(network.species[1].has_value && network.species[1].value == 0.5);
+    CHECK(network.species[0].line == 2);
+    CHECK(network.species[2].name == "T" && !network.species[2].diffusion);
+    CHECK(!network.species[2].has_value);
+    CHECK(network.species[2].line == 4);
+    CHECK(network.species[3].diffusion && network.species[3].line == 5);
+}
+
+void test_laws() {
+    crn_network network = parse_crn("A + 2 B -> C : 0.5\n"
+                                    "A -> B + C : mm 300, 440\n"
+                                    "B -> A : hill 10, 2, 4\n");
+    CHECK(network.reactions.size() == 3);
+    if (network.reactions.size() != 3)
+        return;
+    auto &massAction = network.reactions[0];
+    CHECK(massAction.law == crn_mass_action && massAction.k0 == 0.5);
+    CHECK(same_side(massAction.holder.Reagents, {{"A", 1}, {"B", 2}}));
+    CHECK(same_side(massAction.holder.Products, {{"C", 1}}));
+    CHECK(massAction.line == 1);
+    auto &michaelisMenten = network.reactions[1];
+    CHECK(michaelisMenten.law == crn_michaelis_menten);
+    CHECK(michaelisMenten.k0 == 300 && michaelisMenten.k1 == 440);
+    auto &hill = network.reactions[2];
+    CHECK(hill.law == crn_hill && hill.k0 == 10);
+    CHECK(hill.k1 == 2 && hill.k2 == 4);
+    CHECK(hill.line == 3);
+}
+
+void test_reversible() {
+    crn_network network = parse_crn("species A B C\n"
+                                    "A + B <-> 2 C : 0.2, 0.1\n");
+    CHECK(network.reactions.size() == 2);
+    if (network.reactions.size() != 2)
+        return;
+    auto &forward = network.reactions[0];
+    auto &back = network.reactions[1];
+    CHECK(same_side(forward.holder.Reagents, {{"A", 1}, {"B", 1}}));
+    CHECK(same_side(forward.holder.Products, {{"C", 2}}));
+    CHECK(forward.k0 == 0.2);
+    CHECK(same_side(back.holder.Reagents, {{"C", 2}}));
+    CHECK(same_side(back.holder.Products, {{"A", 1}, {"B", 1}}));
+    CHECK(back.k0 == 0.1);
+    CHECK(forward.line == 2 && back.line == 2);
+    CHECK(network.n_merged == 0);
+
+    // The halves are merged with the other reactions
+    network = parse_crn("A <-> B : 1, 2\n"
+                        "B -> A : 3\n");
+    CHECK(network.reactions.size() == 2);
+    CHECK(network.n_merged == 1);
+    if (network.reactions.size() == 2)
+        CHECK(network.reactions[1].k0 == 5);
+}
+
+void test_merging() {
+    crn_network network = parse_crn("A + A -> B : 1\n"
+                                    "2 A -> B : 2\n"
+                                    "A -> B : mm 1, 2\n"
+                                    "A -> B : mm 1, 3\n"
+                                    "A -> B : mm 4, 2\n"
+                                    "B + C -> D : 1\n"
+                                    "C + B -> D : 1\n");
+    CHECK(network.reactions.size() == 4);
+    CHECK(network.n_merged == 3);
+    if (network.reactions.size() != 4)
+        return;
+    CHECK(same_side(network.reactions[0].holder.Reagents, {{"A", 2}}));
+    CHECK(network.reactions[0].k0 == 3);
+    CHECK(network.reactions[1].k0 == 5 && network.reactions[1].k1 == 2);
+    CHECK(network.reactions[2].k1 == 3);
+    CHECK(network.reactions[3].k0 == 2);
+}
+
+void test_errors() {
+    check_error("A -> B", 1);
+    check_error("species A\n\nA => B : 1", 3);
+    check_error("species A\nspecies B A", 2);
+    check_error("species\n", 1);
+    check_error("species A = -1", 1);
+    check_error("# comment\nA -> B : -1", 2);
+    check_error("A -> B : nan", 1);
+    check_error("A -> B : inf", 1);
+    check_error("A -> B : 1x", 1);
+    check_error("A -> B : 1, 2", 1);
+    check_error("A -> B : 1\nA <-> B : 1", 2);
+    check_error("A <-> B : mm 1, 2", 1);
+    check_error("\n\n\nA + B -> C : mm 1, 2", 4);
+    check_error("2 A -> C : hill 1, 2, 3", 1);
+    check_error("A -> C : hill 1, 0, 3", 1);
+    check_error("A -> C : hill 1, 2", 1);
+    check_error("A -> B : mm 1", 1);
+    check_error("A B -> C : 1", 1);
+}
+
+int main() {
+    test_species();
+    test_laws();
+    test_reversible();
+    test_merging();
+    test_errors();
+    return test_result("crn_loader_test");
+}
@@ -0,0 +1,135 @@
+// Cholesky factorization and Jacobi eigen decomposition of small dense
+// symmetric matrices.
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "helper/dense_linear_algebra.hpp"
+#include "test_helper.hpp"
+
+// Random symmetric positive definite matrix: B B^T + n I
+std::vector<T> random_spd(int n, unsigned seed) {
+    std::mt19937 gen(seed);
+    std::uniform_real_distribution<T> uniform(-1, 1);
+    std::vector<T> b(n * n), a(n * n, 0);
+    for (auto &value : b)
+        value = uniform(gen);
+    for (int i = 0; i < n; i++)
+        for (int j = 0; j < n; j++) {
+            for (int k = 0; k < n; k++)
+                a[i * n + j] += b[i * n + k] * b[j * n + k];
+            if (i == j)
+                a[i * n + j] += n;
+        }
+    return a;
+}
+
+std::vector<T> multiply(const std::vector<T> &a, int n, const T *x) {
+    std::vector<T> y(n, 0);
+    for (int i = 0; i < n; i++)
+        for (int j = 0; j < n; j++)
+            y[i] += a[i * n + j] * x[j];
+    return y;
+}
+
+void test_cholesky() {
+    const int n = 12;
+    std::vector<T> a = random_spd(n, 3);
+    std::vector<T> L = a;
+    CHECK(cholesky(L, n));
+    T maxError = 0;
+    for (int i = 0; i < n; i++)
+        for (int j = 0; j < n; j++) {
+            if (j > i)
+                CHECK(L[i * n + j] == 0);
+            T product = 0;
+            for (int k = 0; k < n; k++)
+                product += L[i * n + k] * L[j * n + k];
+            maxError = std::max(maxError, std::abs(product - a[i * n + j]));
+        }
+    CHECK(maxError < 1e-12 * n);
+
+    std::vector<T> x(n);
+    for (int i = 0; i < n; i++)
+        x[i] = i - 3.5;
+    std::vector<T> b = multiply(a, n, x.data());
+    cholesky_solve(L, n, b.data());
+    for (int i = 0; i < n; i++)
+        CHECK(std::abs(b[i] - x[i]) < 1e-10);
+
+    // L^-T L^-1 b is the solve of a, column by column
+    const int m = 3;
+    std::vector<T> columns(n * m), expected(n * m);
+    for (int i = 0; i < n; i++)
+        for (int c = 0; c < m; c++)
+            columns[i * m + c] = std::sin(i + 2 * c);
+    for (int c = 0; c < m; c++) {
+        std::vector<T> column(n);
+        for (int i = 0; i < n; i++)
+            column[i] = columns[i * m + c];
+        cholesky_solve(L, n, column.data());
+        for (int i = 0; i < n; i++)
+            expected[i * m + c] = column[i];
+    }
+    lower_solve(L, n, columns.data(), m);
+    lower_transpose_solve(L, n, columns.data(), m);
+    for (int k = 0; k < n * m; k++)
+        CHECK(std::abs(columns[k] - expected[k]) < 1e-10);
+
+    std::vector<T> indefinite{1, 2, 2, 1};
+    CHECK(!cholesky(indefinite, 2));
+    std::vector<T> singular{1, 1, 1, 1};
+    CHECK(!cholesky(singular, 2));
+}
+
+void test_symmetric_eigen() {
+    const int n = 10;
+    std::vector<T> a = random_spd(n, 5);
+    std::vector<T> work = a, values, vectors;
+    symmetric_eigen(work, n, values, vectors);
+    CHECK(values.size() == n && vectors.size() == n * n);
+    if (values.size() != n || vectors.size() != n * n)
+        return;
+    for (int k = 1; k < n; k++)
+        CHECK(values[k - 1] >= values[k]);
+    T trace = 0, sum = 0;
+    for (int i = 0; i < n; i++) {
+        trace += a[i * n + i];
+        sum += values[i];
+    }
+    CHECK(std::abs(trace - sum) < 1e-10 * std::abs(trace));
+    for (int k = 0; k < n; k++) {
+        std::vector<T> v(n);
+        for (int i = 0; i < n; i++)
+            v[i] = vectors[i * n + k];
+        std::vector<T> av = multiply(a, n, v.data());
+        T norm = 0;
+        for (int i = 0; i < n; i++) {
+            CHECK(std::abs(av[i] - values[k] * v[i]) < 1e-9);
+            norm += v[i] * v[i];
+        }
+        CHECK(std::abs(norm - 1) < 1e-10);
+        // Orthogonal to the others
+        for (int l = 0; l < k; l++) {
+            T product = 0;
+            for (int i = 0; i < n; i++)
+                product += v[i] * vectors[i * n + l];
+            CHECK(std::abs(product) < 1e-10);
+        }
+    }
+
+    // Known spectrum
+    std::vector<T> diagonal{2, 0, 0, 0, 5, 0, 0, 0, -1};
+    symmetric_eigen(diagonal, 3, values, vectors);
+    CHECK(values.size() == 3);
+    if (values.size() == 3)
+        CHECK(values[0] == 5 && values[1] == 2 && values[2] == -1);
+}
+
+int main() {
+    test_cholesky();
+    test_symmetric_eigen();
+    return test_result("dense_linear_algebra_test");
+}
@@ -0,0 +1,100 @@
+// Zone queries through the mesh index must find the same nodes as a brute
+// force scan, from several threads, and after the nodes move.
+
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "dataStructures/array.hpp"
+#include "geometry/mesh.hpp"
+#include "geometry/zone.hpp"
+#include "geometry/zone_methods.hpp"
+#include "helper/cuda/cuda_error_check.h"
+#include "test_helper.hpp"
+
+struct host_nodes {
+    std::vector<T> x;
+    std::vector<T> y;
+};
+
+// Irregular cloud of nodes, denser in one corner so that the grid cells have
+// uneven counts
+host_nodes make_nodes(int n, unsigned seed) {
+    host_nodes nodes;
+    std::mt19937 gen(seed);
+    std::uniform_real_distribution<T> uniform(0, 1);
+    for (int i = 0; i < n; i++) {
+        T u = uniform(gen), v = uniform(gen);
+        nodes.x.push_back((i % 3 == 0) ? u * u : u);
+        nodes.y.push_back((i % 3 == 0) ? v * v : v);
+    }
+    return nodes;
+}
+
+void upload(d_mesh &mesh, const host_nodes &nodes) {
+    gpuErrchk(cudaMemcpy(mesh.X.data, nodes.x.data(),
+                         sizeof(T) * nodes.x.size(), cudaMemcpyHostToDevice));
+    gpuErrchk(cudaMemcpy(mesh.Y.data, nodes.y.data(),
+                         sizeof(T) * nodes.y.size(), cudaMemcpyHostToDevice));
+}
+
+template <typename Zone>
+int brute_force_count(const host_nodes &nodes, Zone &zone) {
+    int count = 0;
+    for (int i = 0; i < nodes.x.size(); i++)
+        count += zone.is_inside(nodes.x[i], nodes.y[i]);
+    return count;
+}
+
+int main() {
+    const int n = 5000;
+    host_nodes nodes = make_nodes(n, 1);
+    d_mesh mesh(n);
+    upload(mesh, nodes);
+
+    rect_zone rect(0.1, 0.2, 0.45, 0.7);
+    circle_zone circle(0.3, 0.3, 0.15);
+    tri_zone triangle(0.5, 0.1, 0.9, 0.2, 0.6, 0.8);
+    rect_zone outside(2, 2, 3, 3);
+    CHECK(count_zone(mesh, rect) == brute_force_count(nodes, rect));
+    CHECK(count_zone(mesh, circle) == brute_force_count(nodes, circle));
+    CHECK(count_zone(mesh, triangle) == brute_force_count(nodes, triangle));
+    CHECK(count_zone(mesh, outside) == 0);
+    CHECK(count_zone(mesh, simple_zone::all) == n);
+    CHECK(count_zone(mesh, simple_zone::none) == 0);
+    // From the cached mask
+    CHECK(count_zone(mesh, rect) == brute_force_count(nodes, rect));
+
+    // Concurrent first queries build the index once
+    mesh.clear_index();
+    std::vector<int> counts(8, -1);
+    std::vector<std::thread> threads;
+    for (int k = 0; k < counts.size(); k++)
+        threads.emplace_back([&, k]() {
+            rect_zone zone(0.05 * k, 0.1, 0.05 * k + 0.3, 0.9);
+            counts[k] = count_zone(mesh, zone);
+        });
+    for (auto &thread : threads)
+        thread.join();
+    for (int k = 0; k < counts.size(); k++) {
+        rect_zone zone(0.05 * k, 0.1, 0.05 * k + 0.3, 0.9);
+        CHECK(counts[k] == brute_force_count(nodes, zone));
+    }
+
+    // Moved nodes, after clear_index
+    host_nodes moved = make_nodes(n, 2);
+    upload(mesh, moved);
+    mesh.clear_index();
+    CHECK(count_zone(mesh, rect) == brute_force_count(moved, rect));
+    CHECK(count_zone(mesh, circle) == brute_force_count(moved, circle));
+
+    // Mask capacity
+    mesh.set_zone_mask_capacity(1);
+    CHECK(count_zone(mesh, triangle) == brute_force_count(moved, triangle));
+    CHECK(mesh.cached_zone_mask(triangle.key()) != nullptr);
+    CHECK(mesh.cached_zone_mask(rect.key()) == nullptr);
+    mesh.set_zone_mask_capacity(0);
+    CHECK(mesh.cached_zone_mask(triangle.key()) == nullptr);
+
+    return test_result("mesh_grid_test");
+}
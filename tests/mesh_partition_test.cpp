@@ -0,0 +1,180 @@
+// Recursive coordinate bisection, block ordering and renumbering of meshes.
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include "geometry/mesh.hpp"
+#include "geometry/mesh_partition.hpp"
+#include "test_helper.hpp"
+
+d_mesh host_mesh(const test_mesh &mesh) {
+    d_mesh result(mesh.n_nodes(), mesh.n_triangles(), false);
+    std::copy(mesh.x.begin(), mesh.x.end(), result.X.data);
+    std::copy(mesh.y.begin(), mesh.y.end(), result.Y.data);
+    std::copy(mesh.triangles.begin(), mesh.triangles.end(),
+              result.triangles.data);
+    return result;
+}
+
+// Edges of the triangles whose nodes have different parts
+int cut_edges(const test_mesh &mesh, const std::vector<int> &part) {
+    int cut = 0;
+    for (int t = 0; t < mesh.n_triangles(); t++)
+        for (int k = 0; k < 3; k++)
+            cut += part[mesh.triangles[3 * t + k]] !=
+                   part[mesh.triangles[3 * t + (k + 1) % 3]];
+    return cut;
+}
+
+// Mean distance between the indices of the nodes of the triangle edges
+double mean_edge_span(const d_mesh &mesh) {
+    double sum = 0;
+    int count = mesh.triangles.n;
+    for (int t = 0; t < count / 3; t++)
+        for (int k = 0; k < 3; k++)
+            sum += std::abs(mesh.triangles.data[3 * t + k] -
+                            mesh.triangles.data[3 * t + (k + 1) % 3]);
+    return sum / count;
+}
+
+bool is_node_permutation(const std::vector<int> &order, int n) {
+    std::vector<int> sorted = order;
+    std::sort(sorted.begin(), sorted.end());
+    for (int i = 0; i < n; i++)
+        if (sorted[i] != i)
+            return false;
+    return sorted.size() == n;
+}
+
+void test_rcb_partition() {
+    test_mesh mesh = make_test_mesh(20);
+    int n = mesh.n_nodes();
+    for (int nParts : {1, 2, 3, 7, 16}) {
+        auto part = rcb_partition(mesh.x.data(), mesh.y.data(), n, nParts);
+        CHECK(part.size() == n);
+        std::vector<int> sizes(nParts, 0);
+        for (int p : part) {
+            CHECK(p >= 0 && p < nParts);
+            if (p >= 0 && p < nParts)
+                sizes[p]++;
+        }
+        auto range = std::minmax_element(sizes.begin(), sizes.end());
+        CHECK(*range.second - *range.first <= 1);
+        CHECK(part == rcb_partition(mesh.x.data(), mesh.y.data(), n, nParts));
+    }
+    // Four quadrants: only the edges along the two middle lines are cut,
+    // where a random assignment would cut three quarters of them
+    auto part = rcb_partition(mesh.x.data(), mesh.y.data(), n, 4);
+    CHECK(cut_edges(mesh, part) < 0.1 * 3 * mesh.n_triangles());
+
+    d_mesh hostMesh = host_mesh(mesh);
+    CHECK(rcb_partition(hostMesh, 4) == part);
+    CHECK(rcb_partition(nullptr, nullptr, 0, 3).empty());
+    CHECK_THROWS(std::invalid_argument,
+                 rcb_partition(mesh.x.data(), mesh.y.data(), n, 0));
+}
+
+void test_block_ordering() {
+    test_mesh mesh = make_test_mesh(30);
+    int n = mesh.n_nodes();
+    // Shuffled numbering
+    std::vector<int> shuffle(n);
+    std::iota(shuffle.begin(), shuffle.end(), 0);
+    std::shuffle(shuffle.begin(), shuffle.end(), std::mt19937(11));
+    d_mesh natural = host_mesh(mesh);
+    d_mesh shuffled = reorder_mesh(natural, shuffle);
+
+    auto order = block_ordering(shuffled, 64);
+    CHECK(is_node_permutation(order, n));
+    d_mesh blocked = reorder_mesh(shuffled, order);
+    CHECK(mean_edge_span(blocked) < 0.1 * mean_edge_span(shuffled));
+
+    // Without triangles, the blocks are numbered by index
+    auto noTriangles = block_ordering(mesh.x.data(), mesh.y.data(), n, nullptr,
+                                      0, 64);
+    CHECK(is_node_permutation(noTriangles, n));
+
+    CHECK_THROWS(std::invalid_argument,
+                 block_ordering(mesh.x.data(), mesh.y.data(), n,
+                                mesh.triangles.data(), mesh.n_triangles(), 0));
+    test_mesh invalid = mesh;
+    invalid.triangles[7] = n;
+    CHECK_THROWS(std::invalid_argument,
+                 block_ordering(invalid.x.data(), invalid.y.data(), n,
+                                invalid.triangles.data(),
+                                invalid.n_triangles()));
+    invalid.triangles[7] = -1;
+    CHECK_THROWS(std::invalid_argument,
+                 block_ordering(invalid.x.data(), invalid.y.data(), n,
+                                invalid.triangles.data(),
+                                invalid.n_triangles()));
+}
+
+void test_reorder_mesh() {
+    test_mesh mesh = make_test_mesh(6);
+    int n = mesh.n_nodes();
+    d_mesh original = host_mesh(mesh);
+    std::vector<int> order(n);
+    std::iota(order.begin(), order.end(), 0);
+    std::reverse(order.begin(), order.end());
+    std::swap(order[0], order[n / 2]);
+
+    d_mesh reordered = reorder_mesh(original, order);
+    CHECK(!reordered.is_device());
+    CHECK(reordered.size() == n);
+    CHECK(reordered.n_triangles() == mesh.n_triangles());
+    for (int i = 0; i < n; i++) {
+        CHECK(reordered.X.data[i] == mesh.x[order[i]]);
+        CHECK(reordered.Y.data[i] == mesh.y[order[i]]);
+    }
+    // Same triangles, as sets of coordinates, sorted by their first node
+    std::vector<std::vector<std::pair<T, T>>> before, after;
+    int previousFirst = -1;
+    for (int t = 0; t < mesh.n_triangles(); t++) {
+        std::vector<std::pair<T, T>> a, b;
+        int first = n;
+        for (int k = 0; k < 3; k++) {
+            int i = mesh.triangles[3 * t + k];
+            int j = reordered.triangles.data[3 * t + k];
+            a.push_back({mesh.x[i], mesh.y[i]});
+            b.push_back({reordered.X.data[j], reordered.Y.data[j]});
+            first = std::min(first, j);
+        }
+        CHECK(first >= previousFirst);
+        previousFirst = first;
+        before.push_back(a);
+        after.push_back(b);
+    }
+    auto sortAll = [](std::vector<std::vector<std::pair<T, T>>> &triangles) {
+        for (auto &triangle : triangles)
+            std::rotate(triangle.begin(),
+                        std::min_element(triangle.begin(), triangle.end()),
+                        triangle.end());
+        std::sort(triangles.begin(), triangles.end());
+    };
+    sortAll(before);
+    sortAll(after);
+    CHECK(before == after);
+
+    std::vector<int> tooShort(order.begin(), order.end() - 1);
+    CHECK_THROWS(std::invalid_argument, reorder_mesh(original, tooShort));
+    std::vector<int> repeated = order;
+    repeated[1] = repeated[0];
+    CHECK_THROWS(std::invalid_argument, reorder_mesh(original, repeated));
+    std::vector<int> outOfRange = order;
+    outOfRange[2] = n;
+    CHECK_THROWS(std::invalid_argument, reorder_mesh(original, outOfRange));
+    original.triangles.data[5] = n + 3;
+    CHECK_THROWS(std::invalid_argument, reorder_mesh(original, order));
+}
+
+int main() {
+    test_rcb_partition();
+    test_block_ordering();
+    test_reorder_mesh();
+    return test_result("mesh_partition_test");
+}
@@ -0,0 +1,110 @@
+// P1 assembly on a triangulated unit square, and rejection of invalid
+// triangles by the assembly and by check_triangles.
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include "dataStructures/array.hpp"
+#include "dataStructures/sparse_matrix.hpp"
+#include "geometry/mesh.hpp"
+#include "geometry/mesh_read_write.hpp"
+#include "geometry/p1_assembly.hpp"
+#include "helper/cuda/cuda_error_check.h"
+#include "test_helper.hpp"
+
+// Device mesh holding its triangles
+d_mesh *device_mesh(const test_mesh &hostMesh) {
+    int n = hostMesh.n_nodes();
+    d_mesh *mesh = new d_mesh(n, hostMesh.n_triangles());
+    gpuErrchk(cudaMemcpy(mesh->X.data, hostMesh.x.data(), sizeof(T) * n,
+                         cudaMemcpyHostToDevice));
+    gpuErrchk(cudaMemcpy(mesh->Y.data, hostMesh.y.data(), sizeof(T) * n,
+                         cudaMemcpyHostToDevice));
+    gpuErrchk(cudaMemcpy(mesh->triangles.data, hostMesh.triangles.data(),
+                         sizeof(int) * hostMesh.triangles.size(),
+                         cudaMemcpyHostToDevice));
+    return mesh;
+}
+
+T sum_of_values(d_spmatrix &matrix) {
+    d_spmatrix host(matrix, true);
+    T sum = 0;
+    for (int k = 0; k < host.nnz; k++)
+        sum += host.data[k];
+    return sum;
+}
+
+// Largest absolute row sum of a CSR matrix
+T max_row_sum(d_spmatrix &matrix) {
+    d_spmatrix host(matrix, true);
+    T result = 0;
+    for (int i = 0; i < host.rows; i++) {
+        T rowSum = 0;
+        for (int k = host.rowPtr[i]; k < host.rowPtr[i + 1]; k++)
+            rowSum += host.data[k];
+        result = std::max(result, std::abs(rowSum));
+    }
+    return result;
+}
+
+void test_assembly() {
+    test_mesh hostMesh = make_test_mesh(8);
+    std::unique_ptr<d_mesh> mesh(device_mesh(hostMesh));
+    d_spmatrix mass, stiffness;
+    assemble_p1_matrices(*mesh, mass, stiffness);
+    CHECK(mass.type == CSR && stiffness.type == CSR);
+    CHECK(mass.rows == hostMesh.n_nodes() && mass.cols == hostMesh.n_nodes());
+    // The integral of the constant 1 over the unit square
+    CHECK(std::abs(sum_of_values(mass) - 1) < 1e-12);
+    // Constants are in the kernel of the stiffness matrix
+    CHECK(max_row_sum(stiffness) < 1e-12);
+    CHECK(mass.is_symetric() && stiffness.is_symetric());
+
+    d_spmatrix lumped, lumpedStiffness;
+    assemble_p1_matrices(*mesh, lumped, lumpedStiffness, true);
+    CHECK(lumped.nnz == hostMesh.n_nodes());
+    CHECK(std::abs(sum_of_values(lumped) - 1) < 1e-12);
+}
+
+void test_invalid_triangles() {
+    test_mesh outOfMesh = make_test_mesh(2);
+    outOfMesh.triangles[4] = outOfMesh.n_nodes();
+    std::unique_ptr<d_mesh> mesh(device_mesh(outOfMesh));
+    d_spmatrix mass, stiffness;
+    CHECK_THROWS(std::invalid_argument,
+                 assemble_p1_matrices(*mesh, mass, stiffness));
+    CHECK_THROWS(std::invalid_argument, check_triangles(*mesh));
+    d_mesh hostCopy(*mesh, true);
+    CHECK_THROWS(std::invalid_argument, check_triangles(hostCopy));
+
+    test_mesh negative = make_test_mesh(2);
+    negative.triangles[0] = -1;
+    mesh.reset(device_mesh(negative));
+    CHECK_THROWS(std::invalid_argument,
+                 assemble_p1_matrices(*mesh, mass, stiffness));
+    CHECK_THROWS(std::invalid_argument, check_triangles(*mesh));
+
+    test_mesh degenerate = make_test_mesh(2);
+    degenerate.triangles[2] = degenerate.triangles[1];
+    mesh.reset(device_mesh(degenerate));
+    CHECK_THROWS(std::invalid_argument,
+                 assemble_p1_matrices(*mesh, mass, stiffness));
+
+    test_mesh valid = make_test_mesh(2);
+    mesh.reset(device_mesh(valid));
+    check_triangles(*mesh);
+    test_mesh empty = make_test_mesh(2);
+    empty.triangles.clear();
+    mesh.reset(device_mesh(empty));
+    CHECK_THROWS(std::invalid_argument,
+                 assemble_p1_matrices(*mesh, mass, stiffness));
+}
+
+int main() {
+    test_assembly();
+    test_invalid_triangles();
+    return test_result("p1_assembly_test");
+}
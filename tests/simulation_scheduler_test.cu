@@ -0,0 +1,92 @@
+// Simulations run concurrently by run_simulations must give the same states
+// as the same simulations run one after the other.
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "dataStructures/array.hpp"
+#include "geometry/mesh.hpp"
+#include "geometry/p1_assembly.hpp"
+#include "helper/cuda/cuda_error_check.h"
+#include "reactionDiffusionSystem/simulation.hpp"
+#include "reactionDiffusionSystem/simulation_scheduler.hpp"
+#include "test_helper.hpp"
+
+const std::vector<std::string> speciesNames{"A", "B", "C"};
+
+// The simulations differ by their rates and initial states, so that a result
+// written to the wrong simulation is detected
+std::unique_ptr<simulation> make_simulation(int k, d_mesh &mesh,
+                                            std::shared_ptr<d_spmatrix> mass,
+                                            std::shared_ptr<d_spmatrix> stiff) {
+    int n = mesh.size();
+    auto simu = std::make_unique<simulation>(n);
+    simu->epsilon = 1e-8;
+    simu->load_dampness_matrix(mass);
+    simu->load_stiffness_matrix(stiff);
+    std::vector<T> a(n);
+    for (int i = 0; i < n; i++)
+        a[i] = 1 + std::sin((k + 1) * (i % 17));
+    d_vector &A = simu->current_state.add_species("A");
+    gpuErrchk(
+        cudaMemcpy(A.data, a.data(), sizeof(T) * n, cudaMemcpyHostToDevice));
+    simu->current_state.add_species("B").fill(0.5 + 0.1 * k);
+    simu->current_state.add_species("C").fill(0.0);
+    simu->add_reaction("A + B -> C", 0.1 * (k + 1));
+    simu->add_reaction("C -> A", 0.05);
+    simu->add_mm_reaction("B -> 2 C", 1.0, 0.5);
+    return simu;
+}
+
+std::vector<T> species_values(simulation &simu, const std::string &name) {
+    d_vector hostCopy(simu.current_state.get_species(name), true);
+    return std::vector<T>(hostCopy.data, hostCopy.data + hostCopy.n);
+}
+
+int main() {
+    const int nSimulations = 6;
+    const int nSteps = 20;
+    const T dt = 0.05;
+
+    test_mesh hostMesh = make_test_mesh(24);
+    d_mesh mesh(hostMesh.n_nodes(), hostMesh.x.data(), hostMesh.y.data());
+    d_array<int> triangles(hostMesh.triangles.size());
+    gpuErrchk(cudaMemcpy(triangles.data, hostMesh.triangles.data(),
+                         sizeof(int) * hostMesh.triangles.size(),
+                         cudaMemcpyHostToDevice));
+    auto mass = std::make_shared<d_spmatrix>();
+    auto stiffness = std::make_shared<d_spmatrix>();
+    assemble_p1_matrices(mesh, triangles, *mass, *stiffness);
+
+    std::vector<std::unique_ptr<simulation>> serial, concurrent;
+    for (int k = 0; k < nSimulations; k++) {
+        serial.push_back(make_simulation(k, mesh, mass, stiffness));
+        concurrent.push_back(make_simulation(k, mesh, mass, stiffness));
+    }
+
+    for (auto &simu : serial)
+        CHECK(simu->run(dt, nSteps) == nSteps);
+
+    std::vector<simulation *> jobs;
+    for (auto &simu : concurrent)
+        jobs.push_back(simu.get());
+    std::vector<int> nDone = run_simulations(jobs, dt, nSteps, 4);
+    for (int done : nDone)
+        CHECK(done == nSteps);
+
+    for (int k = 0; k < nSimulations; k++)
+        for (const std::string &name : speciesNames) {
+            auto expected = species_values(*serial[k], name);
+            auto actual = species_values(*concurrent[k], name);
+            CHECK(expected.size() == actual.size());
+            T maxDiff = 0;
+            for (int i = 0; i < expected.size() && i < actual.size(); i++)
+                maxDiff = std::max(maxDiff, std::abs(expected[i] - actual[i]));
+            CHECK(maxDiff <= 1e-10);
+        }
+
+    return test_result("simulation_scheduler_test");
+}
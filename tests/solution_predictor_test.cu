@@ -0,0 +1,103 @@
+// The predictor of the diffusion solves must save conjugate gradient
+// iterations, at the same tolerance, without changing the solution.
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <vector>
+
+#include "dataStructures/array.hpp"
+#include "geometry/mesh.hpp"
+#include "geometry/p1_assembly.hpp"
+#include "helper/cuda/cuda_error_check.h"
+#include "reactionDiffusionSystem/simulation.hpp"
+#include "test_helper.hpp"
+
+// Diffusion of a bump, which varies smoothly from one step to the next
+std::unique_ptr<simulation> make_simulation(const test_mesh &hostMesh,
+                                            std::shared_ptr<d_spmatrix> mass,
+                                            std::shared_ptr<d_spmatrix> stiff,
+                                            int predictorOrder) {
+    int n = hostMesh.n_nodes();
+    auto simu = std::make_unique<simulation>(n);
+    simu->epsilon = 1e-8;
+    simu->drain = 0;
+    simu->relative_to_rhs = true;
+    simu->predictor_order = predictorOrder;
+    simu->load_dampness_matrix(mass);
+    simu->load_stiffness_matrix(stiff);
+    std::vector<T> u(n);
+    for (int i = 0; i < n; i++) {
+        T dx = hostMesh.x[i] - 0.3, dy = hostMesh.y[i] - 0.4;
+        u[i] = std::exp(-50 * (dx * dx + dy * dy));
+    }
+    d_vector &U = simu->current_state.add_species("U");
+    gpuErrchk(
+        cudaMemcpy(U.data, u.data(), sizeof(T) * n, cudaMemcpyHostToDevice));
+    return simu;
+}
+
+// Diffusion steps only, returns the number of converged ones
+int run_diffusion(simulation &simu, T dt, int nSteps) {
+    int step = 0;
+    while (step < nSteps && simu.iterate_diffusion(dt))
+        step++;
+    return step;
+}
+
+// Iterations of the solves of the steps after the first warmUp ones
+long iterations_after(simulation &simu, int warmUp) {
+    long iterations = 0;
+    for (int k = 0; k < simu.telemetry.size(); k++)
+        if (simu.telemetry.at(k).step >= warmUp)
+            iterations += simu.telemetry.at(k).n_iter;
+    return iterations;
+}
+
+int main() {
+    const int nSteps = 30;
+    const int warmUp = 4;
+    const T dt = 1e-3;
+
+    test_mesh hostMesh = make_test_mesh(48);
+    d_mesh mesh(hostMesh.n_nodes(), hostMesh.x.data(), hostMesh.y.data());
+    d_array<int> triangles(hostMesh.triangles.size());
+    gpuErrchk(cudaMemcpy(triangles.data, hostMesh.triangles.data(),
+                         sizeof(int) * hostMesh.triangles.size(),
+                         cudaMemcpyHostToDevice));
+    auto mass = std::make_shared<d_spmatrix>();
+    auto stiffness = std::make_shared<d_spmatrix>();
+    assemble_p1_matrices(mesh, triangles, *mass, *stiffness);
+
+    auto plain = make_simulation(hostMesh, mass, stiffness, 0);
+    auto predicted = make_simulation(hostMesh, mass, stiffness, 2);
+    predicted->predictor_probe_every = 5;
+    CHECK(run_diffusion(*plain, dt, nSteps) == nSteps);
+    CHECK(run_diffusion(*predicted, dt, nSteps) == nSteps);
+
+    long plainIterations = iterations_after(*plain, warmUp);
+    long predictedIterations = iterations_after(*predicted, warmUp);
+    std::cout << "iterations without predictor: " << plainIterations
+              << ", with predictor: " << predictedIterations << "\n";
+    CHECK(predictedIterations < plainIterations);
+    CHECK(predicted->predictor_probes > 0);
+    CHECK(predicted->predictor_saved_iterations > 0);
+
+    // The predictor turns the tolerance relative to the right-hand side on
+    // by itself
+    auto implicit = make_simulation(hostMesh, mass, stiffness, 2);
+    implicit->relative_to_rhs = false;
+    CHECK(run_diffusion(*implicit, dt, nSteps) == nSteps);
+    CHECK(iterations_after(*implicit, warmUp) == predictedIterations);
+
+    d_vector expected(plain->current_state.get_species("U"), true);
+    d_vector actual(predicted->current_state.get_species("U"), true);
+    T maxDiff = 0, maxValue = 0;
+    for (int i = 0; i < expected.n; i++) {
+        maxDiff = std::max(maxDiff, std::abs(expected.data[i] - actual.data[i]));
+        maxValue = std::max(maxValue, std::abs(expected.data[i]));
+    }
+    CHECK(maxDiff <= 1e-6 * maxValue);
+
+    return test_result("solution_predictor_test");
+}
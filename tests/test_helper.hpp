@@ -0,0 +1,76 @@
+#pragma once
+
+// Minimal helpers of the unit tests: each test is an executable that returns
+// the number of failed checks (see CMakeLists.txt).
+
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+#include "constants.hpp"
+
+inline int &test_failures() {
+    static int failures = 0;
+    return failures;
+}
+
+#define CHECK(condition)                                                       \
+    do {                                                                       \
+        if (!(condition)) {                                                    \
+            std::cerr << __FILE__ << ":" << __LINE__                           \
+                      << ": check failed: " #condition "\n";                   \
+            test_failures()++;                                                 \
+        }                                                                      \
+    } while (0)
+
+// Checks that statement throws an exception of type Exception
+#define CHECK_THROWS(Exception, statement)                                     \
+    do {                                                                       \
+        bool thrown = false;                                                   \
+        try {                                                                  \
+            statement;                                                         \
+        } catch (const Exception &) {                                          \
+            thrown = true;                                                     \
+        }                                                                      \
+        if (!thrown) {                                                         \
+            std::cerr << __FILE__ << ":" << __LINE__                           \
+                      << ": " #statement " did not throw " #Exception "\n";    \
+            test_failures()++;                                                 \
+        }                                                                      \
+    } while (0)
+
+// Triangulated square of size x size cells of side 1, with the nodes numbered
+// along the rows
+struct test_mesh {
+    std::vector<T> x;
+    std::vector<T> y;
+    std::vector<int> triangles;
+
+    int n_nodes() const { return x.size(); }
+    int n_triangles() const { return triangles.size() / 3; }
+};
+
+inline test_mesh make_test_mesh(int size) {
+    test_mesh mesh;
+    for (int j = 0; j <= size; j++)
+        for (int i = 0; i <= size; i++) {
+            mesh.x.push_back((T)i / size);
+            mesh.y.push_back((T)j / size);
+        }
+    auto node = [size](int i, int j) { return j * (size + 1) + i; };
+    for (int j = 0; j < size; j++)
+        for (int i = 0; i < size; i++) {
+            int a = node(i, j), b = node(i + 1, j), c = node(i + 1, j + 1),
+                d = node(i, j + 1);
+            mesh.triangles.insert(mesh.triangles.end(), {a, b, c, a, c, d});
+        }
+    return mesh;
+}
+
+inline int test_result(const char *name) {
+    if (test_failures() == 0)
+        std::cout << name << ": all checks passed\n";
+    else
+        std::cerr << name << ": " << test_failures() << " checks failed\n";
+    return test_failures();
+}